@@ -0,0 +1,339 @@
+#include "analyzer.h"
+
+#include "error.h"
+
+#include <deque>
+#include <vector>
+
+// what analysis knows about a variable of a lambda frame
+struct VariableInfo {
+    std::string name;
+    bool captured = false;
+    bool assigned = false;
+    // nodes that have to go through a Box if the variable ends up in one
+    std::vector<LocalVariable*> uses;
+    std::vector<LocalAssignment*> assignments;
+};
+
+// variables of a lambda frame and of its closure known at analysis time
+struct FrameLayout {
+    // arguments go first, then internal definitions; deque keeps the references stable
+    std::deque<VariableInfo> slots;
+    std::vector<ConstructLambda::Capture> captures;
+    std::vector<VariableInfo*> captured;
+    FrameLayout* parent = nullptr;
+
+    // position of the slot, adding it if needed
+    size_t Add(const std::string& name) {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].name == name) {
+                return i;
+            }
+        }
+        slots.emplace_back();
+        slots.back().name = name;
+        return slots.size() - 1;
+    }
+};
+
+// place of a variable from the point of view of some frame
+struct Resolution {
+    VariableInfo* variable = nullptr;
+    bool captured = false;
+    size_t index = 0;
+};
+
+// free variables are added to the captures of every lambda between the use and the binding
+Resolution Resolve(FrameLayout* frame, const std::string& name) {
+    Resolution res;
+    if (!frame) {
+        return res;
+    }
+    for (size_t i = 0; i < frame->slots.size(); ++i) {
+        if (frame->slots[i].name == name) {
+            res.variable = &frame->slots[i];
+            res.index = i;
+            return res;
+        }
+    }
+    for (size_t i = 0; i < frame->captured.size(); ++i) {
+        if (frame->captured[i]->name == name) {
+            res.variable = frame->captured[i];
+            res.captured = true;
+            res.index = i;
+            return res;
+        }
+    }
+    auto outer = Resolve(frame->parent, name);
+    if (!outer.variable) {
+        return res;
+    }
+    outer.variable->captured = true;
+    frame->captures.push_back({outer.captured, outer.index});
+    frame->captured.push_back(outer.variable);
+    res.variable = outer.variable;
+    res.captured = true;
+    res.index = frame->captured.size() - 1;
+    return res;
+}
+
+Node Analyze(Node root, FrameLayout* frame);
+
+// elements of a proper list, special forms don't accept dotted ones
+std::vector<Node> FormArguments(Node root) {
+    std::vector<Node> args;
+    for (; Is<Cell>(root); root = GetSecond(root)) {
+        args.push_back(GetFirst(root));
+    }
+    if (root) {
+        throw SyntaxError("Improper argument list of a special form");
+    }
+    return args;
+}
+
+// list of analyzed expressions in the same order
+Node AnalyzeSequence(const std::vector<Node>& exprs, FrameLayout* frame) {
+    std::vector<Node> analyzed;
+    for (auto expr : exprs) {
+        analyzed.push_back(Analyze(expr, frame));
+    }
+    Node res = nullptr;
+    for (auto it = analyzed.rbegin(); it != analyzed.rend(); ++it) {
+        res = Heap::GetInstance().Make<Cell>(*it, res);
+    }
+    return res;
+}
+
+std::vector<Node> AnalyzeEach(const std::vector<Node>& exprs, FrameLayout* frame) {
+    std::vector<Node> res;
+    for (auto expr : exprs) {
+        res.push_back(Analyze(expr, frame));
+    }
+    return res;
+}
+
+Node AnalyzeSymbol(Node root, FrameLayout* frame) {
+    auto res = Resolve(frame, GetName(root));
+    if (!res.variable) {
+        // global, resolved at runtime
+        return root;
+    }
+    auto node = As<LocalVariable>(Heap::GetInstance().Make<LocalVariable>(res.captured, res.index));
+    res.variable->uses.push_back(node);
+    return node;
+}
+
+Node MakeAssignment(const Resolution& res, Node value) {
+    auto node = As<LocalAssignment>(
+        Heap::GetInstance().Make<LocalAssignment>(res.captured, res.index, value));
+    res.variable->assigned = true;
+    res.variable->assignments.push_back(node);
+    return node;
+}
+
+Node AnalyzeQuote(Node root) {
+    if (!Is<Cell>(root) || GetSecond(root)) {
+        throw SyntaxError("quote requires 1 argument");
+    }
+    return Heap::GetInstance().Make<Quote>(GetFirst(root));
+}
+
+Node AnalyzeIf(Node root, FrameLayout* frame) {
+    auto args = FormArguments(root);
+    if (args.size() < 2 || args.size() > 3 || !args[1]) {
+        throw SyntaxError("if invalid number of arguments, requires 2 or 3");
+    }
+    Node condition = Analyze(args[0], frame);
+    Node then_branch = Analyze(args[1], frame);
+    Node else_branch = args.size() == 3 ? Analyze(args[2], frame) : nullptr;
+    return Heap::GetInstance().Make<If>(condition, then_branch, else_branch, args.size() == 3);
+}
+
+// name introduced by (define name ...), (define (name ...) ...) or (define-memoized (name ...)
+// ...), if root is such a form
+const std::string* DefinedName(Node root) {
+    if (!Is<Cell>(root) || !Is<Symbol>(GetFirst(root)) || !Is<Cell>(GetSecond(root))) {
+        return nullptr;
+    }
+    const std::string& form = GetName(GetFirst(root));
+    if (form != "define" && form != "define-memoized") {
+        return nullptr;
+    }
+    Node target = GetFirst(GetSecond(root));
+    if (Is<Cell>(target)) {
+        target = GetFirst(target);
+    }
+    return Is<Symbol>(target) ? &GetName(target) : nullptr;
+}
+
+Node AnalyzeLambda(Node params, Node body, FrameLayout* parent) {
+    if (params && !Is<Cell>(params)) {
+        throw SyntaxError("Argument list required for lambda construction");
+    }
+    FrameLayout frame;
+    frame.parent = parent;
+    auto args = FormArguments(params);
+    for (auto arg : args) {
+        if (!Is<Symbol>(arg)) {
+            throw SyntaxError("Lambda arguments have to be symbols");
+        }
+        frame.Add(GetName(arg));
+    }
+    if (!Is<Cell>(body)) {
+        throw SyntaxError("Can't create empty lambda");
+    }
+
+    // internal definitions are visible in the whole body
+    auto exprs = FormArguments(body);
+    for (auto expr : exprs) {
+        if (auto name = DefinedName(expr)) {
+            frame.Add(*name);
+        }
+    }
+    Node analyzed = AnalyzeSequence(exprs, &frame);
+
+    // the frame and the closures see the same variable only if it is shared through a Box
+    std::vector<size_t> boxed;
+    for (size_t i = 0; i < frame.slots.size(); ++i) {
+        auto& variable = frame.slots[i];
+        if (!variable.captured || !variable.assigned) {
+            continue;
+        }
+        boxed.push_back(i);
+        for (auto node : variable.uses) {
+            node->SetBoxed();
+        }
+        for (auto node : variable.assignments) {
+            node->SetBoxed();
+        }
+    }
+    return Heap::GetInstance().Make<ConstructLambda>(args.size(), frame.slots.size(), boxed,
+                                                     frame.captures, analyzed);
+}
+
+// (define-memoized (name args...) body...) is the lambda sugar of define for a pure function,
+// its calls are cached by their arguments
+Node AnalyzeDefine(Node root, FrameLayout* frame, bool memoized = false) {
+    if (!Is<Cell>(root)) {
+        throw SyntaxError("Define requires 2 arguments");
+    }
+    if (memoized && !Is<Cell>(GetFirst(root))) {
+        throw SyntaxError("define-memoized requires a function signature");
+    }
+
+    Node value;
+    std::string name;
+    // lambda sugar case
+    if (Is<Cell>(GetFirst(root))) {
+        Node signature = GetFirst(root);
+        if (!Is<Symbol>(GetFirst(signature))) {
+            throw SyntaxError("Bad argument to define");
+        }
+        name = GetName(GetFirst(signature));
+        if (frame) {
+            frame->Add(name);
+        }
+        value = AnalyzeLambda(GetSecond(signature), GetSecond(root), frame);
+        if (memoized) {
+            As<ConstructLambda>(value)->SetMemoized();
+        }
+    } else {
+        if (!Is<Symbol>(GetFirst(root))) {
+            throw SyntaxError("Bad argument to define");
+        }
+        if (!Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
+            throw SyntaxError("Define requires 2 arguments");
+        }
+        name = GetName(GetFirst(root));
+        if (frame) {
+            frame->Add(name);
+        }
+        value = Analyze(GetFirst(GetSecond(root)), frame);
+    }
+
+    if (!frame) {
+        return Heap::GetInstance().Make<Define>(name, value);
+    }
+    return MakeAssignment(Resolve(frame, name), value);
+}
+
+Node AnalyzeSet(Node root, FrameLayout* frame) {
+    if (!Is<Cell>(root)) {
+        throw SyntaxError("Set requires 2 arguments");
+    }
+    if (!Is<Symbol>(GetFirst(root))) {
+        throw SyntaxError("Bad argument to set");
+    }
+    if (!Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
+        throw SyntaxError("Set requires 2 arguments");
+    }
+    const std::string& name = GetName(GetFirst(root));
+    Node value = Analyze(GetFirst(GetSecond(root)), frame);
+    auto res = Resolve(frame, name);
+    if (!res.variable) {
+        return Heap::GetInstance().Make<Set>(name, value);
+    }
+    return MakeAssignment(res, value);
+}
+
+Node AnalyzeCall(Node root, FrameLayout* frame) {
+    Node res = Heap::GetInstance().Make<Cell>(Analyze(GetFirst(root), frame), nullptr);
+    Node last = res;
+    Node cur = GetSecond(root);
+    while (Is<Cell>(cur)) {
+        // (f a . 'b) is read as (f a quote b), the quoted tail is passed as is
+        if (Is<Symbol>(GetFirst(cur)) && GetName(GetFirst(cur)) == "quote") {
+            break;
+        }
+        GetSecond(last) = Heap::GetInstance().Make<Cell>(Analyze(GetFirst(cur), frame), nullptr);
+        last = GetSecond(last);
+        cur = GetSecond(cur);
+    }
+    GetSecond(last) = Is<Symbol>(cur) ? AnalyzeSymbol(cur, frame) : cur;
+    return res;
+}
+
+Node Analyze(Node root, FrameLayout* frame) {
+    if (Is<Symbol>(root)) {
+        return AnalyzeSymbol(root, frame);
+    }
+    if (!Is<Cell>(root)) {
+        return root;
+    }
+    if (Is<Symbol>(GetFirst(root))) {
+        const std::string& name = GetName(GetFirst(root));
+        Node args = GetSecond(root);
+        if (name == "quote") {
+            return AnalyzeQuote(args);
+        }
+        if (name == "if") {
+            return AnalyzeIf(args, frame);
+        }
+        if (name == "define") {
+            return AnalyzeDefine(args, frame);
+        }
+        if (name == "define-memoized") {
+            return AnalyzeDefine(args, frame, true);
+        }
+        if (name == "set!") {
+            return AnalyzeSet(args, frame);
+        }
+        if (name == "lambda") {
+            if (!Is<Cell>(args)) {
+                throw SyntaxError("Invalid number of arguments for lambda construction");
+            }
+            return AnalyzeLambda(GetFirst(args), GetSecond(args), frame);
+        }
+        if (name == "and") {
+            return Heap::GetInstance().Make<And>(AnalyzeEach(FormArguments(args), frame));
+        }
+        if (name == "or") {
+            return Heap::GetInstance().Make<Or>(AnalyzeEach(FormArguments(args), frame));
+        }
+    }
+    return AnalyzeCall(root, frame);
+}
+
+Node Analyze(Node root) {
+    return Analyze(root, nullptr);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "object.h"
+
+// Expands special forms of the syntax tree into dedicated nodes, so that malformed
+// ones are reported once and evaluation doesn't need any structural checks.
+Node Analyze(Node root);
@@ -0,0 +1,366 @@
+#include "bignum.h"
+
+#include <algorithm>
+
+using Limbs = BigInt::Limbs;
+
+// operands shorter than that are multiplied limb by limb
+constexpr size_t kKaratsubaThreshold = 32;
+
+// the largest power of ten in a limb, digits are converted in groups of nine
+constexpr uint32_t kDecimalBase = 1000000000;
+constexpr size_t kDecimalDigits = 9;
+
+void Trim(Limbs* limbs) {
+    while (!limbs->empty() && !limbs->back()) {
+        limbs->pop_back();
+    }
+}
+
+int CompareMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+    for (size_t i = lhs.size(); i-- > 0;) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] < rhs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+Limbs AddMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    const Limbs& longer = lhs.size() < rhs.size() ? rhs : lhs;
+    const Limbs& shorter = lhs.size() < rhs.size() ? lhs : rhs;
+    Limbs res(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        carry += static_cast<uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0);
+        res[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    res.back() = static_cast<uint32_t>(carry);
+    Trim(&res);
+    return res;
+}
+
+// lhs has to be at least rhs
+Limbs SubMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    Limbs res(lhs.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        int64_t diff = static_cast<int64_t>(lhs[i]) - borrow - (i < rhs.size() ? rhs[i] : 0);
+        borrow = diff < 0;
+        res[i] = static_cast<uint32_t>(diff);
+    }
+    Trim(&res);
+    return res;
+}
+
+// adds value shifted by offset limbs to res, which has room for the result
+void AddShifted(Limbs* res, const Limbs& value, size_t offset) {
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < value.size(); ++i) {
+        carry += static_cast<uint64_t>((*res)[offset + i]) + value[i];
+        (*res)[offset + i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    for (; carry; ++i) {
+        carry += (*res)[offset + i];
+        (*res)[offset + i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+}
+
+Limbs MultiplySchoolbook(const Limbs& lhs, const Limbs& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+        return {};
+    }
+    Limbs res(lhs.size() + rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < rhs.size(); ++j) {
+            carry += static_cast<uint64_t>(lhs[i]) * rhs[j] + res[i + j];
+            res[i + j] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        res[i + rhs.size()] = static_cast<uint32_t>(carry);
+    }
+    Trim(&res);
+    return res;
+}
+
+Limbs Slice(const Limbs& limbs, size_t begin, size_t end) {
+    end = std::min(end, limbs.size());
+    if (begin >= end) {
+        return {};
+    }
+    Limbs res(limbs.begin() + begin, limbs.begin() + end);
+    Trim(&res);
+    return res;
+}
+
+// splits both operands in halves and needs three products of them instead of four
+Limbs Multiply(const Limbs& lhs, const Limbs& rhs) {
+    if (lhs.size() < rhs.size()) {
+        return Multiply(rhs, lhs);
+    }
+    if (rhs.size() < kKaratsubaThreshold) {
+        return MultiplySchoolbook(lhs, rhs);
+    }
+    Limbs res(lhs.size() + rhs.size() + 1);
+    // lopsided operands are multiplied in pieces of the size of the shorter one
+    if (2 * rhs.size() <= lhs.size()) {
+        for (size_t i = 0; i < lhs.size(); i += rhs.size()) {
+            AddShifted(&res, Multiply(Slice(lhs, i, i + rhs.size()), rhs), i);
+        }
+        Trim(&res);
+        return res;
+    }
+
+    size_t half = lhs.size() / 2;
+    Limbs lhs_low = Slice(lhs, 0, half);
+    Limbs lhs_high = Slice(lhs, half, lhs.size());
+    Limbs rhs_low = Slice(rhs, 0, half);
+    Limbs rhs_high = Slice(rhs, half, rhs.size());
+    Limbs low = Multiply(lhs_low, rhs_low);
+    Limbs high = Multiply(lhs_high, rhs_high);
+    Limbs middle = Multiply(AddMagnitude(lhs_low, lhs_high), AddMagnitude(rhs_low, rhs_high));
+    middle = SubMagnitude(SubMagnitude(middle, low), high);
+    AddShifted(&res, low, 0);
+    AddShifted(&res, middle, half);
+    AddShifted(&res, high, 2 * half);
+    Trim(&res);
+    return res;
+}
+
+// divides limbs in place, returns the remainder
+uint32_t DivideSmall(Limbs* limbs, uint32_t divisor) {
+    uint64_t rest = 0;
+    for (size_t i = limbs->size(); i-- > 0;) {
+        rest = (rest << 32) | (*limbs)[i];
+        (*limbs)[i] = static_cast<uint32_t>(rest / divisor);
+        rest %= divisor;
+    }
+    Trim(limbs);
+    return static_cast<uint32_t>(rest);
+}
+
+void MultiplyAddSmall(Limbs* limbs, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (auto& limb : *limbs) {
+        carry += static_cast<uint64_t>(limb) * factor;
+        limb = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry) {
+        limbs->push_back(static_cast<uint32_t>(carry));
+    }
+}
+
+Limbs ShiftLeft(const Limbs& limbs, int shift, size_t extra) {
+    Limbs res(limbs.size() + extra);
+    uint32_t carry = 0;
+    for (size_t i = 0; i < limbs.size(); ++i) {
+        res[i] = (limbs[i] << shift) | carry;
+        carry = shift ? limbs[i] >> (32 - shift) : 0;
+    }
+    if (extra) {
+        res[limbs.size()] = carry;
+    }
+    return res;
+}
+
+// long division of magnitudes (Knuth, TAOCP vol. 2, algorithm D); the divisor is shifted
+// until its top bit is set, which keeps every estimated quotient limb at most 2 off
+Limbs DivideMagnitude(const Limbs& lhs, const Limbs& rhs) {
+    if (CompareMagnitude(lhs, rhs) < 0) {
+        return {};
+    }
+    if (rhs.size() == 1) {
+        Limbs res = lhs;
+        DivideSmall(&res, rhs[0]);
+        return res;
+    }
+    int shift = __builtin_clz(rhs.back());
+    Limbs divisor = ShiftLeft(rhs, shift, 0);
+    Limbs rest = ShiftLeft(lhs, shift, 1);
+    size_t n = divisor.size();
+    size_t m = rest.size() - n;
+    Limbs res(m);
+    for (size_t j = m; j-- > 0;) {
+        uint64_t top = (static_cast<uint64_t>(rest[j + n]) << 32) | rest[j + n - 1];
+        uint64_t estimate = top / divisor[n - 1];
+        uint64_t remainder = top % divisor[n - 1];
+        while (estimate >> 32 ||
+               estimate * divisor[n - 2] > ((remainder << 32) | rest[j + n - 2])) {
+            --estimate;
+            remainder += divisor[n - 1];
+            if (remainder >> 32) {
+                break;
+            }
+        }
+
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t product = estimate * divisor[i] + carry;
+            carry = product >> 32;
+            int64_t diff = static_cast<int64_t>(rest[i + j]) - borrow -
+                           static_cast<int64_t>(product & 0xffffffff);
+            rest[i + j] = static_cast<uint32_t>(diff);
+            borrow = diff < 0;
+        }
+        int64_t diff = static_cast<int64_t>(rest[j + n]) - borrow - static_cast<int64_t>(carry);
+        rest[j + n] = static_cast<uint32_t>(diff);
+
+        // the estimate was one too large
+        if (diff < 0) {
+            --estimate;
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; ++i) {
+                sum += static_cast<uint64_t>(rest[i + j]) + divisor[i];
+                rest[i + j] = static_cast<uint32_t>(sum);
+                sum >>= 32;
+            }
+            rest[j + n] += static_cast<uint32_t>(sum);
+        }
+        res[j] = static_cast<uint32_t>(estimate);
+    }
+    Trim(&res);
+    return res;
+}
+
+BigInt::BigInt(int64_t value) : negative_(value < 0) {
+    // the magnitude of the smallest value doesn't fit int64_t
+    uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value) : value;
+    for (; magnitude; magnitude >>= 32) {
+        limbs_.push_back(static_cast<uint32_t>(magnitude));
+    }
+}
+
+BigInt::BigInt(bool negative, Limbs limbs) : negative_(negative), limbs_(std::move(limbs)) {
+    Trim(&limbs_);
+    if (limbs_.empty()) {
+        negative_ = false;
+    }
+}
+
+BigInt BigInt::Parse(const std::string& digits) {
+    size_t pos = 0;
+    bool negative = false;
+    if (!digits.empty() && (digits[0] == '-' || digits[0] == '+')) {
+        negative = digits[0] == '-';
+        pos = 1;
+    }
+    Limbs limbs;
+    while (pos < digits.size()) {
+        size_t count = std::min(kDecimalDigits, digits.size() - pos);
+        uint32_t group = 0;
+        uint32_t factor = 1;
+        for (size_t i = 0; i < count; ++i) {
+            group = group * 10 + (digits[pos + i] - '0');
+            factor *= 10;
+        }
+        MultiplyAddSmall(&limbs, factor, group);
+        pos += count;
+    }
+    return BigInt(negative, std::move(limbs));
+}
+
+bool BigInt::ToInt64(int64_t* value) const {
+    if (limbs_.size() > 2) {
+        return false;
+    }
+    uint64_t magnitude = 0;
+    for (size_t i = limbs_.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | limbs_[i];
+    }
+    if (negative_) {
+        if (magnitude > static_cast<uint64_t>(INT64_MAX) + 1) {
+            return false;
+        }
+        *value = static_cast<int64_t>(0 - magnitude);
+        return true;
+    }
+    if (magnitude > static_cast<uint64_t>(INT64_MAX)) {
+        return false;
+    }
+    *value = static_cast<int64_t>(magnitude);
+    return true;
+}
+
+double BigInt::ToDouble() const {
+    double res = 0;
+    for (size_t i = limbs_.size(); i-- > 0;) {
+        res = res * 4294967296.0 + limbs_[i];
+    }
+    return negative_ ? -res : res;
+}
+
+std::string BigInt::ToString() const {
+    if (limbs_.empty()) {
+        return "0";
+    }
+    Limbs rest = limbs_;
+    std::vector<uint32_t> groups;
+    while (!rest.empty()) {
+        groups.push_back(DivideSmall(&rest, kDecimalBase));
+    }
+    std::string res = negative_ ? "-" : "";
+    res += std::to_string(groups.back());
+    for (size_t i = groups.size() - 1; i-- > 0;) {
+        std::string group = std::to_string(groups[i]);
+        res.append(kDecimalDigits - group.size(), '0');
+        res += group;
+    }
+    return res;
+}
+
+size_t BigInt::Hash() const {
+    size_t res = negative_;
+    for (auto limb : limbs_) {
+        res = res * 1000003 + limb;
+    }
+    return res;
+}
+
+BigInt BigInt::operator-() const {
+    return BigInt(!negative_, limbs_);
+}
+
+BigInt BigInt::Abs() const {
+    return BigInt(false, limbs_);
+}
+
+BigInt operator+(const BigInt& lhs, const BigInt& rhs) {
+    if (lhs.negative_ == rhs.negative_) {
+        return BigInt(lhs.negative_, AddMagnitude(lhs.limbs_, rhs.limbs_));
+    }
+    // the sign of the one with the larger magnitude wins
+    if (CompareMagnitude(lhs.limbs_, rhs.limbs_) >= 0) {
+        return BigInt(lhs.negative_, SubMagnitude(lhs.limbs_, rhs.limbs_));
+    }
+    return BigInt(rhs.negative_, SubMagnitude(rhs.limbs_, lhs.limbs_));
+}
+
+BigInt operator-(const BigInt& lhs, const BigInt& rhs) {
+    return lhs + -rhs;
+}
+
+BigInt operator*(const BigInt& lhs, const BigInt& rhs) {
+    return BigInt(lhs.negative_ != rhs.negative_, Multiply(lhs.limbs_, rhs.limbs_));
+}
+
+BigInt operator/(const BigInt& lhs, const BigInt& rhs) {
+    return BigInt(lhs.negative_ != rhs.negative_, DivideMagnitude(lhs.limbs_, rhs.limbs_));
+}
+
+int Compare(const BigInt& lhs, const BigInt& rhs) {
+    if (lhs.negative_ != rhs.negative_) {
+        return lhs.negative_ ? -1 : 1;
+    }
+    int res = CompareMagnitude(lhs.limbs_, rhs.limbs_);
+    return lhs.negative_ ? -res : res;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Integers of any size for results that don't fit a Number. The magnitude is kept in 32 bit
+// limbs, least significant first, without leading zero limbs, so zero has none.
+
+class BigInt {
+public:
+    using Limbs = std::vector<uint32_t>;
+
+    BigInt() = default;
+    explicit BigInt(int64_t value);
+
+    // decimal digits with an optional sign
+    static BigInt Parse(const std::string& digits);
+
+    bool IsZero() const {
+        return limbs_.empty();
+    }
+
+    bool IsNegative() const {
+        return negative_;
+    }
+
+    // false if the value is out of the range of int64_t
+    bool ToInt64(int64_t* value) const;
+
+    // nearest double up to rounding of the low limbs, infinity if it's too large
+    double ToDouble() const;
+
+    std::string ToString() const;
+
+    size_t Hash() const;
+
+    BigInt operator-() const;
+    BigInt Abs() const;
+
+    friend BigInt operator+(const BigInt& lhs, const BigInt& rhs);
+    friend BigInt operator-(const BigInt& lhs, const BigInt& rhs);
+    friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
+    // rounds towards zero like the division of fixnums, the divisor must not be zero
+    friend BigInt operator/(const BigInt& lhs, const BigInt& rhs);
+
+    // negative, zero or positive like lhs - rhs
+    friend int Compare(const BigInt& lhs, const BigInt& rhs);
+
+private:
+    BigInt(bool negative, Limbs limbs);
+
+    bool negative_ = false;
+    Limbs limbs_;
+};
+
+// integer operations that report a result out of the range of int64_t instead of wrapping
+inline bool AddOverflow(int64_t lhs, int64_t rhs, int64_t* res) {
+    return __builtin_add_overflow(lhs, rhs, res);
+}
+
+inline bool SubOverflow(int64_t lhs, int64_t rhs, int64_t* res) {
+    return __builtin_sub_overflow(lhs, rhs, res);
+}
+
+inline bool MulOverflow(int64_t lhs, int64_t rhs, int64_t* res) {
+    return __builtin_mul_overflow(lhs, rhs, res);
+}
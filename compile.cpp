@@ -0,0 +1,286 @@
+#include "scheme.h"
+
+#include "error.h"
+
+#include <memory>
+#include <vector>
+
+// Every node becomes a closure that knows what it is: the cached binding of a global, the
+// slot of a local, the compiled operator and arguments of a call. Evaluating one doesn't
+// look at the shape of the syntax tree again.
+
+// A call whose value is only read by the builtin it is passed to, like the product in
+// (+ (* a b) c), makes it in the scratch area of the scope instead of the heap. Arguments
+// are compiled both ways, which one runs depends on what the call applies, which is only
+// known at runtime, see Object::ReadsArguments. The temporaries are released when the
+// outermost call reading them returns.
+
+// releases the temporaries made for the arguments of a call
+class ScratchGuard {
+public:
+    explicit ScratchGuard(Scope* scope)
+        : scope_(scope), position_(scope->GetScratch().GetPosition()) {
+    }
+
+    ~ScratchGuard() {
+        scope_->GetScratch().Release(position_);
+    }
+
+private:
+    Scope* scope_;
+    ScratchArea::Position position_;
+};
+
+// the closures of a call for its value and for a temporary
+std::pair<Compiled, Compiled> CompileCall(Node root);
+
+// the element closures of a proper argument list, calls with anything else keep the syntax;
+// temporaries differ from args for the elements that are calls
+bool CompileArguments(Node root, std::vector<Compiled>* args,
+                      std::vector<Compiled>* temporaries) {
+    for (; Is<Cell>(root); root = GetSecond(root)) {
+        Node arg = GetFirst(root);
+        // (f a . 'b) and () arguments are special cased by ParseArguments
+        if (!arg || (Is<Symbol>(arg) && GetName(arg) == "quote")) {
+            return false;
+        }
+        if (Is<Cell>(arg)) {
+            auto [value, temporary] = CompileCall(arg);
+            args->push_back(value);
+            temporaries->push_back(temporary);
+        } else {
+            args->push_back(Compile(arg));
+            temporaries->push_back(args->back());
+        }
+    }
+    return !root;
+}
+
+// what the closures of a call share, so nested calls aren't copied for each
+struct CallSite {
+    // the operator, through the cache of the call when it is a global
+    Node Head(Scope* scope) {
+        Node func = symbol ? scope->ResolveSymbol(symbol->GetName(), &cache) : head(scope);
+        if (!func) {
+            throw RuntimeError("Object not callable");
+        }
+        return func;
+    }
+
+    const Symbol* symbol = nullptr;
+    InlineCache cache;
+    Compiled head;
+    std::vector<Compiled> args;
+    std::vector<Compiled> temporaries;
+};
+
+std::pair<Compiled, Compiled> CompileCall(Node root) {
+    auto site = std::make_shared<CallSite>();
+    site->symbol = As<Symbol>(GetFirst(root));
+    if (!site->symbol) {
+        site->head = Compile(GetFirst(root));
+    }
+    Node syntax = GetSecond(root);
+    if (!CompileArguments(syntax, &site->args, &site->temporaries)) {
+        Compiled run = [site, syntax](Scope* scope) {
+            return site->Head(scope)->Run(scope, syntax);
+        };
+        return {run, run};
+    }
+
+    bool calls = false;
+    for (Node cur = syntax; cur; cur = GetSecond(cur)) {
+        calls |= Is<Cell>(GetFirst(cur));
+    }
+    Compiled value;
+    if (!calls) {
+        value = [site, syntax](Scope* scope) {
+            return site->Head(scope)->Invoke(scope, site->args, syntax);
+        };
+    } else {
+        value = [site, syntax](Scope* scope) {
+            Node func = site->Head(scope);
+            if (!func->ReadsArguments(site->args.size())) {
+                return func->Invoke(scope, site->args, syntax);
+            }
+            ScratchGuard guard(scope);
+            return func->Invoke(scope, site->temporaries, syntax);
+        };
+    }
+    // released by the call reading it
+    Compiled temporary = [site, syntax](Scope* scope) {
+        Node func = site->Head(scope);
+        bool reads = func->ReadsArguments(site->args.size());
+        return func->InvokeTemporary(scope, reads ? site->temporaries : site->args, syntax);
+    };
+    return {value, temporary};
+}
+
+Compiled Compile(Node root) {
+    if (!root) {
+        return [](Scope*) -> Node { throw RuntimeError("Evaluating null not allowed"); };
+    }
+    if (IsSelfEvaluating(root)) {
+        return [root](Scope*) { return root; };
+    }
+    if (auto symbol = As<Symbol>(root)) {
+        auto cache = std::make_shared<InlineCache>();
+        return [symbol, cache](Scope* scope) {
+            return scope->ResolveSymbol(symbol->GetName(), cache.get());
+        };
+    }
+    if (auto form = As<SpecialForm>(root)) {
+        return form->Compile();
+    }
+    if (!Is<Cell>(root)) {
+        return [](Scope*) -> Node { throw RuntimeError("Unknown object type to evaluate"); };
+    }
+    return CompileCall(root).first;
+}
+
+std::vector<Compiled> CompileEach(const std::vector<Node>& exprs) {
+    std::vector<Compiled> res;
+    res.reserve(exprs.size());
+    for (auto expr : exprs) {
+        res.push_back(Compile(expr));
+    }
+    return res;
+}
+
+Compiled Quote::Compile() {
+    return [datum = datum_](Scope*) { return datum; };
+}
+
+Node Checked(Node value) {
+    if (value == Unassigned()) {
+        throw NameError("Variable used before its definition");
+    }
+    return value;
+}
+
+Compiled LocalVariable::Compile() {
+    size_t index = index_;
+    if (captured_ && boxed_) {
+        return [index](Scope* scope) {
+            return Checked(As<Box>(scope->GetFrame()->closure->GetCaptures()[index])->Get());
+        };
+    }
+    if (captured_) {
+        return [index](Scope* scope) {
+            return Checked(scope->GetFrame()->closure->GetCaptures()[index]);
+        };
+    }
+    if (boxed_) {
+        return [index](Scope* scope) {
+            return Checked(As<Box>(scope->GetFrame()->slots[index])->Get());
+        };
+    }
+    return [index](Scope* scope) { return Checked(scope->GetFrame()->slots[index]); };
+}
+
+Compiled LocalAssignment::Compile() {
+    size_t index = index_;
+    Compiled value = ::Compile(value_);
+    if (captured_ && boxed_) {
+        return [index, value](Scope* scope) -> Node {
+            Node res = value(scope);
+            As<Box>(scope->GetFrame()->closure->GetCaptures()[index])->Get() = res;
+            return nullptr;
+        };
+    }
+    if (captured_) {
+        return [index, value](Scope* scope) -> Node {
+            Node res = value(scope);
+            scope->GetFrame()->closure->GetCaptures()[index] = res;
+            return nullptr;
+        };
+    }
+    if (boxed_) {
+        return [index, value](Scope* scope) -> Node {
+            Node res = value(scope);
+            As<Box>(scope->GetFrame()->slots[index])->Get() = res;
+            return nullptr;
+        };
+    }
+    return [index, value](Scope* scope) -> Node {
+        Node res = value(scope);
+        scope->GetFrame()->slots[index] = res;
+        return nullptr;
+    };
+}
+
+Compiled If::Compile() {
+    Compiled condition = ::Compile(condition_);
+    Compiled then_branch = ::Compile(then_branch_);
+    if (!has_else_) {
+        return [condition, then_branch](Scope* scope) -> Node {
+            if (IsTrue(condition(scope))) {
+                return then_branch(scope);
+            }
+            return nullptr;
+        };
+    }
+    Compiled else_branch = ::Compile(else_branch_);
+    return [condition, then_branch, else_branch](Scope* scope) {
+        if (IsTrue(condition(scope))) {
+            return then_branch(scope);
+        }
+        return else_branch(scope);
+    };
+}
+
+Compiled Define::Compile() {
+    return [name = name_, value = ::Compile(value_)](Scope* scope) -> Node {
+        scope->Define(name, value(scope));
+        return nullptr;
+    };
+}
+
+Compiled Set::Compile() {
+    return [name = name_, value = ::Compile(value_)](Scope* scope) -> Node {
+        scope->Set(name, value(scope));
+        return nullptr;
+    };
+}
+
+Compiled ConstructLambda::Compile() {
+    compiled_body_.clear();
+    for (Node cur = body_; cur; cur = GetSecond(cur)) {
+        compiled_body_.push_back(::Compile(GetFirst(cur)));
+    }
+    return [this](Scope* scope) { return Eval(scope); };
+}
+
+Compiled And::Compile() {
+    return [args = CompileEach(args_)](Scope* scope) {
+        Node res = Bool(scope, 1);
+        for (auto& arg : args) {
+            res = arg(scope);
+            if (IsFalse(res)) {
+                return res;
+            }
+        }
+        return res;
+    };
+}
+
+Compiled Or::Compile() {
+    return [args = CompileEach(args_)](Scope* scope) {
+        Node res = Bool(scope, 0);
+        for (auto& arg : args) {
+            res = arg(scope);
+            if (IsTrue(res)) {
+                return res;
+            }
+        }
+        return res;
+    };
+}
+
+Compiled Guard::Compile() {
+    Compiled optimized = ::Compile(optimized_);
+    Compiled original = ::Compile(original_);
+    return [this, optimized, original](Scope* scope) {
+        return Holds() ? optimized(scope) : original(scope);
+    };
+}
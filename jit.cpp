@@ -0,0 +1,860 @@
+#include "jit.h"
+
+#include "object.h"
+#include "scheme.h"
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+NativeCode::~NativeCode() {
+#if defined(__x86_64__) && defined(__linux__)
+    if (memory_) {
+        munmap(memory_, size_);
+    }
+#endif
+}
+
+bool NativeCode::Load(const unsigned char* code, size_t size) {
+#if defined(__x86_64__) && defined(__linux__)
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    std::memcpy(memory, code, size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC)) {
+        munmap(memory, size);
+        return false;
+    }
+    memory_ = memory;
+    size_ = size;
+    function_ = reinterpret_cast<Function>(memory);
+    return true;
+#else
+    (void)code;
+    (void)size;
+    return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// runtime helpers called from compiled code
+
+// exceptions never unwind through compiled frames: helpers store them here and return
+// JitError(), compiled code passes it up to RunNative which rethrows
+class JitSignal : public Object {};
+
+Node JitError() {
+    static JitSignal value;
+    return &value;
+}
+
+// returned before the body runs if a global the code was specialized on changed
+Node JitDeoptimized() {
+    static JitSignal value;
+    return &value;
+}
+
+// native code that may still be running in some outer frame, unmapped by the next RunGC
+// which only happens between evaluations
+class RetiredCode : public Object {
+    friend class Heap;
+
+protected:
+    RetiredCode(NativeCode* code) {
+        code_.Swap(*code);
+    }
+
+private:
+    NativeCode code_;
+};
+
+thread_local std::exception_ptr pending_error;
+
+Node JitEvaluate(Scope* scope, Node root) {
+    try {
+        return Evaluate(scope, root);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return JitError();
+    }
+}
+
+Node JitApply(Scope* scope, Node callee, Node* args, size_t count) {
+    try {
+        return As<Lambda>(callee)->Apply(scope, args, count);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return JitError();
+    }
+}
+
+// builtin op applied to values that missed the inline fast path
+Node JitBinary(Scope* scope, Node op, Node lhs, Node rhs) {
+    try {
+        auto& heap = Heap::GetInstance();
+        Node args = heap.Make<Cell>(heap.Make<Quote>(lhs),
+                                    heap.Make<Cell>(heap.Make<Quote>(rhs), nullptr));
+        return op->Run(scope, args);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return JitError();
+    }
+}
+
+Node JitMakeNumber(int64_t value) {
+    try {
+        return Heap::GetInstance().Make<Number>(value);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return JitError();
+    }
+}
+
+bool JitIsFalse(Node value) {
+    return IsFalse(value);
+}
+
+bool RunNative(Scope* scope, ConstructLambda* code, Frame* frame, Node* res) {
+    TierState& tier = code->GetTier();
+    *res = tier.native.Get()(scope, frame->slots, frame->closure->GetCaptures());
+    if (*res == JitError()) {
+        std::rethrow_exception(std::exchange(pending_error, nullptr));
+    }
+    if (*res == JitDeoptimized()) {
+        Heap::GetInstance().Make<RetiredCode>(&tier.native);
+        tier.calls = 0;
+        tier.iterations = 0;
+        ++scope->GetTierStats().deoptimizations;
+        return false;
+    }
+    return true;
+}
+
+#if defined(__x86_64__) && defined(__linux__)
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// assembler, only the handful of instructions the compiler emits
+
+enum Register {
+    kRax = 0,
+    kRcx,
+    kRdx,
+    kRbx,
+    kRsp,
+    kRbp,
+    kRsi,
+    kRdi,
+    kR8,
+    kR9,
+    kR10,
+    kR11,
+    kR12,
+    kR13,
+    kR14,
+    kR15
+};
+
+enum Condition {
+    kOverflow = 0x0,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kLess = 0xc,
+    kGreaterEqual = 0xd,
+    kLessEqual = 0xe,
+    kGreater = 0xf
+};
+
+Condition Negate(Condition cc) {
+    return static_cast<Condition>(cc ^ 1);
+}
+
+// jump target, jumps emitted before Bind are patched by it
+struct Label {
+    int64_t position = -1;
+    std::vector<size_t> uses;
+};
+
+class Assembler {
+public:
+    std::vector<unsigned char>& GetCode() {
+        return code_;
+    }
+
+    size_t GetSize() const {
+        return code_.size();
+    }
+
+    void Patch32(size_t at, int32_t value) {
+        std::memcpy(code_.data() + at, &value, sizeof(value));
+    }
+
+    void Bind(Label* label) {
+        label->position = code_.size();
+        for (auto use : label->uses) {
+            Patch32(use, label->position - (use + 4));
+        }
+        label->uses.clear();
+    }
+
+    void Jump(Label* label) {
+        Byte(0xe9);
+        Target(label);
+    }
+
+    void JumpIf(Condition cc, Label* label) {
+        Byte(0x0f);
+        Byte(0x80 + cc);
+        Target(label);
+    }
+
+    void Push(Register reg) {
+        Rex(false, 0, reg);
+        Byte(0x50 + (reg & 7));
+    }
+
+    void Pop(Register reg) {
+        Rex(false, 0, reg);
+        Byte(0x58 + (reg & 7));
+    }
+
+    void Call(Register reg) {
+        Rex(false, 0, reg);
+        Byte(0xff);
+        Direct(2, reg);
+    }
+
+    void Ret() {
+        Byte(0xc3);
+    }
+
+    void Move(Register dst, Register src) {
+        Rex(true, src, dst);
+        Byte(0x89);
+        Direct(src, dst);
+    }
+
+    void MoveImm(Register dst, uint64_t imm) {
+        Rex(true, 0, dst);
+        Byte(0xb8 + (dst & 7));
+        for (int i = 0; i < 8; ++i) {
+            Byte(imm >> (8 * i));
+        }
+    }
+
+    void MoveImm(Register dst, const void* ptr) {
+        MoveImm(dst, reinterpret_cast<uint64_t>(ptr));
+    }
+
+    void Load(Register dst, Register base, int32_t disp) {
+        Rex(true, dst, base);
+        Byte(0x8b);
+        Memory(dst, base, disp);
+    }
+
+    void Store(Register base, int32_t disp, Register src) {
+        Rex(true, src, base);
+        Byte(0x89);
+        Memory(src, base, disp);
+    }
+
+    // movsxd, sign extends a 32 bit value
+    void LoadInt32(Register dst, Register base, int32_t disp) {
+        Rex(true, dst, base);
+        Byte(0x63);
+        Memory(dst, base, disp);
+    }
+
+    void Extend32(Register dst, Register src) {
+        Rex(true, dst, src);
+        Byte(0x63);
+        Direct(dst, src);
+    }
+
+    void Lea(Register dst, Register base, int32_t disp) {
+        Rex(true, dst, base);
+        Byte(0x8d);
+        Memory(dst, base, disp);
+    }
+
+    void SubImm(Register dst, int32_t imm) {
+        Rex(true, 0, dst);
+        Byte(0x81);
+        Direct(5, dst);
+        Int32(imm);
+    }
+
+    // the 32 bit forms take wide = false
+    void Add(Register dst, Register src, bool wide) {
+        Rex(wide, src, dst);
+        Byte(0x01);
+        Direct(src, dst);
+    }
+
+    void Sub(Register dst, Register src, bool wide) {
+        Rex(wide, src, dst);
+        Byte(0x29);
+        Direct(src, dst);
+    }
+
+    void Cmp(Register lhs, Register rhs, bool wide = true) {
+        Rex(wide, rhs, lhs);
+        Byte(0x39);
+        Direct(rhs, lhs);
+    }
+
+    void Test(Register lhs, Register rhs) {
+        Rex(true, rhs, lhs);
+        Byte(0x85);
+        Direct(rhs, lhs);
+    }
+
+    // test al, al
+    void TestByte() {
+        Byte(0x84);
+        Byte(0xc0);
+    }
+
+private:
+    void Byte(unsigned value) {
+        code_.push_back(value & 0xff);
+    }
+
+    void Int32(int32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            Byte(static_cast<uint32_t>(value) >> (8 * i));
+        }
+    }
+
+    void Rex(bool wide, int reg, int rm) {
+        unsigned rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | (rm >> 3);
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+    }
+
+    void Direct(int reg, int rm) {
+        Byte(0xc0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    // [base + disp32], rsp and r12 as a base need a SIB byte
+    void Memory(int reg, int base, int32_t disp) {
+        Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == kRsp) {
+            Byte(0x24);
+        }
+        Int32(disp);
+    }
+
+    void Target(Label* label) {
+        if (label->position >= 0) {
+            Int32(label->position - static_cast<int64_t>(code_.size() + 4));
+        } else {
+            label->uses.push_back(code_.size());
+            Int32(0);
+        }
+    }
+
+    std::vector<unsigned char> code_;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// compiler
+//
+// Template compiler: every expression leaves its value in rax. Globals are read straight
+// from their bindings, local variables from the frame, calls of +, -, comparisons and
+// lambdas are inlined behind a check of the type of the bound value and of the arguments.
+// Anything else, and every failed check, is handed back to the interpreter.
+//
+// Registers kept for the whole body: rbx scope, r12 frame slots, r13 closure captures,
+// r14 JitError(), r15 vtable of Number. Temporaries live below the saved registers.
+
+class JitCompiler {
+public:
+    JitCompiler(Scope* scope, ConstructLambda* code) : scope_(scope), code_(code) {
+        Number probe(0);
+        number_vtable_ = VTable(&probe);
+        value_offset_ = reinterpret_cast<char*>(&probe.value_) - reinterpret_cast<char*>(&probe);
+        true_slot_ = GlobalSlot("#t");
+        false_slot_ = GlobalSlot("#f");
+    }
+
+    bool Compile(NativeCode* native);
+
+    // the body is valid while the epochs of these globals stay the same
+    struct Dependency {
+        const uint64_t* epoch;
+        uint64_t expected;
+    };
+
+private:
+    static constexpr int32_t kSavedSize = 5 * 8;
+    static constexpr bool kWideValue = sizeof(Number::value_) == 8;
+
+    enum class Op { kNone, kAdd, kSub, kCompare, kLambda };
+
+    static const void* VTable(Node value) {
+        return *reinterpret_cast<void* const*>(value);
+    }
+
+    // binding of a global defined at compile time, bindings never move
+    Node* GlobalSlot(const std::string& name) {
+        return scope_->Lookup(name);
+    }
+
+    int32_t TempOffset(size_t temp) const {
+        return -kSavedSize - 8 * static_cast<int32_t>(temp + 1);
+    }
+
+    size_t AllocateTemps(size_t count) {
+        size_t res = temps_;
+        temps_ += count;
+        max_temps_ = std::max(max_temps_, temps_);
+        return res;
+    }
+
+    void ReleaseTemps(size_t count) {
+        temps_ -= count;
+    }
+
+    void CallHelper(const void* function) {
+        as_.MoveImm(kRax, function);
+        as_.Call(kRax);
+    }
+
+    void CheckError() {
+        as_.Cmp(kRax, kR14);
+        as_.JumpIf(kEqual, &error_);
+    }
+
+    void Generic(Node root) {
+        as_.Move(kRdi, kRbx);
+        as_.MoveImm(kRsi, root);
+        CallHelper(reinterpret_cast<const void*>(&JitEvaluate));
+        CheckError();
+    }
+
+    // also used for other 64 bit values at a fixed address
+    void LoadGlobal(Register dst, const void* slot) {
+        as_.MoveImm(dst, slot);
+        as_.Load(dst, dst, 0);
+    }
+
+    // jumps to fail unless the global bound at slot has the same type as value, leaves it in rax
+    void Guard(Node* slot, Node value, Label* fail) {
+        LoadGlobal(kRax, slot);
+        as_.Test(kRax, kRax);
+        as_.JumpIf(kEqual, fail);
+        as_.Load(kRcx, kRax, 0);
+        as_.MoveImm(kRdx, VTable(value));
+        as_.Cmp(kRcx, kRdx);
+        as_.JumpIf(kNotEqual, fail);
+    }
+
+    void CheckNumber(Register reg, Label* fail) {
+        as_.Test(reg, reg);
+        as_.JumpIf(kEqual, fail);
+        as_.Load(kRcx, reg, 0);
+        as_.Cmp(kRcx, kR15);
+        as_.JumpIf(kNotEqual, fail);
+    }
+
+    void LoadValue(Register dst, Register number) {
+        if (kWideValue) {
+            as_.Load(dst, number, value_offset_);
+        } else {
+            as_.LoadInt32(dst, number, value_offset_);
+        }
+    }
+
+    void Depend(const std::string& name) {
+        const uint64_t* epoch = scope_->GetEpoch(name);
+        for (auto& dependency : dependencies_) {
+            if (dependency.epoch == epoch) {
+                return;
+            }
+        }
+        dependencies_.push_back({epoch, *epoch});
+    }
+
+    void Expression(Node root);
+    void IfForm(If* root);
+    void GuardForm(::Guard* root);
+    void Call(Node root);
+    void Binary(Node root, Op op, Condition cc, Node* slot, Node lhs, Node rhs, Label* false_label);
+    void LambdaCall(Node root, Node* slot, const std::vector<Node>& args);
+    void Branch(Node root, Label* false_label);
+    void Truth(Label* false_label);
+
+    // operation a call of the global bound at slot compiles to, cc is set for comparisons
+    Op Classify(Node* slot, size_t arity, Condition* cc) const;
+    bool Arguments(Node root, std::vector<Node>* args) const;
+
+    Scope* scope_;
+    ConstructLambda* code_;
+    Assembler as_;
+    Label error_;
+    std::vector<Dependency> dependencies_;
+    size_t temps_ = 0;
+    size_t max_temps_ = 0;
+    const void* number_vtable_;
+    int32_t value_offset_;
+    Node* true_slot_;
+    Node* false_slot_;
+};
+
+bool JitCompiler::Compile(NativeCode* native) {
+    as_.Push(kRbp);
+    as_.Move(kRbp, kRsp);
+    as_.Push(kRbx);
+    as_.Push(kR12);
+    as_.Push(kR13);
+    as_.Push(kR14);
+    as_.Push(kR15);
+    as_.SubImm(kRsp, 0);
+    size_t frame_size_at = as_.GetSize() - 4;
+    as_.Move(kRbx, kRdi);
+    as_.Move(kR12, kRsi);
+    as_.Move(kR13, kRdx);
+    as_.MoveImm(kR14, JitError());
+    as_.MoveImm(kR15, number_vtable_);
+    // the dependencies are only known after the body, their checks go after it
+    Label check, body, exit;
+    as_.Jump(&check);
+
+    as_.Bind(&body);
+    as_.MoveImm(kRax, uint64_t{0});
+    for (Node cur = code_->GetBody(); cur; cur = GetSecond(cur)) {
+        Expression(GetFirst(cur));
+    }
+    as_.Jump(&exit);
+
+    Label deoptimize;
+    as_.Bind(&check);
+    for (auto [epoch, expected] : dependencies_) {
+        LoadGlobal(kRax, epoch);
+        as_.MoveImm(kRcx, expected);
+        as_.Cmp(kRax, kRcx);
+        as_.JumpIf(kNotEqual, &deoptimize);
+    }
+    as_.Jump(&body);
+    as_.Bind(&deoptimize);
+    as_.MoveImm(kRax, JitDeoptimized());
+    as_.Jump(&exit);
+
+    as_.Bind(&error_);
+    as_.Move(kRax, kR14);
+    as_.Bind(&exit);
+    as_.Lea(kRsp, kRbp, -kSavedSize);
+    as_.Pop(kR15);
+    as_.Pop(kR14);
+    as_.Pop(kR13);
+    as_.Pop(kR12);
+    as_.Pop(kRbx);
+    as_.Pop(kRbp);
+    as_.Ret();
+
+    // calls need rsp aligned to 16, the return address and rbp make up the other 16 bytes
+    int32_t frame_size = 8 * max_temps_;
+    if ((kSavedSize + frame_size) % 16) {
+        frame_size += 8;
+    }
+    as_.Patch32(frame_size_at, frame_size);
+    return native->Load(as_.GetCode().data(), as_.GetSize());
+}
+
+void JitCompiler::Expression(Node root) {
+    if (IsSelfEvaluating(root)) {
+        as_.MoveImm(kRax, root);
+        return;
+    }
+    if (auto quote = As<Quote>(root)) {
+        as_.MoveImm(kRax, quote->GetDatum());
+        return;
+    }
+    if (auto var = As<LocalVariable>(root)) {
+        // internal definitions may still be unassigned, the interpreter reports that
+        if (!var->IsBoxed() && (var->IsCaptured() || var->GetIndex() < code_->GetArity())) {
+            as_.Load(kRax, var->IsCaptured() ? kR13 : kR12, 8 * var->GetIndex());
+            return;
+        }
+    } else if (Is<Symbol>(root)) {
+        if (auto slot = GlobalSlot(GetName(root))) {
+            LoadGlobal(kRax, slot);
+            return;
+        }
+    } else if (auto form = As<If>(root)) {
+        IfForm(form);
+        return;
+    } else if (auto guard = As<::Guard>(root)) {
+        GuardForm(guard);
+        return;
+    } else if (Is<Cell>(root) && Is<Symbol>(GetFirst(root))) {
+        Call(root);
+        return;
+    }
+    Generic(root);
+}
+
+void JitCompiler::IfForm(If* root) {
+    Label else_branch, done;
+    Branch(root->GetCondition(), &else_branch);
+    Expression(root->GetThen());
+    as_.Jump(&done);
+    as_.Bind(&else_branch);
+    if (root->HasElse()) {
+        Expression(root->GetElse());
+    } else {
+        as_.MoveImm(kRax, uint64_t{0});
+    }
+    as_.Bind(&done);
+}
+
+void JitCompiler::GuardForm(::Guard* root) {
+    Label original, done;
+    for (auto [epoch, expected] : root->GetDependencies()) {
+        LoadGlobal(kRax, epoch);
+        as_.MoveImm(kRcx, expected);
+        as_.Cmp(kRax, kRcx);
+        as_.JumpIf(kNotEqual, &original);
+    }
+    Expression(root->GetOptimized());
+    as_.Jump(&done);
+    as_.Bind(&original);
+    Expression(root->GetOriginal());
+    as_.Bind(&done);
+}
+
+// jumps to false_label if the value in rax is false
+void JitCompiler::Truth(Label* false_label) {
+    Label true_label;
+    if (false_slot_ && true_slot_) {
+        LoadGlobal(kRcx, false_slot_);
+        as_.Cmp(kRax, kRcx);
+        as_.JumpIf(kEqual, false_label);
+        LoadGlobal(kRcx, true_slot_);
+        as_.Cmp(kRax, kRcx);
+        as_.JumpIf(kEqual, &true_label);
+    }
+    as_.Move(kRdi, kRax);
+    CallHelper(reinterpret_cast<const void*>(&JitIsFalse));
+    as_.TestByte();
+    as_.JumpIf(kNotEqual, false_label);
+    as_.Bind(&true_label);
+}
+
+// falls through if root is true, comparisons branch without making a boolean
+void JitCompiler::Branch(Node root, Label* false_label) {
+    std::vector<Node> args;
+    if (Is<Cell>(root) && Is<Symbol>(GetFirst(root)) && Arguments(root, &args)) {
+        Condition cc;
+        const std::string& name = GetName(GetFirst(root));
+        Node* slot = GlobalSlot(name);
+        if (Classify(slot, args.size(), &cc) == Op::kCompare) {
+            Depend(name);
+            Binary(root, Op::kCompare, cc, slot, args[0], args[1], false_label);
+            return;
+        }
+    }
+    Expression(root);
+    Truth(false_label);
+}
+
+bool JitCompiler::Arguments(Node root, std::vector<Node>* args) const {
+    Node cur = GetSecond(root);
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        Node arg = GetFirst(cur);
+        // the raw tail of (f a . 'b) is left to the interpreter
+        if (Is<Symbol>(arg) && GetName(arg) == "quote") {
+            return false;
+        }
+        args->push_back(arg);
+    }
+    return !cur;
+}
+
+JitCompiler::Op JitCompiler::Classify(Node* slot, size_t arity, Condition* cc) const {
+    if (!slot || !*slot) {
+        return Op::kNone;
+    }
+    Node value = *slot;
+    if (Is<Lambda>(value)) {
+        return Op::kLambda;
+    }
+    if (arity != 2) {
+        return Op::kNone;
+    }
+    if (Is<Plus>(value)) {
+        return Op::kAdd;
+    }
+    if (Is<Minus>(value)) {
+        return Op::kSub;
+    }
+    if (Is<IsSmaller>(value)) {
+        *cc = kLess;
+    } else if (Is<IsEqual>(value)) {
+        *cc = kEqual;
+    } else if (Is<IsGreater>(value)) {
+        *cc = kGreater;
+    } else if (Is<IsLeq>(value)) {
+        *cc = kLessEqual;
+    } else if (Is<IsGeq>(value)) {
+        *cc = kGreaterEqual;
+    } else {
+        return Op::kNone;
+    }
+    return true_slot_ && false_slot_ ? Op::kCompare : Op::kNone;
+}
+
+void JitCompiler::Call(Node root) {
+    std::vector<Node> args;
+    if (!Arguments(root, &args)) {
+        Generic(root);
+        return;
+    }
+    Condition cc = kEqual;
+    const std::string& name = GetName(GetFirst(root));
+    Node* slot = GlobalSlot(name);
+    auto op = Classify(slot, args.size(), &cc);
+    if (op != Op::kNone) {
+        Depend(name);
+    }
+    switch (op) {
+        case Op::kAdd:
+        case Op::kSub:
+        case Op::kCompare:
+            Binary(root, op, cc, slot, args[0], args[1], nullptr);
+            return;
+        case Op::kLambda:
+            LambdaCall(root, slot, args);
+            return;
+        case Op::kNone:
+            Generic(root);
+            return;
+    }
+}
+
+// value of root in rax, or with false_label a jump there if the comparison fails
+void JitCompiler::Binary(Node root, Op op, Condition cc, Node* slot, Node lhs, Node rhs,
+                         Label* false_label) {
+    Label generic, slow, done;
+    Guard(slot, *slot, &generic);
+    size_t temp = AllocateTemps(2);
+    int32_t op_at = TempOffset(temp);
+    int32_t lhs_at = TempOffset(temp + 1);
+    as_.Store(kRbp, op_at, kRax);
+    Expression(lhs);
+    as_.Store(kRbp, lhs_at, kRax);
+    Expression(rhs);
+
+    as_.Load(kRdx, kRbp, lhs_at);
+    CheckNumber(kRdx, &slow);
+    CheckNumber(kRax, &slow);
+    LoadValue(kRcx, kRdx);
+    LoadValue(kRsi, kRax);
+    if (op == Op::kCompare) {
+        as_.Cmp(kRcx, kRsi, kWideValue);
+        if (false_label) {
+            as_.JumpIf(Negate(cc), false_label);
+        } else {
+            Label holds;
+            as_.JumpIf(cc, &holds);
+            LoadGlobal(kRax, false_slot_);
+            as_.Jump(&done);
+            as_.Bind(&holds);
+            LoadGlobal(kRax, true_slot_);
+        }
+    } else {
+        // on overflow the builtin decides what happens
+        if (op == Op::kAdd) {
+            as_.Add(kRcx, kRsi, kWideValue);
+        } else {
+            as_.Sub(kRcx, kRsi, kWideValue);
+        }
+        as_.JumpIf(kOverflow, &slow);
+        if (kWideValue) {
+            as_.Move(kRdi, kRcx);
+        } else {
+            as_.Extend32(kRdi, kRcx);
+        }
+        CallHelper(reinterpret_cast<const void*>(&JitMakeNumber));
+        CheckError();
+    }
+    as_.Jump(&done);
+
+    // rhs is still in rax
+    as_.Bind(&slow);
+    as_.Move(kRcx, kRax);
+    as_.Move(kRdi, kRbx);
+    as_.Load(kRsi, kRbp, op_at);
+    as_.Load(kRdx, kRbp, lhs_at);
+    CallHelper(reinterpret_cast<const void*>(&JitBinary));
+    CheckError();
+    if (false_label) {
+        Truth(false_label);
+    }
+    as_.Jump(&done);
+
+    as_.Bind(&generic);
+    Generic(root);
+    if (false_label) {
+        Truth(false_label);
+    }
+    as_.Bind(&done);
+    ReleaseTemps(2);
+}
+
+void JitCompiler::LambdaCall(Node root, Node* slot, const std::vector<Node>& args) {
+    Label generic, done;
+    Guard(slot, *slot, &generic);
+    size_t count = args.size();
+    size_t temp = AllocateTemps(count + 1);
+    int32_t callee_at = TempOffset(temp);
+    as_.Store(kRbp, callee_at, kRax);
+    // temporaries grow down, so the arguments are stored from the last one
+    for (size_t i = 0; i < count; ++i) {
+        Expression(args[i]);
+        as_.Store(kRbp, TempOffset(temp + count - i), kRax);
+    }
+
+    as_.Move(kRdi, kRbx);
+    as_.Load(kRsi, kRbp, callee_at);
+    as_.Lea(kRdx, kRbp, TempOffset(temp + count));
+    as_.MoveImm(kRcx, count);
+    CallHelper(reinterpret_cast<const void*>(&JitApply));
+    CheckError();
+    as_.Jump(&done);
+
+    as_.Bind(&generic);
+    Generic(root);
+    as_.Bind(&done);
+    ReleaseTemps(count + 1);
+}
+
+void Promote(Scope* scope, ConstructLambda* code) {
+    TierState& tier = code->GetTier();
+    tier.calls = 0;
+    tier.iterations = 0;
+    if (tier.promotions == scope->GetJitOptions().max_promotions) {
+        return;
+    }
+    ++tier.promotions;
+    if (JitCompiler(scope, code).Compile(&tier.native)) {
+        ++scope->GetTierStats().promotions;
+    }
+}
+
+#else
+
+void Promote(Scope*, ConstructLambda* code) {
+    code->GetTier().calls = 0;
+    code->GetTier().iterations = 0;
+}
+
+#endif
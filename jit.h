@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+class Object;
+class Scope;
+class ConstructLambda;
+struct Frame;
+
+#if defined(__x86_64__) && defined(__linux__)
+constexpr bool kJitSupported = true;
+#else
+constexpr bool kJitSupported = false;
+#endif
+
+// lambdas called more times than the threshold get their body compiled to native code
+struct JitOptions {
+    bool enabled = kJitSupported;
+    size_t threshold = 64;
+    // a lambda whose code keeps getting invalidated stays in the interpreter after that
+    size_t max_promotions = 4;
+};
+
+// tier changes of all lambdas of an interpreter
+struct TierStats {
+    // bodies compiled to native code
+    size_t promotions = 0;
+    // native code dropped because a global it was specialized on got redefined
+    size_t deoptimizations = 0;
+    // bodies compiled for number parameters, see specialize.h
+    size_t specializations = 0;
+};
+
+// executable pages holding the compiled body of a lambda, a copy starts uncompiled
+class NativeCode {
+public:
+    using Function = Object* (*)(Scope* scope, Object** slots, Object** captures);
+
+    NativeCode() = default;
+    NativeCode(const NativeCode&) {
+    }
+    NativeCode& operator=(const NativeCode&) = delete;
+    ~NativeCode();
+
+    Function Get() const {
+        return function_;
+    }
+
+    void Swap(NativeCode& other) {
+        std::swap(memory_, other.memory_);
+        std::swap(size_, other.size_);
+        std::swap(function_, other.function_);
+    }
+
+    // copies the code into fresh pages and makes them executable
+    bool Load(const unsigned char* code, size_t size);
+
+private:
+    void* memory_ = nullptr;
+    size_t size_ = 0;
+    Function function_ = nullptr;
+};
+
+// execution tier of a lambda body, kept by its ConstructLambda
+struct TierState {
+    // invocations since the last change of tier
+    size_t calls = 0;
+    // invocations from the body of the same lambda, which is how loops are written
+    size_t iterations = 0;
+    size_t promotions = 0;
+    NativeCode native;
+
+    size_t GetHotness() const {
+        return calls + iterations;
+    }
+};
+
+// compiles the body of code to native code unless it was promoted too many times already,
+// everything that isn't inlined goes back to Evaluate
+void Promote(Scope* scope, ConstructLambda* code);
+
+// runs the native body of code in frame, errors raised inside it are rethrown here; false
+// if the code was dropped because a global it depends on changed, the frame is untouched
+bool RunNative(Scope* scope, ConstructLambda* code, Frame* frame, Object** res);
@@ -2,8 +2,13 @@
 
 #include "error.h"
 #include "scheme.h"
+#include "specialize.h"
+#include "tokenizer.h"
 
+#include <cctype>
 #include <cmath>
+#include <cstring>
+#include <sstream>
 #include <algorithm>
 
 std::unique_ptr<Heap> Heap::ptr;
@@ -26,63 +31,32 @@ bool Heap::Check(Object* root) {
     return lifetime_root_->Check(root);
 }
 
-void ParseArguments(std::shared_ptr<Scope> scope, Node root, std::vector<Node>& args) {
-    if (!root) {
-        return;
-    }
-    if (!Is<Cell>(root) || IsNullCell(root)) {
-        args.push_back(Evaluate(scope, root));
-        return;
-    }
-
-    if (Is<Symbol>(GetFirst(root)) && As<Symbol>(GetFirst(root))->GetName() == "quote") {
-        args.push_back(GetSecond(root));
-        return;
+// calls func with the value of every argument in the argument list syntax root, in order
+template <typename Func>
+void ForEachArgument(Scope* scope, Node root, Func&& func) {
+    for (; root; root = GetSecond(root)) {
+        if (!Is<Cell>(root) || IsNullCell(root)) {
+            func(Evaluate(scope, root));
+            return;
+        }
+        if (Is<Symbol>(GetFirst(root)) && As<Symbol>(GetFirst(root))->GetName() == "quote") {
+            func(GetSecond(root));
+            return;
+        }
+        func(Evaluate(scope, GetFirst(root)));
     }
-
-    args.push_back(Evaluate(scope, GetFirst(root)));
-    ParseArguments(scope, GetSecond(root), args);
 }
 
-std::vector<Node> ParseArguments(std::shared_ptr<Scope> scope, Node root) {
-    std::vector<Node> args;
-    ParseArguments(scope, root, args);
-    return args;
+void ParseArguments(Scope* scope, Node root, std::vector<Node>& args) {
+    ForEachArgument(scope, root, [&args](Node arg) { args.push_back(arg); });
 }
 
-std::vector<Node> ParseArgumentsNoEval(Node root) {
+std::vector<Node> ParseArguments(Scope* scope, Node root) {
     std::vector<Node> args;
-    Node cur = root;
-    while (cur) {
-        args.push_back(GetFirst(cur));
-        cur = GetSecond(cur);
-    }
+    ParseArguments(scope, root, args);
     return args;
 }
 
-bool NodeEq(Node lhs, Node rhs) {
-    if (Is<Number>(lhs) && Is<Number>(rhs)) {
-        return As<Number>(lhs)->GetValue() == As<Number>(rhs)->GetValue();
-    }
-    if (Is<Symbol>(lhs) && Is<Symbol>(rhs)) {
-        return As<Symbol>(lhs)->GetName() == As<Symbol>(rhs)->GetName();
-    }
-    return 0;
-}
-
-template <typename Func>
-Node RuntimeParse(std::shared_ptr<Scope> scope, Node root, const Func* func, const Node res,
-                  Node terminal = Heap::GetInstance().Make<Object>()) {
-    if (!root || NodeEq(res, terminal)) {
-        return res;
-    }
-    if (!Is<Cell>(root)) {
-        return (*func)(res, Evaluate(scope, root));
-    }
-    return RuntimeParse(scope, GetSecond(root), func, (*func)(res, Evaluate(scope, GetFirst(root))),
-                        terminal);
-}
-
 // T has to be a descendant to Object
 template <typename T>
 void RequireArgType(const std::vector<Node>& args) {
@@ -112,14 +86,12 @@ void RequireArgumentSize(const std::vector<Node>& args, size_t l, size_t r = siz
     }
 }
 
-Node Bool(std::shared_ptr<Scope> scope, bool value) {
+Node Bool(Scope* scope, bool value) {
     return scope->ResolveSymbol(value ? "#t" : "#f");
 }
 
-Scope::Scope(std::shared_ptr<Scope> prev) : prev_(prev) {
-    if (prev_.get() == nullptr) {
-        InitBuiltinFunctions();
-    }
+Scope::Scope() {
+    InitBuiltinFunctions();
 }
 
 // initialize all builtin functions for global scope
@@ -130,6 +102,10 @@ void Scope::InitBuiltinFunctions() {
     Define("null?", Heap::GetInstance().Make<IsNull>());
     Define("pair?", Heap::GetInstance().Make<IsPair>());
     Define("list?", Heap::GetInstance().Make<IsList>());
+    Define("eq?", Heap::GetInstance().Make<IsEq>());
+    Define("eqv?", Heap::GetInstance().Make<IsEqv>());
+    Define("equal?", Heap::GetInstance().Make<IsEqualValue>());
+    Define("equal-hash", Heap::GetInstance().Make<EqualHash>());
     Define("cons", Heap::GetInstance().Make<MakePair>());
     Define("list", Heap::GetInstance().Make<MakeList>());
     Define("car", Heap::GetInstance().Make<GetHead>());
@@ -137,8 +113,6 @@ void Scope::InitBuiltinFunctions() {
     Define("list-ref", Heap::GetInstance().Make<Get>());
     Define("list-tail", Heap::GetInstance().Make<GetSuffix>());
     Define("not", Heap::GetInstance().Make<Not>());
-    Define("and", Heap::GetInstance().Make<And>());
-    Define("or", Heap::GetInstance().Make<Or>());
     Define("+", Heap::GetInstance().Make<Plus>());
     Define("-", Heap::GetInstance().Make<Minus>());
     Define("*", Heap::GetInstance().Make<Mult>());
@@ -151,50 +125,228 @@ void Scope::InitBuiltinFunctions() {
     Define("max", Heap::GetInstance().Make<Max>());
     Define("min", Heap::GetInstance().Make<Min>());
     Define("abs", Heap::GetInstance().Make<Abs>());
-    Define("define", Heap::GetInstance().Make<class Define>());
-    Define("set!", Heap::GetInstance().Make<class Set>());
+    Define("vector?", Heap::GetInstance().Make<IsVector>());
+    Define("make-vector", Heap::GetInstance().Make<MakeVector>());
+    Define("vector", Heap::GetInstance().Make<BuildVector>());
+    Define("vector-ref", Heap::GetInstance().Make<VectorRef>());
+    Define("vector-set!", Heap::GetInstance().Make<VectorSet>());
+    Define("vector-length", Heap::GetInstance().Make<VectorLength>());
+    Define("vector-fill!", Heap::GetInstance().Make<VectorFill>());
+    Define("vector-sum", Heap::GetInstance().Make<VectorSum>());
+    Define("vector-dot", Heap::GetInstance().Make<VectorDot>());
+    Define("vector-min", Heap::GetInstance().Make<VectorMin>());
+    Define("vector-max", Heap::GetInstance().Make<VectorMax>());
+    Define("vector-add", Heap::GetInstance().Make<VectorAdd>());
+    Define("vector-mul", Heap::GetInstance().Make<VectorMul>());
+    Define("vector=", Heap::GetInstance().Make<VectorIsEqual>());
+    Define("vector<", Heap::GetInstance().Make<VectorIsSmaller>());
+    Define("vector>", Heap::GetInstance().Make<VectorIsGreater>());
+    Define("vector<=", Heap::GetInstance().Make<VectorIsLeq>());
+    Define("vector>=", Heap::GetInstance().Make<VectorIsGeq>());
+    Define("hash-table?", Heap::GetInstance().Make<IsHashTable>());
+    Define("make-hash-table", Heap::GetInstance().Make<MakeHashTable>());
+    Define("hash-table-ref", Heap::GetInstance().Make<HashTableRef>());
+    Define("hash-table-set!", Heap::GetInstance().Make<HashTableSet>());
+    Define("hash-table-delete!", Heap::GetInstance().Make<HashTableDelete>());
+    Define("hash-table-contains?", Heap::GetInstance().Make<HashTableContains>());
+    Define("hash-table-count", Heap::GetInstance().Make<HashTableCount>());
+    Define("hash-table-keys", Heap::GetInstance().Make<HashTableKeys>());
+    Define("hash-table-values", Heap::GetInstance().Make<HashTableValues>());
+    Define("hash-table->alist", Heap::GetInstance().Make<HashTableToList>());
+    Define("hash-table-walk", Heap::GetInstance().Make<HashTableWalk>());
+    Define("pmap", Heap::GetInstance().Make<MakePersistentMap>());
+    Define("pmap?", Heap::GetInstance().Make<IsPersistentMap>());
+    Define("pmap-ref", Heap::GetInstance().Make<PersistentMapRef>());
+    Define("pmap-set", Heap::GetInstance().Make<PersistentMapSet>());
+    Define("pmap-delete", Heap::GetInstance().Make<PersistentMapDelete>());
+    Define("pmap-contains?", Heap::GetInstance().Make<PersistentMapContains>());
+    Define("pmap-count", Heap::GetInstance().Make<PersistentMapCount>());
+    Define("pmap->alist", Heap::GetInstance().Make<PersistentMapToList>());
+    Define("pvector", Heap::GetInstance().Make<MakePersistentVector>());
+    Define("pvector?", Heap::GetInstance().Make<IsPersistentVector>());
+    Define("pvector-ref", Heap::GetInstance().Make<PersistentVectorRef>());
+    Define("pvector-set", Heap::GetInstance().Make<PersistentVectorSet>());
+    Define("pvector-push", Heap::GetInstance().Make<PersistentVectorPush>());
+    Define("pvector-length", Heap::GetInstance().Make<PersistentVectorLength>());
+    Define("pvector->list", Heap::GetInstance().Make<PersistentVectorToList>());
+    Define("string?", Heap::GetInstance().Make<IsString>());
+    Define("string-length", Heap::GetInstance().Make<StringLength>());
+    Define("string-append", Heap::GetInstance().Make<StringAppend>());
+    Define("substring", Heap::GetInstance().Make<Substring>());
+    Define("string->symbol", Heap::GetInstance().Make<StringToSymbol>());
+    Define("symbol->string", Heap::GetInstance().Make<SymbolToString>());
+    Define("number->string", Heap::GetInstance().Make<NumberToString>());
+    Define("string->number", Heap::GetInstance().Make<StringToNumber>());
+    Define("length", Heap::GetInstance().Make<ListLength>());
+    Define("append", Heap::GetInstance().Make<Append>());
+    Define("reverse", Heap::GetInstance().Make<Reverse>());
+    Define("list-copy", Heap::GetInstance().Make<ListCopy>());
+    Define("map", Heap::GetInstance().Make<Map>());
+    Define("for-each", Heap::GetInstance().Make<ForEach>());
+    Define("filter", Heap::GetInstance().Make<Filter>());
+    Define("fold-left", Heap::GetInstance().Make<FoldLeft>());
+    Define("fold-right", Heap::GetInstance().Make<FoldRight>());
+    Define("assoc", Heap::GetInstance().Make<Assoc>());
+    Define("member", Heap::GetInstance().Make<Member>());
+    Define("sort", Heap::GetInstance().Make<Sort>());
     Define("set-car!", Heap::GetInstance().Make<SetCar>());
     Define("set-cdr!", Heap::GetInstance().Make<SetCdr>());
-    Define("if", Heap::GetInstance().Make<If>());
-    Define("lambda", Heap::GetInstance().Make<ConstructLambda>());
-    Define("quote", Heap::GetInstance().Make<Object>());
 
-    Define("#t", Heap::GetInstance().Make<Symbol>("#t"));
-    Define("#f", Heap::GetInstance().Make<Symbol>("#f"));
+    Define("#t", Heap::GetInstance().Intern("#t"));
+    Define("#f", Heap::GetInstance().Intern("#f"));
 }
 
 Node& Scope::ResolveSymbol(const std::string& symbol) {
-    if (buf_.find(symbol) != buf_.end()) {
-        return buf_[symbol];
-    }
-    if (prev_ == nullptr) {
+    auto it = buf_.find(symbol);
+    if (it == buf_.end()) {
         throw NameError("Symbol not found");
     }
-    return prev_->ResolveSymbol(symbol);
+    return it->second;
+}
+
+Node* Scope::Lookup(const std::string& symbol) {
+    auto it = buf_.find(symbol);
+    return it == buf_.end() ? nullptr : &it->second;
+}
+
+Node& Scope::ResolveSymbol(const std::string& symbol, InlineCache* cache) {
+    if (cache->slot && cache->version == version_ && cache->scope == this) {
+        return *cache->slot;
+    }
+    Node& res = ResolveSymbol(symbol);
+    cache->slot = &res;
+    cache->version = version_;
+    cache->scope = this;
+    return res;
 }
 
 void Scope::Set(const std::string& symbol, Node root) {
+    ++version_;
     if (buf_.find(symbol) == buf_.end()) {
-        if (prev_ == nullptr) {
-            throw NameError("Can't set value of undefined symbol");
-        }
-        prev_->Set(symbol, root);
-        return;
+        throw NameError("Can't set value of undefined symbol");
     }
+    ++epochs_[symbol];
     Heap::GetInstance().RemoveRoot(buf_[symbol]);
     buf_[symbol] = root;
     Heap::GetInstance().AddRoot(buf_[symbol]);
 }
 
+Node* FrameStack::Allocate(size_t size) {
+    while (top_ + size > chunks_[chunk_].size()) {
+        ++chunk_;
+        top_ = 0;
+        if (chunk_ == chunks_.size()) {
+            chunks_.emplace_back(std::max(kChunkSize, size));
+        }
+    }
+    Node* res = chunks_[chunk_].data() + top_;
+    top_ += size;
+    return res;
+}
+
+struct ScratchArea::Chunk {
+    std::unique_ptr<Number[]> numbers;
+    std::unique_ptr<Flonum[]> flonums;
+    std::unique_ptr<Cell[]> cells;
+};
+
+ScratchArea::ScratchArea() {
+    chunks_.push_back(std::make_unique<Chunk>());
+    chunks_.back()->numbers.reset(new Number[kChunkSize]);
+    chunks_.back()->flonums.reset(new Flonum[kChunkSize]);
+    chunks_.back()->cells.reset(new Cell[kChunkSize]);
+}
+
+ScratchArea::~ScratchArea() = default;
+
+void ScratchArea::Advance() {
+    ++allocations_;
+    if (++top_ < kChunkSize) {
+        return;
+    }
+    top_ = 0;
+    if (++chunk_ == chunks_.size()) {
+        chunks_.push_back(std::make_unique<Chunk>());
+        chunks_.back()->numbers.reset(new Number[kChunkSize]);
+        chunks_.back()->flonums.reset(new Flonum[kChunkSize]);
+        chunks_.back()->cells.reset(new Cell[kChunkSize]);
+    }
+}
+
+Number* ScratchArea::MakeNumber(int64_t value) {
+    Number* res = &chunks_[chunk_]->numbers[top_];
+    res->value_ = value;
+    Advance();
+    return res;
+}
+
+Flonum* ScratchArea::MakeFlonum(double value) {
+    Flonum* res = &chunks_[chunk_]->flonums[top_];
+    res->value_ = value;
+    Advance();
+    return res;
+}
+
+Cell* ScratchArea::MakeCell(Object* first, Object* second) {
+    Cell* res = &chunks_[chunk_]->cells[top_];
+    res->first_ = first;
+    res->second_ = second;
+    Advance();
+    return res;
+}
+
+// restores the frame of the caller and releases the slots of the callee
+class FrameGuard {
+public:
+    FrameGuard(Scope* scope)
+        : scope_(scope), frame_(scope->GetFrame()), position_(scope->GetStack().GetPosition()) {
+    }
+
+    ~FrameGuard() {
+        scope_->SetFrame(frame_);
+        scope_->GetStack().Release(position_);
+    }
+
+private:
+    Scope* scope_;
+    Frame* frame_;
+    FrameStack::Position position_;
+};
+
+class UnassignedValue : public Object {};
+
+Node Unassigned() {
+    static UnassignedValue value;
+    return &value;
+}
+
 Heap::Heap() {
     lifetime_root_ = Make<Object>();
 }
 
+Object* Heap::Intern(const std::string& name) {
+    auto& symbol = symbols_[name];
+    if (!symbol) {
+        symbol = Make<Symbol>(name);
+    }
+    return symbol;
+}
+
+void Heap::Free(std::unique_ptr<Object>& object) {
+    if (auto symbol = As<Symbol>(object.get())) {
+        auto it = symbols_.find(symbol->GetName());
+        if (it != symbols_.end() && it->second == symbol) {
+            symbols_.erase(it);
+        }
+    }
+    object.reset();
+}
+
 void Heap::RunGC() {
     lifetime_root_->Mark();
     for (auto& ptr : storage_) {
         if (ptr && !ptr->mark_) {
-            ptr.reset();
+            Free(ptr);
         }
     }
     std::vector<std::unique_ptr<Object>>::iterator object = find_if(
@@ -202,7 +354,7 @@ void Heap::RunGC() {
     storage_.erase(std::remove(storage_.begin(), storage_.end(), *object));
     for (auto& ptr : storage_) {
         if (ptr) {
-            ptr->mark_ = 0;
+            ptr->ClearMark();
         }
     }
 }
@@ -211,7 +363,7 @@ void Heap::Del() {
     lifetime_root_->Mark();
     for (auto& ptr : storage_) {
         if (ptr && ptr.get() != lifetime_root_ && ptr->mark_) {
-            ptr.reset();
+            Free(ptr);
         }
     }
     std::vector<std::unique_ptr<Object>>::iterator object = find_if(
@@ -219,36 +371,150 @@ void Heap::Del() {
     storage_.erase(std::remove(storage_.begin(), storage_.end(), *object));
     for (auto& ptr : storage_) {
         if (ptr) {
-            ptr->mark_ = 0;
+            ptr->ClearMark();
         }
     }
     lifetime_root_ = Make<Object>();
 }
 
+// with a stack of its own, a long list would overflow the one of the thread
 void Object::Mark() {
-    Update();
-    mark_ = 1;
-    for (auto ptr : dependants_) {
-        if (!(ptr->mark_)) {
-            ptr->Mark();
+    std::vector<Object*> pending;
+    MarkObject(this, &pending);
+    while (!pending.empty()) {
+        Object* object = pending.back();
+        pending.pop_back();
+        object->Update();
+        for (auto ptr : object->dependants_) {
+            MarkObject(ptr, &pending);
         }
+        object->MarkReferences(&pending);
     }
 }
 
-Node IsNumber::Run(std::shared_ptr<Scope> scope, Node root) {
+Node Builtin::Run(Scope* scope, Node root) {
     auto args = ParseArguments(scope, root);
+    return Apply(scope, args);
+}
+
+Node Builtin::Invoke(Scope* scope, const std::vector<Compiled>& args, Node) {
+    std::vector<Node> values;
+    values.reserve(args.size());
+    for (auto& arg : args) {
+        values.push_back(arg(scope));
+    }
+    return Apply(scope, values);
+}
+
+// marks the result of a builtin as a temporary while it is made
+class TemporaryGuard {
+public:
+    explicit TemporaryGuard(Scope* scope) : scope_(scope) {
+        scope_->SetTemporary(true);
+    }
+
+    ~TemporaryGuard() {
+        scope_->SetTemporary(false);
+    }
+
+private:
+    Scope* scope_;
+};
+
+Node Builtin::InvokeTemporary(Scope* scope, const std::vector<Compiled>& args, Node) {
+    std::vector<Node> values;
+    values.reserve(args.size());
+    for (auto& arg : args) {
+        values.push_back(arg(scope));
+    }
+    // what the arguments made isn't a temporary of this call
+    TemporaryGuard guard(scope);
+    return Apply(scope, values);
+}
+
+// results of builtins, builtins don't evaluate anything while they make them
+Node MakeNumber(Scope* scope, int64_t value) {
+    if (scope->IsTemporary()) {
+        return scope->GetScratch().MakeNumber(value);
+    }
+    return Heap::GetInstance().Make<Number>(value);
+}
+
+Node MakeFlonum(Scope* scope, double value) {
+    if (scope->IsTemporary()) {
+        return scope->GetScratch().MakeFlonum(value);
+    }
+    return Heap::GetInstance().Make<Flonum>(value);
+}
+
+Node MakeCell(Scope* scope, Node first, Node second) {
+    if (scope->IsTemporary()) {
+        return scope->GetScratch().MakeCell(first, second);
+    }
+    return Heap::GetInstance().Make<Cell>(first, second);
+}
+
+// Number if the value fits one; big numbers are rare enough to always go to the heap
+Node MakeInteger(Scope* scope, const BigInt& value) {
+    int64_t fixnum;
+    if (value.ToInt64(&fixnum)) {
+        return MakeNumber(scope, fixnum);
+    }
+    return Heap::GetInstance().Make<BigNumber>(value);
+}
+
+bool IsInteger(Node root) {
+    return Is<Number>(root) || Is<BigNumber>(root);
+}
+
+// root has to be a Number or a BigNumber
+BigInt GetBigValue(Node root) {
+    if (auto number = As<Number>(root)) {
+        return BigInt(number->GetValue());
+    }
+    return As<BigNumber>(root)->GetValue();
+}
+
+// root has to be numeric
+double GetDoubleValue(Node root) {
+    if (auto number = As<Flonum>(root)) {
+        return number->GetValue();
+    }
+    if (auto number = As<Number>(root)) {
+        return number->GetValue();
+    }
+    return As<BigNumber>(root)->GetValue().ToDouble();
+}
+
+// negative, zero or positive like lhs - rhs
+int CompareIntegers(Node lhs, Node rhs) {
+    if (Is<Number>(lhs) && Is<Number>(rhs)) {
+        return (GetValue(lhs) > GetValue(rhs)) - (GetValue(lhs) < GetValue(rhs));
+    }
+    return Compare(GetBigValue(lhs), GetBigValue(rhs));
+}
+
+// relation func like std::less between two numbers; integers are compared exactly, with a
+// flonum both are compared as doubles, so NaN is in no relation
+template <typename Func>
+bool CompareNumbers(Node lhs, Node rhs, Func func) {
+    if (Is<Flonum>(lhs) || Is<Flonum>(rhs)) {
+        return func(GetDoubleValue(lhs), GetDoubleValue(rhs));
+    }
+    return func(CompareIntegers(lhs, rhs), 0);
+}
+
+Node IsNumber::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
-    return Bool(scope, Is<Number>(args[0]));
+    return Bool(scope, IsNumeric(args[0]));
 }
 
-Node IsSymbol::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node IsSymbol::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
     return Bool(scope, Is<Symbol>(args[0]));
 }
 
-Node IsBoolean::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node IsBoolean::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
     if (!Is<Symbol>(args[0])) {
         return Bool(scope, 0);
@@ -257,58 +523,134 @@ Node IsBoolean::Run(std::shared_ptr<Scope> scope, Node root) {
     return Bool(scope, s == "#f" || s == "#t");
 }
 
-Node IsPair::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto sz = [](Node lhs, Node) {
-        return Heap::GetInstance().Make<Number>(As<Number>(lhs)->GetValue() + 1);
-    };
-    Node res = RuntimeParse(scope, Evaluate(scope, GetFirst(root)), &sz,
-                            Heap::GetInstance().Make<Number>(0));
-    return Bool(scope, As<Number>(res)->GetValue() == 2);
+// the number of pairs from root with Floyd's cycle detection: slow moves one pair for every
+// two of fast, so fast catches up with it if the pairs form a cycle. Sets *end to what
+// follows the last pair, false on a cycle
+bool CountPairs(Node root, int64_t* size, Node* end) {
+    Node slow = root;
+    Node fast = root;
+    *size = 0;
+    while (Is<Cell>(fast)) {
+        fast = GetSecond(fast);
+        ++*size;
+        if (!Is<Cell>(fast)) {
+            break;
+        }
+        fast = GetSecond(fast);
+        ++*size;
+        slow = GetSecond(slow);
+        if (fast == slow) {
+            return false;
+        }
+    }
+    *end = fast;
+    return true;
 }
 
-Node IsNull::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node IsPair::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
-    return Bool(scope, !args[0] || IsNullCell(args[0]));
+    return Bool(scope, Is<Cell>(args[0]));
 }
 
-Node IsList::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node IsNull::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
-    Node cur = args[0];
-    while (cur && GetSecond(cur)) {
-        if (!Is<Cell>(GetSecond(cur))) {
-            return Bool(scope, 0);
+    return Bool(scope, !args[0]);
+}
+
+Node IsList::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    int64_t size;
+    Node end;
+    return Bool(scope, CountPairs(args[0], &size, &end) && !end);
+}
+
+Node MakePair::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return MakeCell(scope, args[0], args[1]);
+}
+
+void Cell::MarkReferences(std::vector<Object*>* pending) {
+    MarkObject(block_, pending);
+}
+
+ListBlock::ListBlock(const std::vector<Node>& elements, Node tail)
+    : size_(elements.size()), cells_(new Cell[elements.size()]) {
+    for (size_t i = 0; i < size_; ++i) {
+        cells_[i].block_ = this;
+        cells_[i].GetFirst() = elements[i];
+        cells_[i].GetSecond() = i + 1 < size_ ? &cells_[i + 1] : tail;
+    }
+}
+
+Node ListBlock::Skip(Cell* cell, size_t* count) {
+    if (!linked_) {
+        return cell;
+    }
+    size_t index = cell - cells_.get();
+    size_t step = std::min(*count, size_ - 1 - index);
+    *count -= step;
+    return &cells_[index + step];
+}
+
+// the pairs are marked with the block, only the cdrs changed by set-cdr! lead elsewhere
+void ListBlock::MarkReferences(std::vector<Object*>* pending) {
+    for (size_t i = 0; i < size_; ++i) {
+        cells_[i].mark_ = 1;
+        MarkObject(cells_[i].GetFirst(), pending);
+        if (i + 1 == size_ || cells_[i].GetSecond() != &cells_[i + 1]) {
+            MarkObject(cells_[i].GetSecond(), pending);
         }
-        cur = GetSecond(cur);
     }
-    return Bool(scope, 1);
 }
 
-Node MakePair::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    RequireArgumentSize(args, 2, 2);
-    return Heap::GetInstance().Make<Cell>(args[0], args[1]);
+void ListBlock::ClearMark() {
+    mark_ = 0;
+    for (size_t i = 0; i < size_; ++i) {
+        cells_[i].mark_ = 0;
+    }
 }
 
-Node MakeList::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    if (args.empty()) {
-        return nullptr;
+Object* ListBlock::Clone() const {
+    std::vector<Node> elements;
+    elements.reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+        elements.push_back(cells_[i].GetFirst());
+    }
+    return Heap::GetInstance().Make<ListBlock>(elements, cells_[size_ - 1].GetSecond());
+}
+
+Node MakeListOf(const std::vector<Node>& elements, Node tail) {
+    if (elements.empty()) {
+        return tail;
     }
-    args.push_back(nullptr);
-    while (args.size() > 1) {
-        Node b = args.back();
-        args.pop_back();
-        Node a = args.back();
-        args.pop_back();
-        args.push_back(Heap::GetInstance().Make<Cell>(a, b));
+    if (elements.size() == 1) {
+        return Heap::GetInstance().Make<Cell>(elements[0], tail);
     }
-    return args[0];
+    return As<ListBlock>(Heap::GetInstance().Make<ListBlock>(elements, tail))->GetList();
 }
 
-Node GetHead::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+// follows the cdrs from cur *count times or up to the first object that isn't a pair,
+// decreasing *count on every step
+Node SkipPairs(Node cur, size_t* count) {
+    while (*count > 0 && Is<Cell>(cur)) {
+        auto cell = As<Cell>(cur);
+        if (cell->GetBlock()) {
+            cur = cell->GetBlock()->Skip(cell, count);
+            if (!*count) {
+                break;
+            }
+        }
+        cur = GetSecond(cur);
+        --*count;
+    }
+    return cur;
+}
+
+Node MakeList::Apply(Scope* scope, std::vector<Node>& args) {
+    return MakeListOf(args);
+}
+
+Node GetHead::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
     if (!args[0]) {
         throw RuntimeError("Can't get head of empty list");
@@ -316,8 +658,7 @@ Node GetHead::Run(std::shared_ptr<Scope> scope, Node root) {
     return GetFirst(args[0]);
 }
 
-Node GetTail::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node GetTail::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
     if (!args[0]) {
         throw RuntimeError("Can't get tail of empty list");
@@ -325,35 +666,27 @@ Node GetTail::Run(std::shared_ptr<Scope> scope, Node root) {
     return GetSecond(args[0]);
 }
 
-Node Get::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node Get::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 2, 2);
-    Node cur = args[0];
     size_t ind = As<Number>(args[1])->GetValue();
-    for (; ind > 0 && Is<Cell>(cur); --ind) {
-        cur = GetSecond(cur);
-    }
+    Node cur = SkipPairs(args[0], &ind);
     if (!Is<Cell>(cur)) {
         throw RuntimeError("List index out of bounds");
     }
     return GetFirst(cur);
 }
 
-Node GetSuffix::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
+Node GetSuffix::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 2, 2);
-    Node cur = args[0];
     size_t ind = As<Number>(args[1])->GetValue();
-    for (; ind > 0 && Is<Cell>(cur); --ind) {
-        cur = GetSecond(cur);
-    }
+    Node cur = SkipPairs(args[0], &ind);
     if (ind > 0 && !Is<Cell>(cur)) {
         throw RuntimeError("List index out of bounds");
     }
     return cur;
 }
 
-Node Not::Run(std::shared_ptr<Scope> scope, Node root) {
+Node Not::Run(Scope* scope, Node root) {
     if (As<Symbol>(IsBoolean().Run(scope, root))->GetName() == "#f") {
         return Bool(scope, 0);
     }
@@ -362,266 +695,2158 @@ Node Not::Run(std::shared_ptr<Scope> scope, Node root) {
     return Bool(scope, !IsTrue(args[0]));
 }
 
-Node And::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!root) {
-        return Bool(scope, 1);
-    }
-    Node lst;
-    auto func = [&lst, &scope](Node, Node rhs) {
-        lst = rhs;
-        return Bool(scope, IsTrue(rhs));
-    };
-    if (IsTrue(RuntimeParse(scope, root, &func, Bool(scope, 1), Bool(scope, 0)))) {
-        return lst;
-    }
-    return Bool(scope, 0);
-}
-
-Node Or::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!root) {
-        return Bool(scope, 0);
-    }
-    Node lst;
-    auto func = [&lst, &scope](Node, Node rhs) {
-        lst = rhs;
-        return Bool(scope, IsTrue(rhs));
-    };
-    if (IsTrue(RuntimeParse(scope, root, &func, Bool(scope, 0), Bool(scope, 1)))) {
-        return lst;
-    }
-    return Bool(scope, 0);
-}
-
 template <typename Func>
-Node ProxyCompare(std::shared_ptr<Scope> scope, std::vector<Node>& args, Func func) {
-    RequireArgType<Number>(args);
-    if (args.empty()) {
-        return Bool(scope, 1);
+Node ProxyCompare(Scope* scope, std::vector<Node>& args, Func func) {
+    for (auto arg : args) {
+        if (!IsNumeric(arg)) {
+            throw RuntimeError("Certain argument type required, invalid type given");
+        }
     }
     for (size_t i = 1; i < args.size(); ++i) {
-        if (!func(args[i - 1], args[i])) {
+        if (!CompareNumbers(args[i - 1], args[i], func)) {
             return Bool(scope, 0);
         }
     }
     return Bool(scope, 1);
 }
 
-Node IsEqual::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    return ProxyCompare(scope, args, NodeEq);
+Node IsEqual::Apply(Scope* scope, std::vector<Node>& args) {
+    return ProxyCompare(scope, args, std::equal_to<>());
 }
 
-Node IsGreater::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    return ProxyCompare(scope, args,
-                        [](Node lhs, Node rhs) { return GetValue(lhs) > GetValue(rhs); });
+Node IsGreater::Apply(Scope* scope, std::vector<Node>& args) {
+    return ProxyCompare(scope, args, std::greater<>());
 }
 
-Node IsSmaller::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    return ProxyCompare(scope, args,
-                        [](Node lhs, Node rhs) { return GetValue(lhs) < GetValue(rhs); });
+Node IsSmaller::Apply(Scope* scope, std::vector<Node>& args) {
+    return ProxyCompare(scope, args, std::less<>());
 }
 
-Node IsGeq::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    return ProxyCompare(scope, args,
-                        [](Node lhs, Node rhs) { return GetValue(lhs) >= GetValue(rhs); });
+Node IsGeq::Apply(Scope* scope, std::vector<Node>& args) {
+    return ProxyCompare(scope, args, std::greater_equal<>());
 }
 
-Node IsLeq::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    return ProxyCompare(scope, args,
-                        [](Node lhs, Node rhs) { return GetValue(lhs) <= GetValue(rhs); });
+Node IsLeq::Apply(Scope* scope, std::vector<Node>& args) {
+    return ProxyCompare(scope, args, std::less_equal<>());
 }
 
-template <typename Func>
-Node ProxyArithmetic(std::vector<Node>& args, Func func, bool have_neut = 0,
-                     Node neutral = nullptr) {
-    RequireArgType<Number>(args);
-    if (args.empty()) {
-        if (have_neut) {
-            return neutral;
+// state of an Arithmetic call while its arguments come in
+class Reduction {
+public:
+    explicit Reduction(const Arithmetic* func) : func_(func) {
+    }
+
+    void Add(Node arg) {
+        // the rest of the arguments is still evaluated before the error is raised
+        if (!IsNumeric(arg)) {
+            numbers_ = false;
+            return;
+        }
+        if (!numbers_) {
+            return;
+        }
+        auto number = As<Number>(arg);
+        if (!count_++) {
+            first_ = arg;
+            if (number) {
+                value_ = number->GetValue();
+            } else if (Is<Flonum>(arg)) {
+                flonum_ = true;
+                real_value_ = GetDoubleValue(arg);
+            } else {
+                big_ = true;
+                big_value_ = As<BigNumber>(arg)->GetValue();
+            }
+            return;
+        }
+        if (!flonum_ && Is<Flonum>(arg)) {
+            flonum_ = true;
+            real_value_ = big_ ? big_value_.ToDouble() : value_;
+        }
+        if (flonum_) {
+            real_value_ = func_->Combine(real_value_, GetDoubleValue(arg));
+            return;
         }
-        throw RuntimeError("No neutral element for arithmetic operation");
+        int64_t res;
+        if (!big_ && number && func_->Combine(value_, number->GetValue(), &res)) {
+            value_ = res;
+            return;
+        }
+        if (!big_) {
+            big_ = true;
+            big_value_ = BigInt(value_);
+        }
+        big_value_ = func_->Combine(big_value_, GetBigValue(arg));
     }
-    Node res = args[0];
-    for (size_t i = 1; i < args.size(); ++i) {
-        res = func(res, args[i]);
+
+    Node Finish(Scope* scope) {
+        if (!numbers_) {
+            throw RuntimeError("Certain argument type required, invalid type given");
+        }
+        if (count_ == 1) {
+            return first_;
+        }
+        if (!count_ && !func_->Neutral(&value_)) {
+            throw RuntimeError("No neutral element for arithmetic operation");
+        }
+        if (flonum_) {
+            return MakeFlonum(scope, real_value_);
+        }
+        if (big_) {
+            return MakeInteger(scope, big_value_);
+        }
+        return MakeNumber(scope, value_);
     }
-    return res;
-}
 
-Node Plus::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(GetValue(lhs) + GetValue(rhs));
-    };
-    return ProxyArithmetic(args, func, 1, Heap::GetInstance().Make<Number>(0));
+private:
+    const Arithmetic* func_;
+    size_t count_ = 0;
+    Node first_ = nullptr;
+    int64_t value_ = 0;
+    // set once a result didn't fit value_
+    bool big_ = false;
+    BigInt big_value_;
+    // set once a Flonum came in
+    bool flonum_ = false;
+    double real_value_ = 0;
+    bool numbers_ = true;
+};
+
+Node Arithmetic::Run(Scope* scope, Node root) {
+    Reduction reduction(this);
+    ForEachArgument(scope, root, [&reduction](Node arg) { reduction.Add(arg); });
+    return reduction.Finish(scope);
 }
 
-Node Minus::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(GetValue(lhs) - GetValue(rhs));
-    };
-    return ProxyArithmetic(args, func);
+Node Arithmetic::Invoke(Scope* scope, const std::vector<Compiled>& args, Node) {
+    Reduction reduction(this);
+    for (auto& arg : args) {
+        reduction.Add(arg(scope));
+    }
+    return reduction.Finish(scope);
 }
 
-Node Mult::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(GetValue(lhs) * GetValue(rhs));
-    };
-    return ProxyArithmetic(args, func, 1, Heap::GetInstance().Make<Number>(1));
+Node Arithmetic::InvokeTemporary(Scope* scope, const std::vector<Compiled>& args, Node) {
+    Reduction reduction(this);
+    for (auto& arg : args) {
+        reduction.Add(arg(scope));
+    }
+    TemporaryGuard guard(scope);
+    return reduction.Finish(scope);
 }
 
-Node Div::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(GetValue(lhs) / GetValue(rhs));
-    };
-    return ProxyArithmetic(args, func);
+Node Arithmetic::Apply(Scope* scope, std::vector<Node>& args) {
+    Reduction reduction(this);
+    for (auto arg : args) {
+        reduction.Add(arg);
+    }
+    return reduction.Finish(scope);
 }
 
-Node Max::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(std::max(GetValue(lhs), GetValue(rhs)));
-    };
-    return ProxyArithmetic(args, func);
+bool Div::Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+    if (!rhs) {
+        throw RuntimeError("Division by zero");
+    }
+    // the only quotient out of range
+    if (lhs == INT64_MIN && rhs == -1) {
+        return false;
+    }
+    *res = lhs / rhs;
+    return true;
 }
 
-Node Min::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    auto func = [](Node lhs, Node rhs) {
-        return Heap::GetInstance().Make<Number>(std::min(GetValue(lhs), GetValue(rhs)));
-    };
-    return ProxyArithmetic(args, func);
+BigInt Div::Combine(const BigInt& lhs, const BigInt& rhs) const {
+    if (rhs.IsZero()) {
+        throw RuntimeError("Division by zero");
+    }
+    return lhs / rhs;
 }
 
-Node Abs::Run(std::shared_ptr<Scope> scope, Node root) {
-    auto args = ParseArguments(scope, root);
-    RequireArgType<Number>(args);
+Node Abs::Apply(Scope* scope, std::vector<Node>& args) {
     RequireArgumentSize(args, 1, 1);
-    return Heap::GetInstance().Make<Number>(std::abs(GetValue(args[0])));
+    if (auto number = As<Number>(args[0])) {
+        if (number->GetValue() == INT64_MIN) {
+            return MakeInteger(scope, BigInt(number->GetValue()).Abs());
+        }
+        return MakeNumber(scope, std::abs(number->GetValue()));
+    }
+    if (auto number = As<BigNumber>(args[0])) {
+        return MakeInteger(scope, number->GetValue().Abs());
+    }
+    if (auto number = As<Flonum>(args[0])) {
+        return MakeFlonum(scope, std::fabs(number->GetValue()));
+    }
+    throw RuntimeError("Certain argument type required, invalid type given");
 }
 
-Node ToCell(Node root) {
-    if (!Is<Cell>(root)) {
-        return Heap::GetInstance().Make<Cell>(root, nullptr);
+String::String(const String& other)
+    : size_(other.size_), left_(other.left_), right_(other.right_) {
+    if (!IsRope()) {
+        if (size_ > kInlineSize) {
+            chars_.reset(new char[size_]);
+        }
+        std::memcpy(GetChars(), other.size_ <= kInlineSize ? other.inline_ : other.chars_.get(),
+                    size_);
     }
-    return root;
 }
 
-Node Define::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root)) {
-        throw SyntaxError("Define requires 2 arguments");
+String::String(std::string_view text) : size_(text.size()) {
+    if (size_ > kInlineSize) {
+        chars_.reset(new char[size_]);
     }
-
-    // lambda sugar case
-    if (Is<Cell>(GetFirst(root))) {
-        auto args_node = GetSecond(GetFirst(root));
-        auto body = GetSecond(root);
-        scope->Define(
-            GetName(GetFirst(GetFirst(root))),
-            ConstructLambda().Run(scope, Heap::GetInstance().Make<Cell>(args_node, ToCell(body))));
-        return nullptr;
+    // the data of an empty view may be nullptr
+    if (size_) {
+        std::memcpy(GetChars(), text.data(), size_);
     }
+}
+
+String::String(String* left, String* right)
+    : size_(left->size_ + right->size_), left_(left), right_(right) {
+}
 
-    if (!Is<Symbol>(GetFirst(root))) {
-        throw SyntaxError("Bad argument to define");
+std::string_view String::GetView() {
+    if (IsRope()) {
+        Flatten();
     }
-    if (GetSecond(GetSecond(root)) != nullptr) {
-        throw SyntaxError("Define requires 2 arguments");
+    return {GetChars(), size_};
+}
+
+// the parts are copied in order with a stack of their own, a rope made by appending to
+// the same string over and over is as deep as it is long
+void String::Flatten() {
+    chars_.reset(new char[size_]);
+    size_t pos = 0;
+    std::vector<String*> pending{right_, left_};
+    while (!pending.empty()) {
+        String* part = pending.back();
+        pending.pop_back();
+        if (part->IsRope()) {
+            pending.push_back(part->right_);
+            pending.push_back(part->left_);
+            continue;
+        }
+        std::memcpy(chars_.get() + pos, part->GetChars(), part->size_);
+        pos += part->size_;
     }
-    scope->Define(GetName(GetFirst(root)), Evaluate(scope, GetFirst(GetSecond(root))));
-    return nullptr;
+    // the parts may be collected now
+    left_ = right_ = nullptr;
 }
 
-Node Set::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root)) {
-        throw SyntaxError("Set requires 2 arguments");
+// short pieces appended to a rope are merged with its last part, so that building a string
+// piece by piece doesn't make an object per piece
+String* String::Concat(String* lhs, String* rhs) {
+    auto& heap = Heap::GetInstance();
+    if (!lhs->size_) {
+        return rhs;
     }
-    if (!Is<Symbol>(GetFirst(root))) {
-        throw SyntaxError("Bad argument to set");
+    if (!rhs->size_) {
+        return lhs;
     }
-    if (GetSecond(GetSecond(root)) != nullptr) {
-        throw SyntaxError("Set requires 2 arguments");
+    if (lhs->size_ + rhs->size_ < kMinRopeSize) {
+        std::string text(lhs->GetView());
+        text += rhs->GetView();
+        return As<String>(heap.Make<String>(std::string_view(text)));
     }
-    scope->Set(GetName(GetFirst(root)), Evaluate(scope, GetFirst(GetSecond(root))));
-    return nullptr;
+    if (lhs->IsRope() && !lhs->right_->IsRope() &&
+        lhs->right_->size_ + rhs->size_ < kMinRopeSize) {
+        return As<String>(heap.Make<String>(lhs->left_, Concat(lhs->right_, rhs)));
+    }
+    return As<String>(heap.Make<String>(lhs, rhs));
 }
 
-Node SetCar::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root) || !Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
-        throw SyntaxError("set-car! requires 2 arguments");
+Vector::Vector(std::vector<Node> elements) {
+    if (!elements.empty() && std::all_of(elements.begin(), elements.end(), Is<Number>)) {
+        storage_ = Storage::kFixnums;
+        for (auto element : elements) {
+            fixnums_.push_back(As<Number>(element)->GetValue());
+        }
+    } else if (!elements.empty() && std::all_of(elements.begin(), elements.end(), Is<Flonum>)) {
+        storage_ = Storage::kFlonums;
+        for (auto element : elements) {
+            flonums_.push_back(As<Flonum>(element)->GetValue());
+        }
+    } else {
+        objects_ = std::move(elements);
     }
-    auto obj = Evaluate(scope, GetFirst(root));
-    GetFirst(obj) = Evaluate(scope, GetFirst(GetSecond(root)));
-    obj->Update();
-    return nullptr;
 }
 
-Node SetCdr::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root) || !Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
+Vector::Vector(size_t size, Node fill) : objects_(size) {
+    Fill(fill);
+}
+
+size_t Vector::GetSize() const {
+    switch (storage_) {
+        case Storage::kFixnums:
+            return fixnums_.size();
+        case Storage::kFlonums:
+            return flonums_.size();
+        default:
+            return objects_.size();
+    }
+}
+
+Node Vector::Get(size_t i) const {
+    switch (storage_) {
+        case Storage::kFixnums:
+            return Heap::GetInstance().Make<Number>(fixnums_[i]);
+        case Storage::kFlonums:
+            return Heap::GetInstance().Make<Flonum>(flonums_[i]);
+        default:
+            return objects_[i];
+    }
+}
+
+void Vector::Set(size_t i, Node value) {
+    if (storage_ == Storage::kFixnums && Is<Number>(value)) {
+        fixnums_[i] = As<Number>(value)->GetValue();
+    } else if (storage_ == Storage::kFlonums && Is<Flonum>(value)) {
+        flonums_[i] = As<Flonum>(value)->GetValue();
+    } else {
+        BoxElements();
+        objects_[i] = value;
+    }
+}
+
+void Vector::Fill(Node value) {
+    size_t size = GetSize();
+    objects_.clear();
+    fixnums_.clear();
+    flonums_.clear();
+    if (auto number = As<Number>(value); number && size) {
+        storage_ = Storage::kFixnums;
+        fixnums_.assign(size, number->GetValue());
+    } else if (auto number = As<Flonum>(value); number && size) {
+        storage_ = Storage::kFlonums;
+        flonums_.assign(size, number->GetValue());
+    } else {
+        storage_ = Storage::kObjects;
+        objects_.assign(size, value);
+    }
+}
+
+void Vector::BoxElements() {
+    if (storage_ == Storage::kObjects) {
+        return;
+    }
+    objects_.resize(GetSize());
+    for (size_t i = 0; i < objects_.size(); ++i) {
+        objects_[i] = Get(i);
+    }
+    fixnums_.clear();
+    flonums_.clear();
+    storage_ = Storage::kObjects;
+}
+
+Vector* RequireVector(Node root) {
+    auto vector = As<Vector>(root);
+    if (!vector) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return vector;
+}
+
+// value of an index argument, which has to be below size
+size_t RequireIndex(Node root, size_t size) {
+    auto number = As<Number>(root);
+    if (!number) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    if (number->GetValue() < 0 || static_cast<uint64_t>(number->GetValue()) >= size) {
+        throw RuntimeError("Vector index out of bounds");
+    }
+    return number->GetValue();
+}
+
+Node IsVector::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Bool(scope, Is<Vector>(args[0]));
+}
+
+Node MakeVector::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 2);
+    auto size = As<Number>(args[0]);
+    if (!size || size->GetValue() < 0) {
+        throw RuntimeError("Vector size has to be a non-negative integer");
+    }
+    Node fill = args.size() == 2 ? args[1] : Heap::GetInstance().Make<Number>(0);
+    return Heap::GetInstance().Make<Vector>(static_cast<size_t>(size->GetValue()), fill);
+}
+
+Node BuildVector::Apply(Scope*, std::vector<Node>& args) {
+    return Heap::GetInstance().Make<Vector>(args);
+}
+
+// unboxed elements are made like the result of any other builtin, so they can be
+// temporaries
+Node VectorRef::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    auto vector = RequireVector(args[0]);
+    size_t index = RequireIndex(args[1], vector->GetSize());
+    switch (vector->GetStorage()) {
+        case Vector::Storage::kFixnums:
+            return MakeNumber(scope, vector->GetFixnums()[index]);
+        case Vector::Storage::kFlonums:
+            return MakeFlonum(scope, vector->GetFlonums()[index]);
+        default:
+            return vector->GetObjects()[index];
+    }
+}
+
+Node VectorSet::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3, 3);
+    auto vector = RequireVector(args[0]);
+    vector->Set(RequireIndex(args[1], vector->GetSize()), args[2]);
+    return nullptr;
+}
+
+Node VectorLength::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, RequireVector(args[0])->GetSize());
+}
+
+Node VectorFill::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    RequireVector(args[0])->Fill(args[1]);
+    return nullptr;
+}
+
+// the elements of any storage as objects
+std::vector<Node> GetElements(Vector* vector) {
+    if (vector->GetStorage() == Vector::Storage::kObjects) {
+        return vector->GetObjects();
+    }
+    std::vector<Node> elements(vector->GetSize());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        elements[i] = vector->Get(i);
+    }
+    return elements;
+}
+
+// the flonums of unboxed numeric storage, fixnums are converted into buffer
+const double* GetFlonums(Vector* vector, std::vector<double>* buffer) {
+    if (vector->GetStorage() == Vector::Storage::kFlonums) {
+        return vector->GetFlonums().data();
+    }
+    auto& fixnums = vector->GetFixnums();
+    buffer->assign(fixnums.begin(), fixnums.end());
+    return buffer->data();
+}
+
+bool Unboxed(Vector* vector) {
+    return vector->GetStorage() != Vector::Storage::kObjects;
+}
+
+// the arguments of an element-wise operation, a number is repeated to the size of the
+// vector on the other side
+std::pair<Vector*, Vector*> RequireOperands(std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    auto lhs = As<Vector>(args[0]);
+    auto rhs = As<Vector>(args[1]);
+    if (lhs && !rhs && IsNumeric(args[1])) {
+        rhs = As<Vector>(Heap::GetInstance().Make<Vector>(lhs->GetSize(), args[1]));
+    } else if (!lhs && rhs && IsNumeric(args[0])) {
+        lhs = As<Vector>(Heap::GetInstance().Make<Vector>(rhs->GetSize(), args[0]));
+    }
+    if (!lhs || !rhs) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    if (lhs->GetSize() != rhs->GetSize()) {
+        throw RuntimeError("Vectors of different lengths");
+    }
+    return {lhs, rhs};
+}
+
+// what a builtin makes to be stored in a vector is never a temporary, even if the vector is
+class PersistentGuard {
+public:
+    explicit PersistentGuard(Scope* scope) : scope_(scope), temporary_(scope->IsTemporary()) {
+        scope_->SetTemporary(false);
+    }
+
+    ~PersistentGuard() {
+        scope_->SetTemporary(temporary_);
+    }
+
+private:
+    Scope* scope_;
+    bool temporary_;
+};
+
+// fixnum sums that don't fit and elements of other kinds go through +
+Node VectorSum::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto vector = RequireVector(args[0]);
+    if (vector->GetStorage() == Vector::Storage::kFlonums) {
+        auto& flonums = vector->GetFlonums();
+        return MakeFlonum(scope, SumFlonums(flonums.data(), flonums.size()));
+    }
+    int64_t sum;
+    if (vector->GetStorage() == Vector::Storage::kFixnums &&
+        SumFixnums(vector->GetFixnums().data(), vector->GetSize(), &sum)) {
+        return MakeNumber(scope, sum);
+    }
+    auto elements = GetElements(vector);
+    return Plus().Apply(scope, elements);
+}
+
+Node VectorDot::Apply(Scope* scope, std::vector<Node>& args) {
+    auto [lhs, rhs] = RequireOperands(args);
+    size_t size = lhs->GetSize();
+    if (Unboxed(lhs) && Unboxed(rhs)) {
+        int64_t sum;
+        if (lhs->GetStorage() == Vector::Storage::kFixnums &&
+            rhs->GetStorage() == Vector::Storage::kFixnums) {
+            if (DotFixnums(lhs->GetFixnums().data(), rhs->GetFixnums().data(), size, &sum)) {
+                return MakeNumber(scope, sum);
+            }
+        } else {
+            std::vector<double> lhs_buffer, rhs_buffer;
+            return MakeFlonum(scope, DotFlonums(GetFlonums(lhs, &lhs_buffer),
+                                                GetFlonums(rhs, &rhs_buffer), size));
+        }
+    }
+    std::vector<Node> products(size);
+    for (size_t i = 0; i < size; ++i) {
+        std::vector<Node> pair{lhs->Get(i), rhs->Get(i)};
+        products[i] = Mult().Apply(scope, pair);
+    }
+    return Plus().Apply(scope, products);
+}
+
+// an empty vector or elements of other kinds go through min and max
+Node VectorMin::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto vector = RequireVector(args[0]);
+    switch (vector->GetStorage()) {
+        case Vector::Storage::kFixnums:
+            return MakeNumber(scope, MinFixnums(vector->GetFixnums().data(), vector->GetSize()));
+        case Vector::Storage::kFlonums:
+            return MakeFlonum(scope, MinFlonums(vector->GetFlonums().data(), vector->GetSize()));
+        default:
+            return Min().Apply(scope, vector->GetObjects());
+    }
+}
+
+Node VectorMax::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto vector = RequireVector(args[0]);
+    switch (vector->GetStorage()) {
+        case Vector::Storage::kFixnums:
+            return MakeNumber(scope, MaxFixnums(vector->GetFixnums().data(), vector->GetSize()));
+        case Vector::Storage::kFlonums:
+            return MakeFlonum(scope, MaxFlonums(vector->GetFlonums().data(), vector->GetSize()));
+        default:
+            return Max().Apply(scope, vector->GetObjects());
+    }
+}
+
+// fixnum results that don't fit and elements of other kinds are combined one by one
+Node ElementWise::Apply(Scope* scope, std::vector<Node>& args) {
+    auto [lhs, rhs] = RequireOperands(args);
+    size_t size = lhs->GetSize();
+    auto& heap = Heap::GetInstance();
+    if (Unboxed(lhs) && Unboxed(rhs)) {
+        if (lhs->GetStorage() == Vector::Storage::kFixnums &&
+            rhs->GetStorage() == Vector::Storage::kFixnums) {
+            std::vector<int64_t> res(size);
+            if (Combine(lhs->GetFixnums().data(), rhs->GetFixnums().data(), res.data(), size)) {
+                return heap.Make<Vector>(std::move(res));
+            }
+        } else {
+            std::vector<double> lhs_buffer, rhs_buffer, res(size);
+            Combine(GetFlonums(lhs, &lhs_buffer), GetFlonums(rhs, &rhs_buffer), res.data(),
+                    size);
+            return heap.Make<Vector>(std::move(res));
+        }
+    }
+    PersistentGuard guard(scope);
+    std::vector<Node> elements(size);
+    for (size_t i = 0; i < size; ++i) {
+        std::vector<Node> pair{lhs->Get(i), rhs->Get(i)};
+        elements[i] = Combine(scope, pair);
+    }
+    return heap.Make<Vector>(std::move(elements));
+}
+
+Node VectorAdd::Combine(Scope* scope, std::vector<Node>& args) const {
+    return Plus().Apply(scope, args);
+}
+
+Node VectorMul::Combine(Scope* scope, std::vector<Node>& args) const {
+    return Mult().Apply(scope, args);
+}
+
+bool Holds(Node lhs, Node rhs, Comparison comparison) {
+    if (!IsNumeric(lhs) || !IsNumeric(rhs)) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    switch (comparison) {
+        case Comparison::kEqual:
+            return CompareNumbers(lhs, rhs, std::equal_to<>());
+        case Comparison::kLess:
+            return CompareNumbers(lhs, rhs, std::less<>());
+        case Comparison::kGreater:
+            return CompareNumbers(lhs, rhs, std::greater<>());
+        case Comparison::kLeq:
+            return CompareNumbers(lhs, rhs, std::less_equal<>());
+        default:
+            return CompareNumbers(lhs, rhs, std::greater_equal<>());
+    }
+}
+
+Node VectorComparison::Apply(Scope*, std::vector<Node>& args) {
+    auto [lhs, rhs] = RequireOperands(args);
+    size_t size = lhs->GetSize();
+    std::vector<int64_t> mask(size);
+    if (lhs->GetStorage() == Vector::Storage::kFixnums &&
+        rhs->GetStorage() == Vector::Storage::kFixnums) {
+        CompareFixnums(lhs->GetFixnums().data(), rhs->GetFixnums().data(), mask.data(), size,
+                       GetComparison());
+    } else if (Unboxed(lhs) && Unboxed(rhs)) {
+        std::vector<double> lhs_buffer, rhs_buffer;
+        CompareFlonums(GetFlonums(lhs, &lhs_buffer), GetFlonums(rhs, &rhs_buffer), mask.data(),
+                       size, GetComparison());
+    } else {
+        for (size_t i = 0; i < size; ++i) {
+            mask[i] = Holds(lhs->Get(i), rhs->Get(i), GetComparison());
+        }
+    }
+    return Heap::GetInstance().Make<Vector>(std::move(mask));
+}
+
+void RequireProcedure(Node root) {
+    if (!Is<Lambda>(root) && !Is<Builtin>(root)) {
+        throw RuntimeError("Object not callable");
+    }
+}
+
+// calls a lambda or a builtin without evaluating anything, a builtin may change args
+Node CallProcedure(Scope* scope, Node procedure, std::vector<Node>& args) {
+    if (auto lambda = As<Lambda>(procedure)) {
+        return lambda->Apply(scope, args.data(), args.size());
+    }
+    RequireProcedure(procedure);
+    return As<Builtin>(procedure)->Apply(scope, args);
+}
+
+HashTable* RequireHashTable(Node root) {
+    auto table = As<HashTable>(root);
+    if (!table) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return table;
+}
+
+Node IsHashTable::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Bool(scope, Is<HashTable>(args[0]));
+}
+
+Node MakeHashTable::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 0, 0);
+    return Heap::GetInstance().Make<HashTable>();
+}
+
+Node HashTableRef::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 3);
+    if (auto value = RequireHashTable(args[0])->Find(args[1])) {
+        return *value;
+    }
+    if (args.size() == 3) {
+        return args[2];
+    }
+    throw RuntimeError("Key not found in hash table");
+}
+
+Node HashTableSet::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3, 3);
+    RequireHashTable(args[0])->Insert(args[1], args[2]);
+    return nullptr;
+}
+
+Node HashTableDelete::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    RequireHashTable(args[0])->Erase(args[1]);
+    return nullptr;
+}
+
+Node HashTableContains::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return Bool(scope, RequireHashTable(args[0])->Find(args[1]));
+}
+
+Node HashTableCount::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, RequireHashTable(args[0])->GetSize());
+}
+
+Node HashTableKeys::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    Node res = nullptr;
+    RequireHashTable(args[0])->ForEach(
+        [&res](Node key, Node) { res = Heap::GetInstance().Make<Cell>(key, res); });
+    return res;
+}
+
+Node HashTableValues::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    Node res = nullptr;
+    RequireHashTable(args[0])->ForEach(
+        [&res](Node, Node value) { res = Heap::GetInstance().Make<Cell>(value, res); });
+    return res;
+}
+
+Node HashTableToList::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto& heap = Heap::GetInstance();
+    Node res = nullptr;
+    RequireHashTable(args[0])->ForEach([&res, &heap](Node key, Node value) {
+        res = heap.Make<Cell>(heap.Make<Cell>(key, value), res);
+    });
+    return res;
+}
+
+// the entries are taken before the first call, so the procedure may change the table
+Node HashTableWalk::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    std::vector<std::pair<Node, Node>> entries;
+    RequireHashTable(args[0])->ForEach(
+        [&entries](Node key, Node value) { entries.emplace_back(key, value); });
+    RequireProcedure(args[1]);
+    PersistentGuard guard(scope);
+    std::vector<Node> call_args;
+    for (auto [key, value] : entries) {
+        call_args.assign({key, value});
+        CallProcedure(scope, args[1], call_args);
+    }
+    return nullptr;
+}
+
+PersistentMap* RequirePersistentMap(Node root) {
+    auto map = As<PersistentMap>(root);
+    if (!map) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return map;
+}
+
+Node MakePersistentMap::Apply(Scope*, std::vector<Node>& args) {
+    if (args.size() % 2) {
+        throw RuntimeError("Every key of a map needs a value");
+    }
+    auto map = As<PersistentMap>(Heap::GetInstance().Make<PersistentMap>());
+    for (size_t i = 0; i < args.size(); i += 2) {
+        map = map->Insert(args[i], args[i + 1]);
+    }
+    return map;
+}
+
+Node IsPersistentMap::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Bool(scope, Is<PersistentMap>(args[0]));
+}
+
+Node PersistentMapRef::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 3);
+    if (auto value = RequirePersistentMap(args[0])->Find(args[1])) {
+        return *value;
+    }
+    if (args.size() == 3) {
+        return args[2];
+    }
+    throw RuntimeError("Key not found in map");
+}
+
+Node PersistentMapSet::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3, 3);
+    return RequirePersistentMap(args[0])->Insert(args[1], args[2]);
+}
+
+Node PersistentMapDelete::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return RequirePersistentMap(args[0])->Erase(args[1]);
+}
+
+Node PersistentMapContains::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return Bool(scope, RequirePersistentMap(args[0])->Find(args[1]));
+}
+
+Node PersistentMapCount::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, RequirePersistentMap(args[0])->GetSize());
+}
+
+Node PersistentMapToList::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto& heap = Heap::GetInstance();
+    Node res = nullptr;
+    RequirePersistentMap(args[0])->ForEach([&res, &heap](Node key, Node value) {
+        res = heap.Make<Cell>(heap.Make<Cell>(key, value), res);
+    });
+    return res;
+}
+
+PersistentVector* RequirePersistentVector(Node root) {
+    auto vector = As<PersistentVector>(root);
+    if (!vector) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return vector;
+}
+
+Node MakePersistentVector::Apply(Scope*, std::vector<Node>& args) {
+    auto vector = As<PersistentVector>(Heap::GetInstance().Make<PersistentVector>());
+    for (auto arg : args) {
+        vector = vector->Push(arg);
+    }
+    return vector;
+}
+
+Node IsPersistentVector::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Bool(scope, Is<PersistentVector>(args[0]));
+}
+
+Node PersistentVectorRef::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    auto vector = RequirePersistentVector(args[0]);
+    return vector->Get(RequireIndex(args[1], vector->GetSize()));
+}
+
+Node PersistentVectorSet::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3, 3);
+    auto vector = RequirePersistentVector(args[0]);
+    return vector->Set(RequireIndex(args[1], vector->GetSize()), args[2]);
+}
+
+Node PersistentVectorPush::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return RequirePersistentVector(args[0])->Push(args[1]);
+}
+
+Node PersistentVectorLength::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, RequirePersistentVector(args[0])->GetSize());
+}
+
+Node PersistentVectorToList::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto vector = RequirePersistentVector(args[0]);
+    Node res = nullptr;
+    for (size_t i = vector->GetSize(); i > 0; --i) {
+        res = Heap::GetInstance().Make<Cell>(vector->Get(i - 1), res);
+    }
+    return res;
+}
+
+String* RequireString(Node root) {
+    auto string = As<String>(root);
+    if (!string) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return string;
+}
+
+Node IsString::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Bool(scope, Is<String>(args[0]));
+}
+
+Node StringLength::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, RequireString(args[0])->GetSize());
+}
+
+Node StringAppend::Apply(Scope*, std::vector<Node>& args) {
+    String* res = As<String>(Heap::GetInstance().Make<String>(std::string_view()));
+    for (auto arg : args) {
+        res = String::Concat(res, RequireString(arg));
+    }
+    return res;
+}
+
+Node Substring::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 3);
+    auto text = RequireString(args[0])->GetView();
+    auto start = As<Number>(args[1]);
+    auto end = args.size() == 3 ? As<Number>(args[2]) : nullptr;
+    if (!start || (args.size() == 3 && !end)) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    int64_t to = end ? end->GetValue() : text.size();
+    if (start->GetValue() < 0 || start->GetValue() > to ||
+        static_cast<uint64_t>(to) > text.size()) {
+        throw RuntimeError("String index out of bounds");
+    }
+    return Heap::GetInstance().Make<String>(text.substr(start->GetValue(), to - start->GetValue()));
+}
+
+Node StringToSymbol::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return Heap::GetInstance().Intern(std::string(RequireString(args[0])->GetView()));
+}
+
+Node SymbolToString::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    if (!Is<Symbol>(args[0])) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return Heap::GetInstance().Make<String>(std::string_view(GetName(args[0])));
+}
+
+Node NumberToString::Apply(Scope*, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    if (!IsNumeric(args[0])) {
+        throw RuntimeError("Certain argument type required, invalid type given");
+    }
+    return Heap::GetInstance().Make<String>(std::string_view(Convert(args[0])));
+}
+
+// the text is read by the tokenizer, so it accepts exactly the number literals
+Node StringToNumber::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    auto text = RequireString(args[0])->GetView();
+    if (text.empty() || std::isspace(static_cast<unsigned char>(text.front())) ||
+        std::isspace(static_cast<unsigned char>(text.back()))) {
+        return Bool(scope, false);
+    }
+    std::stringstream stream{std::string(text)};
+    try {
+        Tokenizer tokenizer(&stream);
+        Token token = tokenizer.GetToken();
+        tokenizer.Next();
+        if (!tokenizer.IsEnd()) {
+            return Bool(scope, false);
+        }
+        if (auto constant = std::get_if<ConstantToken>(&token)) {
+            return MakeNumber(scope, constant->value_);
+        }
+        if (auto constant = std::get_if<BigConstantToken>(&token)) {
+            return Heap::GetInstance().Make<BigNumber>(BigInt::Parse(constant->digits_));
+        }
+        if (auto constant = std::get_if<FloatConstantToken>(&token)) {
+            return MakeFlonum(scope, constant->value_);
+        }
+    } catch (SyntaxError&) {
+    }
+    return Bool(scope, false);
+}
+
+Node SetCar::Run(Scope* scope, Node root) {
+    if (!Is<Cell>(root) || !Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
+        throw SyntaxError("set-car! requires 2 arguments");
+    }
+    auto obj = Evaluate(scope, GetFirst(root));
+    GetFirst(obj) = Evaluate(scope, GetFirst(GetSecond(root)));
+    obj->Update();
+    return nullptr;
+}
+
+Node SetCdr::Run(Scope* scope, Node root) {
+    if (!Is<Cell>(root) || !Is<Cell>(GetSecond(root)) || GetSecond(GetSecond(root))) {
         throw SyntaxError("set-cdr! requires 2 arguments");
     }
-    auto obj = Evaluate(scope, GetFirst(root));
-    GetSecond(obj) = Evaluate(scope, GetFirst(GetSecond(root)));
+    auto obj = Evaluate(scope, GetFirst(root));
+    GetSecond(obj) = Evaluate(scope, GetFirst(GetSecond(root)));
+    if (auto block = As<Cell>(obj)->GetBlock()) {
+        block->Unlink();
+    }
+    return nullptr;
+}
+
+Node Quote::Eval(Scope*) {
+    return datum_;
+}
+
+// slot of a variable of the running lambda
+Node& VariableSlot(Scope* scope, bool captured, size_t index, bool boxed) {
+    Frame* frame = scope->GetFrame();
+    Node& slot = captured ? frame->closure->GetCaptures()[index] : frame->slots[index];
+    if (boxed) {
+        return As<Box>(slot)->Get();
+    }
+    return slot;
+}
+
+Node LocalVariable::Eval(Scope* scope) {
+    Node res = VariableSlot(scope, captured_, index_, boxed_);
+    if (res == Unassigned()) {
+        throw NameError("Variable used before its definition");
+    }
+    return res;
+}
+
+Node LocalAssignment::Eval(Scope* scope) {
+    Node value = Evaluate(scope, value_);
+    VariableSlot(scope, captured_, index_, boxed_) = value;
+    return nullptr;
+}
+
+Node If::Eval(Scope* scope) {
+    if (IsTrue(Evaluate(scope, condition_))) {
+        return Evaluate(scope, then_branch_);
+    }
+    if (has_else_) {
+        return Evaluate(scope, else_branch_);
+    }
+    return nullptr;
+}
+
+Node Define::Eval(Scope* scope) {
+    scope->Define(name_, Evaluate(scope, value_));
+    return nullptr;
+}
+
+Node Set::Eval(Scope* scope) {
+    scope->Set(name_, Evaluate(scope, value_));
+    return nullptr;
+}
+
+Node ConstructLambda::Eval(Scope* scope) {
+    std::vector<Node> captures;
+    captures.reserve(captures_.size());
+    for (auto [captured, index] : captures_) {
+        captures.push_back(VariableSlot(scope, captured, index, false));
+    }
+    return Heap::GetInstance().Make<Lambda>(this, captures);
+}
+
+Node Guard::Eval(Scope* scope) {
+    return Evaluate(scope, Holds() ? optimized_ : original_);
+}
+
+Node And::Eval(Scope* scope) {
+    Node res = Bool(scope, 1);
+    for (auto arg : args_) {
+        res = Evaluate(scope, arg);
+        if (IsFalse(res)) {
+            return res;
+        }
+    }
+    return res;
+}
+
+Node Or::Eval(Scope* scope) {
+    Node res = Bool(scope, 0);
+    for (auto arg : args_) {
+        res = Evaluate(scope, arg);
+        if (IsTrue(res)) {
+            return res;
+        }
+    }
+    return res;
+}
+
+Node Lambda::Run(Scope* scope, Node root) {
+    FrameGuard guard(scope);
+    Frame frame;
+    frame.slots = scope->GetStack().Allocate(code_->GetFrameSize());
+    frame.closure = this;
+
+    // arguments are evaluated in the frame of the caller
+    for (size_t i = 0; i < code_->GetArity(); ++i) {
+        if (!root) {
+            throw RuntimeError("Incorrect number of arguments for lambda function");
+        }
+        frame.slots[i] = Evaluate(scope, GetFirst(root));
+        root = GetSecond(root);
+    }
+    if (root) {
+        throw RuntimeError("Incorrect number of arguments for lambda function");
+    }
+    return Enter(scope, &frame);
+}
+
+Node Lambda::Apply(Scope* scope, Node* args, size_t count) {
+    if (count != code_->GetArity()) {
+        throw RuntimeError("Incorrect number of arguments for lambda function");
+    }
+    FrameGuard guard(scope);
+    Frame frame;
+    frame.slots = scope->GetStack().Allocate(code_->GetFrameSize());
+    frame.closure = this;
+    std::copy(args, args + count, frame.slots);
+    return Enter(scope, &frame);
+}
+
+Node Lambda::Invoke(Scope* scope, const std::vector<Compiled>& args, Node) {
+    if (args.size() != code_->GetArity()) {
+        throw RuntimeError("Incorrect number of arguments for lambda function");
+    }
+    FrameGuard guard(scope);
+    Frame frame;
+    frame.slots = scope->GetStack().Allocate(code_->GetFrameSize());
+    frame.closure = this;
+    for (size_t i = 0; i < args.size(); ++i) {
+        frame.slots[i] = args[i](scope);
+    }
+    return Enter(scope, &frame);
+}
+
+// flonums are the same key if they have the same representation, so 0.0 and -0.0 are
+// different ones and a NaN is the same as itself
+uint64_t FlonumBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t FlonumBits(Node value) {
+    return FlonumBits(As<Flonum>(value)->GetValue());
+}
+
+void MixHash(size_t part, size_t* hash) {
+    *hash ^= part + 0x9e3779b97f4a7c15 + (*hash << 6) + (*hash >> 2);
+}
+
+// mixes the structure of value into hash, false once more than budget pairs were seen; the
+// pairs seen until then are still mixed in, so large keys hash by their prefix
+bool HashValue(Node value, size_t* budget, size_t* hash) {
+    size_t part;
+    bool complete = true;
+    if (!value) {
+        part = 0;
+    } else if (auto number = As<Number>(value)) {
+        part = std::hash<int64_t>()(number->GetValue());
+    } else if (auto number = As<BigNumber>(value)) {
+        part = number->GetValue().Hash();
+    } else if (Is<Flonum>(value)) {
+        part = std::hash<uint64_t>()(FlonumBits(value));
+    } else if (auto symbol = As<Symbol>(value)) {
+        part = std::hash<std::string>()(symbol->GetName());
+    } else if (auto string = As<String>(value)) {
+        part = std::hash<std::string_view>()(string->GetView());
+    } else if (Is<Cell>(value)) {
+        if (!*budget) {
+            return false;
+        }
+        --*budget;
+        part = 1;
+        complete = HashValue(GetFirst(value), budget, &part) &&
+                   HashValue(GetSecond(value), budget, &part);
+    } else if (auto vector = As<Vector>(value)) {
+        // unboxed elements hash like the numbers they stand for
+        part = 2;
+        for (size_t i = 0; complete && i < vector->GetSize(); ++i) {
+            if (!*budget) {
+                complete = false;
+                break;
+            }
+            --*budget;
+            if (vector->GetStorage() == Vector::Storage::kFixnums) {
+                MixHash(std::hash<int64_t>()(vector->GetFixnums()[i]), &part);
+            } else if (vector->GetStorage() == Vector::Storage::kFlonums) {
+                MixHash(std::hash<uint64_t>()(FlonumBits(vector->GetFlonums()[i])), &part);
+            } else {
+                complete = HashValue(vector->GetObjects()[i], budget, &part);
+            }
+        }
+    } else {
+        // procedures are only equal to themselves
+        part = std::hash<Node>()(value);
+    }
+    MixHash(part, hash);
+    return complete;
+}
+
+// eqv?: the same object, or numbers of the same exactness and value
+bool SameAtom(Node lhs, Node rhs) {
+    if (lhs == rhs) {
+        return true;
+    }
+    if (IsInteger(lhs) && IsInteger(rhs)) {
+        return !CompareIntegers(lhs, rhs);
+    }
+    if (Is<Flonum>(lhs) && Is<Flonum>(rhs)) {
+        return FlonumBits(lhs) == FlonumBits(rhs);
+    }
+    return false;
+}
+
+// element i of unboxed vector against value
+bool SameElement(Vector* vector, size_t i, Node value) {
+    if (vector->GetStorage() == Vector::Storage::kFixnums) {
+        return Is<Number>(value) && As<Number>(value)->GetValue() == vector->GetFixnums()[i];
+    }
+    return Is<Flonum>(value) && FlonumBits(value) == FlonumBits(vector->GetFlonums()[i]);
+}
+
+// set of the pairs of pairs or vectors compared by SameValue, with open addressing in one
+// array; an empty slot holds two nullptrs
+class NodePairSet {
+public:
+    // false if the pair was there already
+    bool Insert(Node lhs, Node rhs) {
+        if (2 * (size_ + 1) > slots_.size()) {
+            Grow();
+        }
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Home(lhs, rhs) & mask;; i = (i + 1) & mask) {
+            if (!slots_[i].first) {
+                slots_[i] = {lhs, rhs};
+                ++size_;
+                return true;
+            }
+            if (slots_[i].first == lhs && slots_[i].second == rhs) {
+                return false;
+            }
+        }
+    }
+
+private:
+    static size_t Home(Node lhs, Node rhs) {
+        size_t hash = reinterpret_cast<uintptr_t>(lhs) * 0x9e3779b97f4a7c15;
+        return (hash ^ reinterpret_cast<uintptr_t>(rhs)) * 0x9e3779b97f4a7c15 >> 20;
+    }
+
+    void Grow() {
+        std::vector<std::pair<Node, Node>> old(std::max<size_t>(1024, 2 * slots_.size()));
+        old.swap(slots_);
+        size_ = 0;
+        for (auto [lhs, rhs] : old) {
+            if (lhs) {
+                Insert(lhs, rhs);
+            }
+        }
+    }
+
+    std::vector<std::pair<Node, Node>> slots_;
+    size_t size_ = 0;
+};
+
+// equal?, compares pairs and vectors with a stack of its own, so long lists don't overflow
+// the one of the thread. After kUncheckedSteps pairs the ones compared so far are recorded
+// and a pair seen again is taken as equal, which makes cyclic structures compare in finite
+// time; keys that small never allocate the set.
+bool SameValue(Node lhs, Node rhs) {
+    constexpr size_t kUncheckedSteps = 1000;
+    if (SameAtom(lhs, rhs)) {
+        return true;
+    }
+    std::vector<std::pair<Node, Node>> pending{{lhs, rhs}};
+    NodePairSet visited;
+    size_t steps = 0;
+    while (!pending.empty()) {
+        auto [lhs, rhs] = pending.back();
+        pending.pop_back();
+        if (SameAtom(lhs, rhs)) {
+            continue;
+        }
+        if (auto lhs_string = As<String>(lhs)) {
+            if (!Is<String>(rhs) || lhs_string->GetView() != As<String>(rhs)->GetView()) {
+                return false;
+            }
+            continue;
+        }
+        bool cells = Is<Cell>(lhs) && Is<Cell>(rhs);
+        bool vectors = Is<Vector>(lhs) && Is<Vector>(rhs);
+        if (!cells && !vectors) {
+            return false;
+        }
+        if (++steps > kUncheckedSteps && !visited.Insert(lhs, rhs)) {
+            continue;
+        }
+        if (cells) {
+            pending.emplace_back(GetSecond(lhs), GetSecond(rhs));
+            pending.emplace_back(GetFirst(lhs), GetFirst(rhs));
+            continue;
+        }
+        auto lhs_vector = As<Vector>(lhs);
+        auto rhs_vector = As<Vector>(rhs);
+        size_t size = lhs_vector->GetSize();
+        if (size != rhs_vector->GetSize()) {
+            return false;
+        }
+        if (Unboxed(rhs_vector)) {
+            std::swap(lhs_vector, rhs_vector);
+        }
+        if (!Unboxed(lhs_vector)) {
+            for (size_t i = size; i > 0; --i) {
+                pending.emplace_back(lhs_vector->GetObjects()[i - 1],
+                                     rhs_vector->GetObjects()[i - 1]);
+            }
+        } else if (lhs_vector->GetStorage() == Vector::Storage::kFixnums &&
+                   rhs_vector->GetStorage() == Vector::Storage::kFixnums) {
+            if (lhs_vector->GetFixnums() != rhs_vector->GetFixnums()) {
+                return false;
+            }
+        } else if (lhs_vector->GetStorage() == rhs_vector->GetStorage()) {
+            for (size_t i = 0; i < size; ++i) {
+                if (FlonumBits(lhs_vector->GetFlonums()[i]) !=
+                    FlonumBits(rhs_vector->GetFlonums()[i])) {
+                    return false;
+                }
+            }
+        } else if (!Unboxed(rhs_vector)) {
+            for (size_t i = 0; i < size; ++i) {
+                if (!SameElement(lhs_vector, i, rhs_vector->GetObjects()[i])) {
+                    return false;
+                }
+            }
+        } else if (size) {
+            // fixnums against flonums
+            return false;
+        }
+    }
+    return true;
+}
+
+Node CopyValue(Node value) {
+    if (auto vector = As<Vector>(value)) {
+        if (vector->GetStorage() != Vector::Storage::kObjects) {
+            return vector->Clone();
+        }
+        std::vector<Node> elements;
+        for (auto element : vector->GetObjects()) {
+            elements.push_back(CopyValue(element));
+        }
+        return Heap::GetInstance().Make<Vector>(elements);
+    }
+    if (!Is<Cell>(value)) {
+        return value;
+    }
+    return Heap::GetInstance().Make<Cell>(CopyValue(GetFirst(value)),
+                                          CopyValue(GetSecond(value)));
+}
+
+bool MemoTable::Hash(const Node* args, size_t count, size_t* hash) {
+    size_t budget = kMaxKeySize;
+    *hash = count;
+    for (size_t i = 0; i < count; ++i) {
+        if (!HashValue(args[i], &budget, hash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Node> MemoTable::Copy(const Node* args, size_t count) {
+    std::vector<Node> res;
+    res.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        res.push_back(CopyValue(args[i]));
+    }
+    return res;
+}
+
+bool MemoTable::Find(size_t hash, const Node* args, size_t count, Node* res) {
+    auto [begin, end] = index_.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        auto entry = it->second;
+        if (entry->args.size() != count ||
+            !std::equal(entry->args.begin(), entry->args.end(), args, SameValue)) {
+            continue;
+        }
+        entries_.splice(entries_.begin(), entries_, entry);
+        *res = entry->res;
+        return true;
+    }
+    return false;
+}
+
+size_t MemoTable::Insert(size_t hash, std::vector<Node> args, Node res, size_t capacity) {
+    size_t evicted = 0;
+    while (!entries_.empty() && entries_.size() >= capacity) {
+        auto last = std::prev(entries_.end());
+        auto [begin, end] = index_.equal_range(last->hash);
+        for (auto it = begin; it != end; ++it) {
+            if (it->second == last) {
+                index_.erase(it);
+                break;
+            }
+        }
+        entries_.pop_back();
+        ++evicted;
+    }
+    if (capacity) {
+        entries_.push_front({hash, std::move(args), res});
+        index_.emplace(hash, entries_.begin());
+    }
+    return evicted;
+}
+
+void MemoTable::Update() {
+    dependants_.clear();
+    for (auto& entry : entries_) {
+        for (auto arg : entry.args) {
+            AddDependant(arg);
+        }
+        AddDependant(entry.res);
+    }
+}
+
+// keys hash like the arguments of memoized calls; structure past kMaxKeySize nodes isn't
+// hashed, which is still the same for equal keys and lets cyclic keys hash too
+size_t HashKey(Node key) {
+    size_t budget = MemoTable::kMaxKeySize;
+    size_t hash = 0;
+    HashValue(key, &budget, &hash);
+    return hash;
+}
+
+Node IsEq::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return Bool(scope, args[0] == args[1]);
+}
+
+Node IsEqv::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return Bool(scope, SameAtom(args[0], args[1]));
+}
+
+Node IsEqualValue::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    return Bool(scope, SameValue(args[0], args[1]));
+}
+
+// the hash of hash tables, fixnums stay non-negative
+Node EqualHash::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    return MakeNumber(scope, static_cast<int64_t>(HashKey(args[0]) >> 1));
+}
+
+// Fibonacci hashing, so that fixnum keys with equal low bits spread over the table
+size_t HashTable::Home(size_t hash) const {
+    return (hash * 0x9e3779b97f4a7c15) >> shift_;
+}
+
+size_t HashTable::Probe(Node key, size_t hash) const {
+    size_t mask = entries_.size() - 1;
+    size_t i = Home(hash);
+    while (entries_[i].used && (entries_[i].hash != hash || !SameValue(entries_[i].key, key))) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+Node* HashTable::Find(Node key) {
+    if (!size_) {
+        return nullptr;
+    }
+    auto& entry = entries_[Probe(key, HashKey(key))];
+    return entry.used ? &entry.value : nullptr;
+}
+
+// grows before the table gets more than three quarters full
+void HashTable::Insert(Node key, Node value) {
+    if ((size_ + 1) * 4 > entries_.size() * 3) {
+        Rehash(std::max(kMinCapacity, entries_.size() * 2));
+    }
+    size_t hash = HashKey(key);
+    auto& entry = entries_[Probe(key, hash)];
+    if (!entry.used) {
+        entry = {key, value, hash, true};
+        ++size_;
+    } else {
+        entry.value = value;
+    }
+}
+
+// the entries after the erased one are shifted back, so that probing never has to skip
+// deleted slots
+bool HashTable::Erase(Node key) {
+    if (!size_) {
+        return false;
+    }
+    size_t mask = entries_.size() - 1;
+    size_t hole = Probe(key, HashKey(key));
+    if (!entries_[hole].used) {
+        return false;
+    }
+    for (size_t i = (hole + 1) & mask; entries_[i].used; i = (i + 1) & mask) {
+        // an entry stays if its home is cyclically within (hole, i]
+        size_t home = Home(entries_[i].hash);
+        bool stays = hole < i ? hole < home && home <= i : hole < home || home <= i;
+        if (!stays) {
+            entries_[hole] = entries_[i];
+            hole = i;
+        }
+    }
+    entries_[hole] = Entry();
+    --size_;
+    return true;
+}
+
+void HashTable::Rehash(size_t capacity) {
+    std::vector<Entry> entries(capacity);
+    std::swap(entries, entries_);
+    shift_ = 64 - __builtin_ctzll(capacity);
+    for (auto& entry : entries) {
+        if (entry.used) {
+            size_t mask = capacity - 1;
+            size_t i = Home(entry.hash);
+            while (entries_[i].used) {
+                i = (i + 1) & mask;
+            }
+            entries_[i] = entry;
+        }
+    }
+}
+
+const Node* MapNode::Find(Node key, size_t hash, size_t shift) const {
+    const MapNode* node = this;
+    for (; shift < kHashBits; shift += kBits) {
+        uint32_t bit = Bit(hash, shift);
+        if (node->entry_map_ & bit) {
+            auto& entry = node->entries_[Index(node->entry_map_, bit)];
+            return entry.hash == hash && SameValue(entry.key, key) ? &entry.value : nullptr;
+        }
+        if (!(node->child_map_ & bit)) {
+            return nullptr;
+        }
+        node = node->children_[Index(node->child_map_, bit)];
+    }
+    for (auto& entry : node->entries_) {
+        if (SameValue(entry.key, key)) {
+            return &entry.value;
+        }
+    }
     return nullptr;
 }
 
-Node If::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root) || !GetSecond(root) || !GetFirst(GetSecond(root)) ||
-        (GetSecond(GetSecond(root)) && GetSecond(GetSecond(GetSecond(root))))) {
-        throw SyntaxError("if invalid number of arguments, requires 2 or 3");
+MapNode* MapNode::Insert(Node key, Node value, size_t hash, size_t shift, bool* added) {
+    auto copy = As<MapNode>(Heap::GetInstance().Make<MapNode>(*this));
+    *added = false;
+    if (shift >= kHashBits) {
+        for (auto& entry : copy->entries_) {
+            if (SameValue(entry.key, key)) {
+                entry.value = value;
+                return copy;
+            }
+        }
+        copy->entries_.push_back({key, value, hash});
+        *added = true;
+        return copy;
+    }
+    uint32_t bit = Bit(hash, shift);
+    if (entry_map_ & bit) {
+        size_t i = Index(entry_map_, bit);
+        if (entries_[i].hash == hash && SameValue(entries_[i].key, key)) {
+            copy->entries_[i].value = value;
+            return copy;
+        }
+        // the two entries go one level down
+        auto child = Merge(entries_[i], {key, value, hash}, shift + kBits);
+        copy->entries_.erase(copy->entries_.begin() + i);
+        copy->entry_map_ ^= bit;
+        copy->children_.insert(copy->children_.begin() + Index(child_map_, bit), child);
+        copy->child_map_ |= bit;
+        *added = true;
+        return copy;
+    }
+    if (child_map_ & bit) {
+        size_t i = Index(child_map_, bit);
+        copy->children_[i] = children_[i]->Insert(key, value, hash, shift + kBits, added);
+        return copy;
+    }
+    copy->entries_.insert(copy->entries_.begin() + Index(entry_map_, bit), {key, value, hash});
+    copy->entry_map_ |= bit;
+    *added = true;
+    return copy;
+}
+
+MapNode* MapNode::Merge(const Entry& lhs, const Entry& rhs, size_t shift) {
+    auto node = As<MapNode>(Heap::GetInstance().Make<MapNode>());
+    if (shift >= kHashBits) {
+        node->entries_ = {lhs, rhs};
+        return node;
+    }
+    uint32_t lhs_bit = Bit(lhs.hash, shift);
+    uint32_t rhs_bit = Bit(rhs.hash, shift);
+    if (lhs_bit == rhs_bit) {
+        node->children_.push_back(Merge(lhs, rhs, shift + kBits));
+        node->child_map_ = lhs_bit;
+    } else {
+        node->entries_ = lhs_bit < rhs_bit ? std::vector<Entry>{lhs, rhs}
+                                           : std::vector<Entry>{rhs, lhs};
+        node->entry_map_ = lhs_bit | rhs_bit;
+    }
+    return node;
+}
+
+// a child left with a single entry is replaced by the entry, so that a map has the same
+// shape however its keys were added and removed
+MapNode* MapNode::Erase(Node key, size_t hash, size_t shift) {
+    auto& heap = Heap::GetInstance();
+    if (shift >= kHashBits) {
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (SameValue(entries_[i].key, key)) {
+                auto copy = As<MapNode>(heap.Make<MapNode>(*this));
+                copy->entries_.erase(copy->entries_.begin() + i);
+                return copy;
+            }
+        }
+        return this;
+    }
+    uint32_t bit = Bit(hash, shift);
+    if (entry_map_ & bit) {
+        size_t i = Index(entry_map_, bit);
+        if (entries_[i].hash != hash || !SameValue(entries_[i].key, key)) {
+            return this;
+        }
+        auto copy = As<MapNode>(heap.Make<MapNode>(*this));
+        copy->entries_.erase(copy->entries_.begin() + i);
+        copy->entry_map_ ^= bit;
+        return copy;
+    }
+    if (!(child_map_ & bit)) {
+        return this;
+    }
+    size_t i = Index(child_map_, bit);
+    auto child = children_[i]->Erase(key, hash, shift + kBits);
+    if (child == children_[i]) {
+        return this;
+    }
+    auto copy = As<MapNode>(heap.Make<MapNode>(*this));
+    if (child->children_.empty() && child->entries_.size() <= 1) {
+        copy->children_.erase(copy->children_.begin() + i);
+        copy->child_map_ ^= bit;
+        if (!child->entries_.empty()) {
+            copy->entries_.insert(copy->entries_.begin() + Index(entry_map_, bit),
+                                  child->entries_[0]);
+            copy->entry_map_ |= bit;
+        }
+    } else {
+        copy->children_[i] = child;
+    }
+    return copy;
+}
+
+PersistentMap::PersistentMap()
+    : root_(As<MapNode>(Heap::GetInstance().Make<MapNode>())), size_(0) {
+}
+
+const Node* PersistentMap::Find(Node key) const {
+    return root_->Find(key, HashKey(key), 0);
+}
+
+PersistentMap* PersistentMap::Insert(Node key, Node value) {
+    bool added;
+    auto root = root_->Insert(key, value, HashKey(key), 0, &added);
+    return As<PersistentMap>(Heap::GetInstance().Make<PersistentMap>(root, size_ + added));
+}
+
+PersistentMap* PersistentMap::Erase(Node key) {
+    auto root = root_->Erase(key, HashKey(key), 0);
+    if (root == root_) {
+        return this;
+    }
+    return As<PersistentMap>(Heap::GetInstance().Make<PersistentMap>(root, size_ - 1));
+}
+
+// a chain of nodes shift bits high above node
+VectorNode* MakePath(size_t shift, VectorNode* node) {
+    for (; shift; shift -= VectorNode::kBits) {
+        auto parent = As<VectorNode>(Heap::GetInstance().Make<VectorNode>());
+        parent->GetSlots().push_back(node);
+        node = parent;
+    }
+    return node;
+}
+
+PersistentVector::PersistentVector()
+    : size_(0),
+      shift_(VectorNode::kBits),
+      root_(As<VectorNode>(Heap::GetInstance().Make<VectorNode>())),
+      tail_(As<VectorNode>(Heap::GetInstance().Make<VectorNode>())) {
+}
+
+// the slots above the leaves only hold nodes, so they are cast without checking
+VectorNode* PersistentVector::GetLeaf(size_t index) const {
+    if (index >= GetTailOffset()) {
+        return tail_;
+    }
+    VectorNode* node = root_;
+    for (size_t shift = shift_; shift; shift -= VectorNode::kBits) {
+        node = static_cast<VectorNode*>(
+            node->GetSlots()[(index >> shift) & (VectorNode::kWidth - 1)]);
+    }
+    return node;
+}
+
+Node PersistentVector::Get(size_t index) const {
+    return GetLeaf(index)->GetSlots()[index & (VectorNode::kWidth - 1)];
+}
+
+PersistentVector* PersistentVector::Set(size_t index, Node value) {
+    auto& heap = Heap::GetInstance();
+    if (index >= GetTailOffset()) {
+        auto tail = As<VectorNode>(tail_->Clone());
+        tail->GetSlots()[index & (VectorNode::kWidth - 1)] = value;
+        return As<PersistentVector>(heap.Make<PersistentVector>(size_, shift_, root_, tail));
+    }
+    auto root = SetIn(shift_, root_, index, value);
+    return As<PersistentVector>(heap.Make<PersistentVector>(size_, shift_, root, tail_));
+}
+
+VectorNode* PersistentVector::SetIn(size_t shift, VectorNode* node, size_t index,
+                                    Node value) {
+    auto copy = As<VectorNode>(node->Clone());
+    size_t i = (index >> shift) & (VectorNode::kWidth - 1);
+    if (!shift) {
+        copy->GetSlots()[i] = value;
+    } else {
+        auto child = static_cast<VectorNode*>(node->GetSlots()[i]);
+        copy->GetSlots()[i] = SetIn(shift - VectorNode::kBits, child, index, value);
+    }
+    return copy;
+}
+
+// a full tail goes into the trie, which gets a new root once it is full itself
+PersistentVector* PersistentVector::Push(Node value) {
+    auto& heap = Heap::GetInstance();
+    if (size_ - GetTailOffset() < VectorNode::kWidth) {
+        auto tail = As<VectorNode>(tail_->Clone());
+        tail->GetSlots().push_back(value);
+        return As<PersistentVector>(heap.Make<PersistentVector>(size_ + 1, shift_, root_, tail));
+    }
+    VectorNode* root;
+    size_t shift = shift_;
+    if ((size_ >> VectorNode::kBits) > (size_t(1) << shift_)) {
+        root = As<VectorNode>(heap.Make<VectorNode>());
+        root->GetSlots() = {root_, MakePath(shift_, tail_)};
+        shift += VectorNode::kBits;
+    } else {
+        root = PushTail(shift_, root_, tail_);
+    }
+    auto tail = As<VectorNode>(heap.Make<VectorNode>());
+    tail->GetSlots().push_back(value);
+    return As<PersistentVector>(heap.Make<PersistentVector>(size_ + 1, shift, root, tail));
+}
+
+VectorNode* PersistentVector::PushTail(size_t shift, VectorNode* parent, VectorNode* tail) {
+    auto copy = As<VectorNode>(parent->Clone());
+    auto& slots = copy->GetSlots();
+    size_t i = ((size_ - 1) >> shift) & (VectorNode::kWidth - 1);
+    VectorNode* child;
+    if (shift == VectorNode::kBits) {
+        child = tail;
+    } else if (i < slots.size()) {
+        child = PushTail(shift - VectorNode::kBits, static_cast<VectorNode*>(slots[i]), tail);
+    } else {
+        child = MakePath(shift - VectorNode::kBits, tail);
+    }
+    if (i < slots.size()) {
+        slots[i] = child;
+    } else {
+        slots.push_back(child);
+    }
+    return copy;
+}
+
+// throws unless the walk over a list stopped at its end
+void RequireListEnd(Node tail) {
+    if (tail) {
+        throw RuntimeError("Proper list required");
+    }
+}
+
+// builds a list front to back, one cell per element. Callers keep it on the heap with a
+// PersistentGuard: car and cdr read their argument but return its parts, so the later cells
+// of a temporary list could outlive the call
+class ListBuilder {
+public:
+    explicit ListBuilder(Scope* scope) : scope_(scope) {
+    }
+
+    void Append(Node value) {
+        Node cell = MakeCell(scope_, value, nullptr);
+        SetTail(cell);
+        last_ = cell;
+    }
+
+    // what follows the elements appended so far, it is shared and not copied
+    void SetTail(Node tail) {
+        (last_ ? GetSecond(last_) : head_) = tail;
+    }
+
+    Node GetList() const {
+        return head_;
+    }
+
+private:
+    Scope* scope_;
+    Node head_ = nullptr;
+    Node last_ = nullptr;
+};
+
+// the next element of every list goes to values and the lists move past it; false once one
+// of them has ended
+bool TakeElements(std::vector<Node>* lists, std::vector<Node>* values) {
+    values->clear();
+    for (auto& list : *lists) {
+        if (!Is<Cell>(list)) {
+            RequireListEnd(list);
+            return false;
+        }
+        values->push_back(GetFirst(list));
+        list = GetSecond(list);
+    }
+    return true;
+}
+
+Node ListLength::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    int64_t size;
+    Node end;
+    if (!CountPairs(args[0], &size, &end)) {
+        throw RuntimeError("Proper list required");
+    }
+    RequireListEnd(end);
+    return MakeNumber(scope, size);
+}
+
+Node Append::Apply(Scope* scope, std::vector<Node>& args) {
+    if (args.empty()) {
+        return nullptr;
+    }
+    PersistentGuard guard(scope);
+    ListBuilder res(scope);
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        Node cur = args[i];
+        for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+            res.Append(GetFirst(cur));
+        }
+        RequireListEnd(cur);
+    }
+    res.SetTail(args.back());
+    return res.GetList();
+}
+
+Node Reverse::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    // the pairs after the first escape through cdr like those of ListBuilder
+    PersistentGuard guard(scope);
+    Node res = nullptr;
+    Node cur = args[0];
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        res = MakeCell(scope, GetFirst(cur), res);
+    }
+    RequireListEnd(cur);
+    return res;
+}
+
+Node ListCopy::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 1, 1);
+    PersistentGuard guard(scope);
+    ListBuilder res(scope);
+    Node cur = args[0];
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        res.Append(GetFirst(cur));
     }
-    auto condition = GetFirst(root);
-    if (IsTrue(Evaluate(scope, condition))) {
-        return Evaluate(scope, GetFirst(GetSecond(root)));
+    res.SetTail(cur);
+    return res.GetList();
+}
+
+Node Map::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2);
+    RequireProcedure(args[0]);
+    PersistentGuard guard(scope);
+    std::vector<Node> lists(args.begin() + 1, args.end());
+    std::vector<Node> values;
+    ListBuilder res(scope);
+    while (TakeElements(&lists, &values)) {
+        res.Append(CallProcedure(scope, args[0], values));
     }
-    if (GetSecond(GetSecond(root))) {
-        return Evaluate(scope, GetFirst(GetSecond(GetSecond(root))));
+    return res.GetList();
+}
+
+Node ForEach::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2);
+    RequireProcedure(args[0]);
+    PersistentGuard guard(scope);
+    std::vector<Node> lists(args.begin() + 1, args.end());
+    std::vector<Node> values;
+    while (TakeElements(&lists, &values)) {
+        CallProcedure(scope, args[0], values);
     }
     return nullptr;
 }
 
-Node ConstructLambda::Run(std::shared_ptr<Scope> scope, Node root) {
-    if (!Is<Cell>(root)) {
-        throw SyntaxError("Invalid number of arguments for lambda construction");
+Node Filter::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    RequireProcedure(args[0]);
+    PersistentGuard guard(scope);
+    std::vector<Node> call_args;
+    ListBuilder res(scope);
+    Node cur = args[1];
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        call_args.assign(1, GetFirst(cur));
+        if (IsTrue(CallProcedure(scope, args[0], call_args))) {
+            res.Append(GetFirst(cur));
+        }
+    }
+    RequireListEnd(cur);
+    return res.GetList();
+}
+
+Node FoldLeft::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3);
+    RequireProcedure(args[0]);
+    PersistentGuard guard(scope);
+    Node acc = args[1];
+    std::vector<Node> lists(args.begin() + 2, args.end());
+    std::vector<Node> values;
+    while (TakeElements(&lists, &values)) {
+        values.insert(values.begin(), acc);
+        acc = CallProcedure(scope, args[0], values);
     }
-    if (GetFirst(root) && !Is<Cell>(GetFirst(root))) {
-        throw SyntaxError("Argument list required for lambda construction");
+    return acc;
+}
+
+// the elements are collected first, so that the calls can go from the last ones
+Node FoldRight::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 3);
+    RequireProcedure(args[0]);
+    PersistentGuard guard(scope);
+    std::vector<Node> lists(args.begin() + 2, args.end());
+    std::vector<Node> values;
+    std::vector<Node> elements;
+    while (TakeElements(&lists, &values)) {
+        elements.insert(elements.end(), values.begin(), values.end());
     }
-    if (!Is<Cell>(GetSecond(root))) {
-        throw SyntaxError("Can't create empty lambda");
+    Node acc = args[1];
+    for (size_t end = elements.size(); end > 0; end -= lists.size()) {
+        values.assign(elements.begin() + (end - lists.size()), elements.begin() + end);
+        values.push_back(acc);
+        acc = CallProcedure(scope, args[0], values);
     }
-    GetFirst(root);
-    std::vector<Node> args = ParseArgumentsNoEval(GetFirst(root));
-    RequireArgType<Symbol>(args);
-    return Heap::GetInstance().Make<Lambda>(scope, args, GetSecond(root));
+    return acc;
 }
 
-Node Lambda::Run(std::shared_ptr<Scope> scope, Node root) {
-    local_scope_ = std::shared_ptr<Scope>(new Scope(local_scope_));
-    for (auto obj : args_) {
-        if (!root) {
-            throw RuntimeError("Incorrect number of arguments for lambda function");
+Node Assoc::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    Node cur = args[1];
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        Node entry = GetFirst(cur);
+        if (!Is<Cell>(entry)) {
+            throw RuntimeError("Association list required");
+        }
+        if (SameValue(args[0], GetFirst(entry))) {
+            return entry;
         }
-        local_scope_->Define(GetName(obj), Evaluate(scope, GetFirst(root)));
-        root = GetSecond(root);
     }
-    if (root) {
-        throw RuntimeError("Incorrect number of arguments for lambda function");
+    RequireListEnd(cur);
+    return Bool(scope, false);
+}
+
+Node Member::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    Node cur = args[1];
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        if (SameValue(args[0], GetFirst(cur))) {
+            return cur;
+        }
+    }
+    RequireListEnd(cur);
+    return Bool(scope, false);
+}
+
+// stable bottom-up merge sort. Unlike std::stable_sort it stays in bounds whatever less
+// returns, so a procedure that isn't a strict ordering only gives some permutation.
+template <class T, class Less>
+void MergeSort(std::vector<T>* items, Less less) {
+    constexpr size_t kRun = 16;
+    auto& data = *items;
+    size_t size = data.size();
+    // runs of kRun elements are sorted by insertion first
+    for (size_t begin = 0; begin < size; begin += kRun) {
+        size_t end = std::min(begin + kRun, size);
+        for (size_t i = begin + 1; i < end; ++i) {
+            T item = std::move(data[i]);
+            size_t j = i;
+            for (; j > begin && less(item, data[j - 1]); --j) {
+                data[j] = std::move(data[j - 1]);
+            }
+            data[j] = std::move(item);
+        }
+    }
+    std::vector<T> buffer(size);
+    for (size_t width = kRun; width < size; width *= 2) {
+        for (size_t begin = 0; begin < size; begin += 2 * width) {
+            size_t middle = std::min(begin + width, size);
+            size_t end = std::min(begin + 2 * width, size);
+            size_t i = begin, j = middle, k = begin;
+            // equal elements are taken from the left run first
+            while (i < middle && j < end) {
+                buffer[k++] = std::move(less(data[j], data[i]) ? data[j++] : data[i++]);
+            }
+            std::move(data.begin() + i, data.begin() + middle, buffer.begin() + k);
+            std::move(data.begin() + j, data.begin() + end, buffer.begin() + k + (middle - i));
+        }
+        std::swap(data, buffer);
+    }
+}
+
+// sorts with the relation of a comparison builtin applied to key of the items, without
+// calling it; false if procedure is something else
+template <class T, class Key>
+bool SortByRelation(Node procedure, std::vector<T>* items, Key key) {
+    auto sort = [&](auto relation) {
+        MergeSort(items,
+                  [&](const T& lhs, const T& rhs) { return relation(key(lhs), key(rhs)); });
+    };
+    if (Is<IsSmaller>(procedure)) {
+        sort(std::less<>());
+    } else if (Is<IsGreater>(procedure)) {
+        sort(std::greater<>());
+    } else if (Is<IsLeq>(procedure)) {
+        sort(std::less_equal<>());
+    } else if (Is<IsGeq>(procedure)) {
+        sort(std::greater_equal<>());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// numbers of a single kind compared by a builtin are sorted by their values, anything else
+// by calls of the procedure
+void SortElements(Scope* scope, Node procedure, std::vector<Node>* elements) {
+    auto by_value = [&](auto get_value) {
+        using Value = decltype(get_value(nullptr));
+        std::vector<std::pair<Value, Node>> items;
+        items.reserve(elements->size());
+        for (auto element : *elements) {
+            items.emplace_back(get_value(element), element);
+        }
+        if (!SortByRelation(procedure, &items,
+                            [](const std::pair<Value, Node>& item) { return item.first; })) {
+            return false;
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            (*elements)[i] = items[i].second;
+        }
+        return true;
+    };
+    auto is_fixnum = [](Node element) { return Is<Number>(element); };
+    auto is_flonum = [](Node element) { return Is<Flonum>(element); };
+    if (std::all_of(elements->begin(), elements->end(), is_fixnum) &&
+        by_value([](Node element) { return GetValue(element); })) {
+        return;
+    }
+    if (std::all_of(elements->begin(), elements->end(), is_flonum) &&
+        by_value([](Node element) { return As<Flonum>(element)->GetValue(); })) {
+        return;
+    }
+    PersistentGuard guard(scope);
+    std::vector<Node> call_args;
+    MergeSort(elements, [&](Node lhs, Node rhs) {
+        call_args.assign({lhs, rhs});
+        return IsTrue(CallProcedure(scope, procedure, call_args));
+    });
+}
+
+Node Sort::Apply(Scope* scope, std::vector<Node>& args) {
+    RequireArgumentSize(args, 2, 2);
+    RequireProcedure(args[1]);
+    PersistentGuard guard(scope);
+    auto& heap = Heap::GetInstance();
+    auto identity = [](auto value) { return value; };
+    auto vector = As<Vector>(args[0]);
+    if (vector && vector->GetStorage() == Vector::Storage::kFixnums) {
+        auto fixnums = vector->GetFixnums();
+        if (SortByRelation(args[1], &fixnums, identity)) {
+            return heap.Make<Vector>(std::move(fixnums));
+        }
+    }
+    if (vector && vector->GetStorage() == Vector::Storage::kFlonums) {
+        auto flonums = vector->GetFlonums();
+        if (SortByRelation(args[1], &flonums, identity)) {
+            return heap.Make<Vector>(std::move(flonums));
+        }
+    }
+
+    std::vector<Node> elements;
+    if (vector) {
+        elements = GetElements(vector);
+    } else {
+        Node cur = args[0];
+        for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+            elements.push_back(GetFirst(cur));
+        }
+        RequireListEnd(cur);
+    }
+    SortElements(scope, args[1], &elements);
+    if (vector) {
+        return heap.Make<Vector>(std::move(elements));
+    }
+    ListBuilder res(scope);
+    for (auto element : elements) {
+        res.Append(element);
+    }
+    return res.GetList();
+}
+
+Node Lambda::Enter(Scope* scope, Frame* frame) {
+    if (!code_->IsMemoized()) {
+        return Execute(scope, frame);
+    }
+    MemoStats& stats = scope->GetMemoStats();
+    size_t arity = code_->GetArity();
+    size_t hash;
+    if (!MemoTable::Hash(frame->slots, arity, &hash)) {
+        ++stats.misses;
+        return Execute(scope, frame);
+    }
+    if (!memo_) {
+        memo_ = As<MemoTable>(Heap::GetInstance().Make<MemoTable>());
+        AddDependant(memo_);
+    }
+    Node res;
+    if (memo_->Find(hash, frame->slots, arity, &res)) {
+        ++stats.hits;
+        return res;
+    }
+    ++stats.misses;
+    auto args = MemoTable::Copy(frame->slots, arity);
+    res = Execute(scope, frame);
+    stats.evictions += memo_->Insert(hash, std::move(args), res, scope->GetMemoCapacity());
+    return res;
+}
+
+Node Lambda::Execute(Scope* scope, Frame* frame) {
+    std::fill(frame->slots + code_->GetArity(), frame->slots + code_->GetFrameSize(),
+              Unassigned());
+    for (auto index : code_->GetBoxed()) {
+        frame->slots[index] = Heap::GetInstance().Make<Box>(frame->slots[index]);
+    }
+    Frame* caller = scope->GetFrame();
+    scope->SetFrame(frame);
+
+    TierState& tier = code_->GetTier();
+    if (!tier.native.Get()) {
+        ++tier.calls;
+        if (caller && caller->closure->code_ == code_) {
+            ++tier.iterations;
+        }
+        const JitOptions& jit = scope->GetJitOptions();
+        if (jit.enabled && tier.GetHotness() > jit.threshold) {
+            Promote(scope, code_);
+        }
     }
-    Node cur = calc_;
+    const SpecializedBody* specialized = nullptr;
+    if (!code_->GetCompiledBody().empty()) {
+        specialized = GetSpecialized(scope, code_, frame->slots);
+    }
+    // native code only has a fast path for fixnums
+    Node res;
+    if (tier.native.Get() && !(specialized && specialized->flonum) &&
+        RunNative(scope, code_, frame, &res)) {
+        return res;
+    }
+
     Node lst = nullptr;
-    while (cur) {
-        lst = Evaluate(local_scope_, GetFirst(cur));
-        cur = GetSecond(cur);
+    if (!code_->GetCompiledBody().empty()) {
+        for (auto& expr : specialized ? specialized->body : code_->GetCompiledBody()) {
+            lst = expr(scope);
+        }
+        return lst;
+    }
+    for (Node cur = code_->GetBody(); cur; cur = GetSecond(cur)) {
+        lst = Evaluate(scope, GetFirst(cur));
     }
-    local_scope_ = local_scope_->GetPrev();
     return lst;
 }
 
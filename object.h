@@ -1,8 +1,17 @@
 #pragma once
 
+#include "bignum.h"
 #include "error.h"
+#include "jit.h"
+#include "simd.h"
 
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <set>
@@ -13,10 +22,17 @@ class Object;
 
 using Node = Object*;
 
+class Scope;
+
+// evaluation of a node with its operators, arities and variable slots resolved beforehand,
+// see Compile
+using Compiled = std::function<Node(Scope*)>;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // heap
 
 class Number;
+class Flonum;
 class Symbol;
 class Cell;
 
@@ -29,10 +45,20 @@ public:
 
     template <typename T, typename... Args>
     Object* Make(Args... args) {
+        ++allocations_;
         storage_.push_back(std::unique_ptr<Object>(new T(args...)));
         return storage_.back().get();
     }
 
+    // the only symbol with this name, made by the first call; symbols are compared by
+    // identity
+    Object* Intern(const std::string& name);
+
+    // objects made so far
+    size_t GetAllocations() const {
+        return allocations_;
+    }
+
     void RunGC();
     void Del();
 
@@ -52,8 +78,13 @@ public:
 private:
     Heap();
 
+    // an interned symbol leaves the table with the object
+    void Free(std::unique_ptr<Object>& object);
+
     Object* lifetime_root_;
     std::vector<std::unique_ptr<Object>> storage_;
+    size_t allocations_ = 0;
+    std::unordered_map<std::string, Object*> symbols_;
 
     static std::unique_ptr<Heap> ptr;
 };
@@ -63,9 +94,112 @@ Heap& GetHeap();
 //////////////////////////////////////////////////////////////////////////////////////////
 // scope
 
+// call site cache of a global binding, valid while the version of its scope matches. Each
+// compiled variable reference owns one, so interpreters never share them
+struct InlineCache {
+    Object** slot = nullptr;
+    uint64_t version = 0;
+    const Scope* scope = nullptr;
+};
+
+class Lambda;
+
+// the lambda call being evaluated, variables of enclosing lambdas are copied into the closure
+struct Frame {
+    Node* slots = nullptr;
+    Lambda* closure = nullptr;
+};
+
+// storage for the slots of the frames, released in LIFO order
+class FrameStack {
+public:
+    using Position = std::pair<size_t, size_t>;
+
+    FrameStack() : chunks_(1, std::vector<Node>(kChunkSize)) {
+    }
+
+    Position GetPosition() const {
+        return {chunk_, top_};
+    }
+
+    Node* Allocate(size_t size);
+
+    void Release(Position position) {
+        chunk_ = position.first;
+        top_ = position.second;
+    }
+
+private:
+    static constexpr size_t kChunkSize = 1 << 12;
+
+    // chunks never move, so the slots stay valid while the stack grows
+    std::vector<std::vector<Node>> chunks_;
+    size_t chunk_ = 0;
+    size_t top_ = 0;
+};
+
+// numbers and pairs that only the builtin reading them ever sees, like the product in
+// (+ (* a b) c); they don't go through the heap and are reused once the outermost call
+// reading them returns, see compile.cpp
+class ScratchArea {
+public:
+    using Position = std::pair<size_t, size_t>;
+
+    ScratchArea();
+    ~ScratchArea();
+
+    Position GetPosition() const {
+        return {chunk_, top_};
+    }
+
+    void Release(Position position) {
+        chunk_ = position.first;
+        top_ = position.second;
+    }
+
+    Number* MakeNumber(int64_t value);
+    Flonum* MakeFlonum(double value);
+    Cell* MakeCell(Object* first, Object* second);
+
+    // objects made here instead of the heap so far
+    size_t GetAllocations() const {
+        return allocations_;
+    }
+
+private:
+    struct Chunk;
+    static constexpr size_t kChunkSize = 1 << 8;
+
+    // moves to the next slot, in a new chunk if the current one is full
+    void Advance();
+
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    size_t chunk_ = 0;
+    size_t top_ = 0;
+    size_t allocations_ = 0;
+};
+
+// where the objects made by evaluation went
+struct AllocationStats {
+    size_t heap = 0;
+    size_t scratch = 0;
+};
+
+// calls of lambdas defined with define-memoized, see MemoTable
+struct MemoStats {
+    // calls answered from the table
+    size_t hits = 0;
+    // calls that ran the body, including those whose arguments were too large to keep
+    size_t misses = 0;
+    // results dropped to make room for newer ones
+    size_t evictions = 0;
+};
+
+// global bindings and the state of the running lambda calls, owned by the interpreter
+// and passed to evaluation as a plain pointer
 class Scope {
 public:
-    Scope(std::shared_ptr<Scope> prev);
+    Scope();
     ~Scope() {
         std::set<Object*> wow;
         for (auto [symbol, root] : buf_) {
@@ -78,8 +212,16 @@ public:
 
     Object*& ResolveSymbol(const std::string& symbol);
 
+    // the binding of symbol, nullptr if it isn't defined
+    Object** Lookup(const std::string& symbol);
+
+    // same as above, the binding is remembered in cache
+    Object*& ResolveSymbol(const std::string& symbol, InlineCache* cache);
+
     template <typename T>
     void Define(const std::string& symbol, T* root) {
+        ++version_;
+        ++epochs_[symbol];
         if (buf_.find(symbol) != buf_.end()) {
             Heap::GetInstance().RemoveRoot(buf_[symbol]);
         }
@@ -88,8 +230,57 @@ public:
     }
     void Set(const std::string& symbol, Node root);
 
-    std::shared_ptr<Scope> GetPrev() {
-        return prev_;
+    FrameStack& GetStack() {
+        return stack_;
+    }
+
+    // nullptr outside of lambda calls
+    Frame* GetFrame() {
+        return frame_;
+    }
+
+    void SetFrame(Frame* frame) {
+        frame_ = frame;
+    }
+
+    ScratchArea& GetScratch() {
+        return scratch_;
+    }
+
+    // set while a builtin makes a result that is a temporary, see Object::InvokeTemporary
+    bool IsTemporary() const {
+        return temporary_;
+    }
+
+    void SetTemporary(bool temporary) {
+        temporary_ = temporary;
+    }
+
+    JitOptions& GetJitOptions() {
+        return jit_;
+    }
+
+    TierStats& GetTierStats() {
+        return tier_stats_;
+    }
+
+    MemoStats& GetMemoStats() {
+        return memo_stats_;
+    }
+
+    // results a memoized lambda keeps at most
+    size_t GetMemoCapacity() const {
+        return memo_capacity_;
+    }
+
+    void SetMemoCapacity(size_t capacity) {
+        memo_capacity_ = capacity;
+    }
+
+    // bumped every time the global is defined or set, compiled code specialized on the
+    // binding checks it
+    const uint64_t* GetEpoch(const std::string& symbol) {
+        return &epochs_[symbol];
     }
 
 private:
@@ -97,20 +288,48 @@ private:
     void InitBuiltinFunctions();
 
     std::map<std::string, Object*> buf_;
-    std::shared_ptr<Scope> prev_;
+    FrameStack stack_;
+    Frame* frame_ = nullptr;
+    ScratchArea scratch_;
+    bool temporary_ = false;
+    JitOptions jit_;
+    TierStats tier_stats_;
+    MemoStats memo_stats_;
+    size_t memo_capacity_ = 1 << 10;
+    std::map<std::string, uint64_t> epochs_;
+
+    // bumped on every Define and Set, invalidates the inline caches of this scope
+    uint64_t version_ = 1;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
 // object
 
-class Object : public std::enable_shared_from_this<Object> {
+class Object {
 public:
     friend class Heap;
 
-    virtual Object* Run(std::shared_ptr<Scope>, Object*) {
+    virtual Object* Run(Scope*, Object*) {
         throw RuntimeError("Object not callable");
     }
 
+    // call from compiled code, args are the compiled elements of the argument list syntax
+    virtual Object* Invoke(Scope* scope, const std::vector<Compiled>&, Object* syntax) {
+        return Run(scope, syntax);
+    }
+
+    // same as Invoke, for calls whose value is only read by the builtin it is passed to
+    virtual Object* InvokeTemporary(Scope* scope, const std::vector<Compiled>& args,
+                                    Object* syntax) {
+        return Invoke(scope, args, syntax);
+    }
+
+    // true if a call with count arguments returns none of them and keeps no reference to
+    // them, they may be temporaries then
+    virtual bool ReadsArguments(size_t) const {
+        return false;
+    }
+
     virtual Object* Clone() const {
         auto ptr = Heap::GetInstance().Make<Object>(*this);
         ptr->mark_ = mark_;
@@ -131,6 +350,24 @@ protected:
 
     void Mark();
 
+    // marks what the object refers to besides its dependants with MarkObject, for containers
+    // too large to collect all of their elements into dependants on every Update
+    virtual void MarkReferences(std::vector<Object*>*) {
+    }
+
+    // after a collection, for objects that mark more than themselves
+    virtual void ClearMark() {
+        mark_ = 0;
+    }
+
+    // marks ptr and queues it for Mark to go over what it refers to, unless that was done
+    static void MarkObject(Object* ptr, std::vector<Object*>* pending) {
+        if (ptr && !ptr->mark_) {
+            ptr->mark_ = 1;
+            pending->push_back(ptr);
+        }
+    }
+
     void AddDependant(Object* ptr) {
         if (ptr) {
             dependants_.insert(ptr);
@@ -153,9 +390,12 @@ protected:
 
 class Number : public Object {
     friend class Heap;
+    // reads value_ directly in compiled code
+    friend class JitCompiler;
+    friend class ScratchArea;
 
 public:
-    int GetValue() const {
+    int64_t GetValue() const {
         return value_;
     }
     Object* Clone() const {
@@ -166,11 +406,58 @@ protected:
     Number() = default;
     Number(const Number& other) : value_(other.value_) {
     }
-    Number(int value) : value_(value) {
+    Number(int64_t value) : value_(value) {
+    }
+
+private:
+    int64_t value_;
+};
+
+// integer out of the range of Number; arithmetic makes one only when a result overflows and
+// goes back to Number when it fits again, so equal values always have the same type
+class BigNumber : public Object {
+    friend class Heap;
+
+public:
+    const BigInt& GetValue() const {
+        return value_;
+    }
+    Object* Clone() const {
+        return Heap::GetInstance().Make<BigNumber>(*this);
+    }
+
+protected:
+    BigNumber(const BigNumber& other) : value_(other.value_) {
+    }
+    BigNumber(const BigInt& value) : value_(value) {
+    }
+
+private:
+    BigInt value_;
+};
+
+// inexact number; arithmetic with one gives a Flonum, whatever the other arguments are
+class Flonum : public Object {
+    friend class Heap;
+    friend class ScratchArea;
+
+public:
+    double GetValue() const {
+        return value_;
+    }
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Flonum>(*this);
+    }
+
+protected:
+    Flonum() = default;
+    Flonum(const Flonum& other) : value_(other.value_) {
+    }
+    Flonum(double value) : value_(value) {
     }
 
 private:
-    int value_;
+    double value_ = 0;
 };
 
 class Symbol : public Object {
@@ -196,8 +483,64 @@ private:
     std::string name_;
 };
 
+// immutable string. Short ones are kept inline in the object, long ones in an array of
+// their own. Concatenations at least kMinRopeSize long are ropes pointing to their parts,
+// which are flattened into one array the first time the characters are read.
+class String : public Object {
+    friend class Heap;
+
+public:
+    static constexpr size_t kInlineSize = 22;
+    static constexpr size_t kMinRopeSize = 256;
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    bool IsRope() const {
+        return left_;
+    }
+
+    // the characters, a rope is flattened first
+    std::string_view GetView();
+
+    // lhs followed by rhs, either is returned itself if the other is empty
+    static String* Concat(String* lhs, String* rhs);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<String>(*this);
+    }
+
+protected:
+    String(const String& other);
+    String(std::string_view text);
+    String(String* left, String* right);
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        MarkObject(left_, pending);
+        MarkObject(right_, pending);
+    }
+
+private:
+    char* GetChars() {
+        return size_ <= kInlineSize ? inline_ : chars_.get();
+    }
+
+    void Flatten();
+
+    size_t size_ = 0;
+    char inline_[kInlineSize];
+    std::unique_ptr<char[]> chars_;
+    String* left_ = nullptr;
+    String* right_ = nullptr;
+};
+
+class ListBlock;
+
 class Cell : public Object {
     friend class Heap;
+    friend class ScratchArea;
+    friend class ListBlock;
 
 public:
     Object*& GetFirst() {
@@ -211,7 +554,16 @@ public:
         return Heap::GetInstance().Make<Cell>(*this);
     }
 
+    // the ListBlock holding the pair, if it was made in one
+    ListBlock* GetBlock() const {
+        return block_;
+    }
+
+    // the car and the cdr of a pair in a block are marked by the block
     void Update() {
+        if (block_) {
+            return;
+        }
         dependants_.clear();
         AddDependant(first_);
         AddDependant(second_);
@@ -226,431 +578,2386 @@ protected:
     Cell(Object* first, Object* second) : first_(first), second_(second) {
     }
 
+    void MarkReferences(std::vector<Object*>* pending);
+
 private:
     Object* first_ = nullptr;
     Object* second_ = nullptr;
+    ListBlock* block_ = nullptr;
 };
 
-//////////////////////////////////////////////////////////////////////////////////////////
-// builtin functions
+// list made at once by list or read by the parser, its pairs are adjacent in one array and
+// the cdr of each one is the next. Those still are ordinary pairs, so car, cdr and set-car!
+// work on them as on any other; list-ref and list-tail jump to an index directly until
+// set-cdr! changes one of them
+class ListBlock : public Object {
+    friend class Heap;
 
-//////////////////////////////////////////////////////////////////////
-// checkers
+public:
+    // the first pair
+    Cell* GetList() {
+        return &cells_[0];
+    }
 
-// number?
-class IsNumber : public Object {
+    // follows the cdrs from cell at most count times, where the pairs after it are still
+    // linked in order
+    Node Skip(Cell* cell, size_t* count);
+
+    // set-cdr! was called on one of the pairs
+    void Unlink() {
+        linked_ = false;
+    }
+
+    void ClearMark();
+
+    Object* Clone() const;
+
+protected:
+    ListBlock(const std::vector<Node>& elements, Node tail);
+
+    void MarkReferences(std::vector<Object*>* pending);
+
+private:
+    size_t size_;
+    std::unique_ptr<Cell[]> cells_;
+    bool linked_ = true;
+};
+
+// elements followed by tail, in a ListBlock when there are several of them
+Node MakeListOf(const std::vector<Node>& elements, Node tail = nullptr);
+
+// mutable variable shared between its frame and the closures that captured it
+class Box : public Object {
+    friend class Heap;
+
+public:
+    Node& Get() {
+        return value_;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Box>(*this);
+    }
+
+    void Update() {
+        dependants_.clear();
+        AddDependant(value_);
+    }
+
+protected:
+    Box(const Box& other) : value_(other.value_) {
+    }
+    Box(Node value) : value_(value) {
+    }
+
+private:
+    Node value_;
+};
+
+// fixed size array of objects, indexed in constant time; #(...) literals evaluate to
+// themselves
+class Vector : public Object {
+    friend class Heap;
+
+public:
+    // a vector of only fixnums or only flonums keeps them unboxed, storing anything else
+    // boxes all of its elements
+    enum class Storage { kObjects, kFixnums, kFlonums };
+
+    Storage GetStorage() const {
+        return storage_;
+    }
+
+    size_t GetSize() const;
+
+    // element i, numbers of unboxed storage are made on the heap
+    Node Get(size_t i) const;
+    void Set(size_t i, Node value);
+    void Fill(Node value);
+
+    std::vector<Node>& GetObjects() {
+        return objects_;
+    }
+
+    std::vector<int64_t>& GetFixnums() {
+        return fixnums_;
+    }
+
+    std::vector<double>& GetFlonums() {
+        return flonums_;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Vector>(*this);
+    }
+
+    // elements are stored without updating the dependants, the GC collects them here
+    void Update() {
+        dependants_.clear();
+        for (auto element : objects_) {
+            AddDependant(element);
+        }
+    }
+
+protected:
+    Vector(const Vector& other)
+        : storage_(other.storage_),
+          objects_(other.objects_),
+          fixnums_(other.fixnums_),
+          flonums_(other.flonums_) {
+    }
+    Vector(std::vector<Node> elements);
+    Vector(size_t size, Node fill);
+    Vector(std::vector<int64_t> fixnums)
+        : storage_(Storage::kFixnums), fixnums_(std::move(fixnums)) {
+    }
+    Vector(std::vector<double> flonums)
+        : storage_(Storage::kFlonums), flonums_(std::move(flonums)) {
+    }
+
+private:
+    void BoxElements();
+
+    Storage storage_ = Storage::kObjects;
+    std::vector<Node> objects_;
+    std::vector<int64_t> fixnums_;
+    std::vector<double> flonums_;
+};
+
+// hash table keyed by the structure of the keys, with open addressing and linear probing.
+// Lists and vectors used as keys aren't copied, changing one afterwards loses its entry.
+class HashTable : public Object {
+    friend class Heap;
+
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // slot of the value of key, nullptr if there is none
+    Node* Find(Node key);
+    void Insert(Node key, Node value);
+    // false if there was no such key
+    bool Erase(Node key);
+
+    // calls func with every key and value, in no particular order
+    template <class Func>
+    void ForEach(Func func) const {
+        for (auto& entry : entries_) {
+            if (entry.used) {
+                func(entry.key, entry.value);
+            }
+        }
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTable>(*this);
+    }
+
+protected:
+    HashTable() = default;
+    HashTable(const HashTable& other)
+        : entries_(other.entries_), size_(other.size_), shift_(other.shift_) {
+    }
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        for (auto& entry : entries_) {
+            if (entry.used) {
+                MarkObject(entry.key, pending);
+                MarkObject(entry.value, pending);
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        Node key = nullptr;
+        Node value = nullptr;
+        size_t hash = 0;
+        bool used = false;
+    };
+
+    static constexpr size_t kMinCapacity = 8;
+
+    // the slot where probing for hash starts
+    size_t Home(size_t hash) const;
+    // index of the entry of key, or of the free slot it would go to
+    size_t Probe(Node key, size_t hash) const;
+    void Rehash(size_t capacity);
+
+    std::vector<Entry> entries_;
+    size_t size_ = 0;
+    // 64 minus the binary logarithm of the capacity
+    size_t shift_ = 64;
+};
+
+// node of the hash array mapped tries of persistent maps, shared by every version of a map
+// that didn't change it. Entries are kept at the first level where the bits of their hash
+// differ from the other keys, children hold the rest; keys whose hashes are equal in all
+// 64 bits are kept in a list by a node below the last level.
+class MapNode : public Object {
+    friend class Heap;
+
+public:
+    static constexpr size_t kBits = 5;
+    // levels at this shift and below only hold keys with equal hashes
+    static constexpr size_t kHashBits = 64;
+
+    // slot of the value of key, nullptr if there is none
+    const Node* Find(Node key, size_t hash, size_t shift) const;
+    // a copy with key bound to value; added tells whether it was new
+    MapNode* Insert(Node key, Node value, size_t hash, size_t shift, bool* added);
+    // a copy without key, or this node itself if there is no such key
+    MapNode* Erase(Node key, size_t hash, size_t shift);
+
+    // calls func with every key and value, in no particular order
+    template <class Func>
+    void ForEach(Func func) const {
+        for (auto& entry : entries_) {
+            func(entry.key, entry.value);
+        }
+        for (auto child : children_) {
+            child->ForEach(func);
+        }
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MapNode>(*this);
+    }
+
+protected:
+    MapNode() = default;
+    MapNode(const MapNode& other)
+        : entries_(other.entries_),
+          children_(other.children_),
+          entry_map_(other.entry_map_),
+          child_map_(other.child_map_) {
+    }
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        for (auto& entry : entries_) {
+            MarkObject(entry.key, pending);
+            MarkObject(entry.value, pending);
+        }
+        for (auto child : children_) {
+            MarkObject(child, pending);
+        }
+    }
+
+private:
+    struct Entry {
+        Node key = nullptr;
+        Node value = nullptr;
+        size_t hash = 0;
+    };
+
+    // the bit of hash in the maps at this level
+    static uint32_t Bit(size_t hash, size_t shift) {
+        return uint32_t(1) << ((hash >> shift) & ((1 << kBits) - 1));
+    }
+
+    static size_t Index(uint32_t map, uint32_t bit) {
+        return __builtin_popcount(map & (bit - 1));
+    }
+
+    // node holding both entries, which have different keys
+    static MapNode* Merge(const Entry& lhs, const Entry& rhs, size_t shift);
+
+    // ordered by the bits of entry_map_ and child_map_, unless the node is below the last
+    // level and both are 0
+    std::vector<Entry> entries_;
+    std::vector<MapNode*> children_;
+    uint32_t entry_map_ = 0;
+    uint32_t child_map_ = 0;
+};
+
+// immutable map keyed by the structure of the keys like HashTable; changing it makes a new
+// map sharing all but the path to the changed entry with the old one
+class PersistentMap : public Object {
+    friend class Heap;
+
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // the value of key, nullptr if there is none
+    const Node* Find(Node key) const;
+    PersistentMap* Insert(Node key, Node value);
+    // this map itself if there is no such key
+    PersistentMap* Erase(Node key);
+
+    template <class Func>
+    void ForEach(Func func) const {
+        root_->ForEach(func);
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMap>(*this);
+    }
+
+protected:
+    PersistentMap();
+    PersistentMap(const PersistentMap& other) : root_(other.root_), size_(other.size_) {
+    }
+    PersistentMap(MapNode* root, size_t size) : root_(root), size_(size) {
+    }
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        MarkObject(root_, pending);
+    }
+
+private:
+    MapNode* root_;
+    size_t size_;
+};
+
+// node of the tries of persistent vectors: up to 32 children, or 32 elements in a leaf
+class VectorNode : public Object {
+    friend class Heap;
+
+public:
+    static constexpr size_t kBits = 5;
+    static constexpr size_t kWidth = 1 << kBits;
+
+    std::vector<Node>& GetSlots() {
+        return slots_;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorNode>(*this);
+    }
+
+protected:
+    VectorNode() = default;
+    VectorNode(const VectorNode& other) : slots_(other.slots_) {
+    }
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        for (auto slot : slots_) {
+            MarkObject(slot, pending);
+        }
+    }
+
+private:
+    std::vector<Node> slots_;
+};
+
+// immutable vector in a trie with 32 branches per node, indexed and changed in
+// O(log32 size). The last up to 32 elements are kept in a tail outside the trie, so that
+// pushing mostly copies just the tail.
+class PersistentVector : public Object {
+    friend class Heap;
+
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // index has to be below the size
+    Node Get(size_t index) const;
+    PersistentVector* Set(size_t index, Node value);
+    PersistentVector* Push(Node value);
+
+    // calls func with every element in order
+    template <class Func>
+    void ForEach(Func func) const {
+        for (size_t begin = 0; begin < size_; begin += VectorNode::kWidth) {
+            for (auto element : GetLeaf(begin)->GetSlots()) {
+                func(element);
+            }
+        }
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVector>(*this);
+    }
+
+protected:
+    PersistentVector();
+    PersistentVector(const PersistentVector& other)
+        : size_(other.size_), shift_(other.shift_), root_(other.root_), tail_(other.tail_) {
+    }
+    PersistentVector(size_t size, size_t shift, VectorNode* root, VectorNode* tail)
+        : size_(size), shift_(shift), root_(root), tail_(tail) {
+    }
+
+    void MarkReferences(std::vector<Object*>* pending) {
+        MarkObject(root_, pending);
+        MarkObject(tail_, pending);
+    }
+
+private:
+    // index of the first element in the tail
+    size_t GetTailOffset() const {
+        if (size_ < VectorNode::kWidth) {
+            return 0;
+        }
+        return ((size_ - 1) >> VectorNode::kBits) << VectorNode::kBits;
+    }
+
+    // the leaf or the tail holding the element at index
+    VectorNode* GetLeaf(size_t index) const;
+    // a copy of the path to the leaf of the full tail, which is added after the last leaf
+    VectorNode* PushTail(size_t shift, VectorNode* parent, VectorNode* tail);
+    VectorNode* SetIn(size_t shift, VectorNode* node, size_t index, Node value);
+
+    size_t size_;
+    // bits of the index used below the root
+    size_t shift_;
+    VectorNode* root_;
+    VectorNode* tail_;
+};
+
+// value of an internal definition before it is evaluated
+Node Unassigned();
+
+// the value bound to #t or #f
+Node Bool(Scope* scope, bool value);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// builtin functions
+
+// builtin function of evaluated arguments
+class Builtin : public Object {
+public:
+    Node Run(Scope* scope, Node root);
+    Node Invoke(Scope* scope, const std::vector<Compiled>& args, Node syntax);
+    // numbers and pairs made for the result go to the scratch area
+    Node InvokeTemporary(Scope* scope, const std::vector<Compiled>& args, Node syntax);
+
+    virtual Node Apply(Scope* scope, std::vector<Node>& args) = 0;
+};
+
+//////////////////////////////////////////////////////////////////////
+// checkers
+
+// number?
+class IsNumber : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsNumber>(*this);
+    }
+};
+
+// symbol?
+class IsSymbol : public Builtin {
+    friend class Heap;
+
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsSymbol>(*this);
+    }
+};
+
+// boolean?
+class IsBoolean : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsBoolean>(*this);
+    }
+};
+
+// null?
+class IsNull : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsNull>(*this);
+    }
+};
+
+// pair?
+class IsPair : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsPair>(*this);
+    }
+};
+
+// list?
+class IsList : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsList>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// equivalence
+
+// eq?, the same object; symbols are interned, so ones with the same name are
+class IsEq : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsEq>(*this);
+    }
+};
+
+// eqv?, also numbers of the same exactness and value
+class IsEqv : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsEqv>(*this);
+    }
+};
+
+// equal?, also pairs, vectors and strings with equal contents
+class IsEqualValue : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsEqualValue>(*this);
+    }
+};
+
+// equal-hash, the same for arguments that are equal?
+class EqualHash : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<EqualHash>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// constructors
+
+// cons
+class MakePair : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakePair>(*this);
+    }
+};
+
+// list
+class MakeList : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakeList>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// getters
+
+// car
+class GetHead : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<GetHead>(*this);
+    }
+};
+
+// cdr
+class GetTail : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<GetTail>(*this);
+    }
+};
+
+// list-ref
+class Get : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Get>(*this);
+    }
+};
+
+// list-tail
+class GetSuffix : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<GetSuffix>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// basic arithmetic
+
+// not
+class Not : public Object {
+    friend class Heap;
+
+public:
+    Node Run(Scope* scope, Node root);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Not>(*this);
+    }
+};
+
+// builtin folding number arguments from left to right. They are combined in an integer as
+// they are evaluated, never collected into a vector, and only the result is made. Once a
+// result doesn't fit a Number the rest is combined as BigInt, once a Flonum comes in the
+// rest is combined as double.
+class Arithmetic : public Builtin {
+public:
+    Node Run(Scope* scope, Node root);
+    Node Invoke(Scope* scope, const std::vector<Compiled>& args, Node syntax);
+    Node InvokeTemporary(Scope* scope, const std::vector<Compiled>& args, Node syntax);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    // a single argument is returned as is
+    bool ReadsArguments(size_t count) const {
+        return count > 1;
+    }
+
+    // false if the result is out of the range of int64_t
+    virtual bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const = 0;
+    virtual BigInt Combine(const BigInt& lhs, const BigInt& rhs) const = 0;
+    virtual double Combine(double lhs, double rhs) const = 0;
+
+    // value of the call without arguments, false if that is an error
+    virtual bool Neutral(int64_t*) const {
+        return false;
+    }
+};
+
+// +
+class Plus : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+        return !AddOverflow(lhs, rhs, res);
+    }
+
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const {
+        return lhs + rhs;
+    }
+
+    double Combine(double lhs, double rhs) const {
+        return lhs + rhs;
+    }
+
+    bool Neutral(int64_t* value) const {
+        *value = 0;
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Plus>(*this);
+    }
+};
+
+// -
+class Minus : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+        return !SubOverflow(lhs, rhs, res);
+    }
+
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const {
+        return lhs - rhs;
+    }
+
+    double Combine(double lhs, double rhs) const {
+        return lhs - rhs;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Minus>(*this);
+    }
+};
+
+// *
+class Mult : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+        return !MulOverflow(lhs, rhs, res);
+    }
+
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const {
+        return lhs * rhs;
+    }
+
+    double Combine(double lhs, double rhs) const {
+        return lhs * rhs;
+    }
+
+    bool Neutral(int64_t* value) const {
+        *value = 1;
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Mult>(*this);
+    }
+};
+
+// /
+class Div : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const;
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const;
+
+    // no error for a zero divisor, the result is infinite or NaN
+    double Combine(double lhs, double rhs) const {
+        return lhs / rhs;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Div>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// simple integer operations
+
+// =
+class IsEqual : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsEqual>(*this);
+    }
+};
+
+// >
+class IsGreater : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsGreater>(*this);
+    }
+};
+
+// <
+class IsSmaller : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsSmaller>(*this);
+    }
+};
+
+// >=
+class IsGeq : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsGeq>(*this);
+    }
+};
+
+// <=
+class IsLeq : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsLeq>(*this);
+    }
+};
+
+// max
+class Max : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+        *res = std::max(lhs, rhs);
+        return true;
+    }
+
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const {
+        return Compare(lhs, rhs) < 0 ? rhs : lhs;
+    }
+
+    double Combine(double lhs, double rhs) const {
+        return std::max(lhs, rhs);
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Max>(*this);
+    }
+};
+
+// min
+class Min : public Arithmetic {
+    friend class Heap;
+
+public:
+    bool Combine(int64_t lhs, int64_t rhs, int64_t* res) const {
+        *res = std::min(lhs, rhs);
+        return true;
+    }
+
+    BigInt Combine(const BigInt& lhs, const BigInt& rhs) const {
+        return Compare(lhs, rhs) > 0 ? rhs : lhs;
+    }
+
+    double Combine(double lhs, double rhs) const {
+        return std::min(lhs, rhs);
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Min>(*this);
+    }
+};
+
+// abs
+class Abs : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<Abs>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// vectors
+
+// vector?
+class IsVector : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsVector>(*this);
+    }
+};
+
+// make-vector
+class MakeVector : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakeVector>(*this);
+    }
+};
+
+// vector
+class BuildVector : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<BuildVector>(*this);
+    }
+};
+
+// vector-ref
+class VectorRef : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorRef>(*this);
+    }
+};
+
+// vector-set!
+class VectorSet : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorSet>(*this);
+    }
+};
+
+// vector-length
+class VectorLength : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorLength>(*this);
+    }
+};
+
+// vector-fill!
+class VectorFill : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorFill>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// numeric vectors, run by the kernels of simd.h on unboxed storage and element by element
+// otherwise
+
+// vector-sum
+class VectorSum : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorSum>(*this);
+    }
+};
+
+// vector-dot
+class VectorDot : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorDot>(*this);
+    }
+};
+
+// vector-min
+class VectorMin : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorMin>(*this);
+    }
+};
+
+// vector-max
+class VectorMax : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorMax>(*this);
+    }
+};
+
+// element-wise vector-add and vector-mul, either argument may be a number
+class ElementWise : public Builtin {
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    // false if one of the results is out of the range of int64_t
+    virtual bool Combine(const int64_t* lhs, const int64_t* rhs, int64_t* res,
+                         size_t size) const = 0;
+    virtual void Combine(const double* lhs, const double* rhs, double* res,
+                         size_t size) const = 0;
+    // the result for a pair of elements of any other kind
+    virtual Node Combine(Scope* scope, std::vector<Node>& args) const = 0;
+};
+
+// vector-add
+class VectorAdd : public ElementWise {
+    friend class Heap;
+
+public:
+    bool Combine(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size) const {
+        return AddFixnums(lhs, rhs, res, size);
+    }
+
+    void Combine(const double* lhs, const double* rhs, double* res, size_t size) const {
+        AddFlonums(lhs, rhs, res, size);
+    }
+
+    Node Combine(Scope* scope, std::vector<Node>& args) const;
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorAdd>(*this);
+    }
+};
+
+// vector-mul
+class VectorMul : public ElementWise {
+    friend class Heap;
+
+public:
+    bool Combine(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size) const {
+        return MulFixnums(lhs, rhs, res, size);
+    }
+
+    void Combine(const double* lhs, const double* rhs, double* res, size_t size) const {
+        MulFlonums(lhs, rhs, res, size);
+    }
+
+    Node Combine(Scope* scope, std::vector<Node>& args) const;
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorMul>(*this);
+    }
+};
+
+// element-wise comparisons, the result is a mask of 1 where it holds and 0 elsewhere;
+// either argument may be a number
+class VectorComparison : public Builtin {
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    virtual Comparison GetComparison() const = 0;
+};
+
+// vector=
+class VectorIsEqual : public VectorComparison {
+    friend class Heap;
+
+public:
+    Comparison GetComparison() const {
+        return Comparison::kEqual;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorIsEqual>(*this);
+    }
+};
+
+// vector<
+class VectorIsSmaller : public VectorComparison {
+    friend class Heap;
+
+public:
+    Comparison GetComparison() const {
+        return Comparison::kLess;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorIsSmaller>(*this);
+    }
+};
+
+// vector>
+class VectorIsGreater : public VectorComparison {
+    friend class Heap;
+
+public:
+    Comparison GetComparison() const {
+        return Comparison::kGreater;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorIsGreater>(*this);
+    }
+};
+
+// vector<=
+class VectorIsLeq : public VectorComparison {
+    friend class Heap;
+
+public:
+    Comparison GetComparison() const {
+        return Comparison::kLeq;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorIsLeq>(*this);
+    }
+};
+
+// vector>=
+class VectorIsGeq : public VectorComparison {
+    friend class Heap;
+
+public:
+    Comparison GetComparison() const {
+        return Comparison::kGeq;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<VectorIsGeq>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// hash tables
+
+// hash-table?
+class IsHashTable : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsHashTable>(*this);
+    }
+};
+
+// make-hash-table
+class MakeHashTable : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakeHashTable>(*this);
+    }
+};
+
+// hash-table-ref, with an optional value for missing keys
+class HashTableRef : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    // the default value is returned as is
+    bool ReadsArguments(size_t count) const {
+        return count < 3;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableRef>(*this);
+    }
+};
+
+// hash-table-set!
+class HashTableSet : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableSet>(*this);
+    }
+};
+
+// hash-table-delete!
+class HashTableDelete : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableDelete>(*this);
+    }
+};
+
+// hash-table-contains?
+class HashTableContains : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableContains>(*this);
+    }
+};
+
+// hash-table-count
+class HashTableCount : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableCount>(*this);
+    }
+};
+
+// hash-table-keys
+class HashTableKeys : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableKeys>(*this);
+    }
+};
+
+// hash-table-values
+class HashTableValues : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableValues>(*this);
+    }
+};
+
+// hash-table->alist
+class HashTableToList : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableToList>(*this);
+    }
+};
+
+// hash-table-walk, calls a procedure with every key and value
+class HashTableWalk : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<HashTableWalk>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// persistent maps and vectors
+
+// pmap, from keys followed by their values
+class MakePersistentMap : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakePersistentMap>(*this);
+    }
+};
+
+// pmap?
+class IsPersistentMap : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsPersistentMap>(*this);
+    }
+};
+
+// pmap-ref, with an optional value for missing keys
+class PersistentMapRef : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    // the default value is returned as is
+    bool ReadsArguments(size_t count) const {
+        return count < 3;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapRef>(*this);
+    }
+};
+
+// pmap-set, a new map with the key bound to the value
+class PersistentMapSet : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapSet>(*this);
+    }
+};
+
+// pmap-delete, a new map without the key
+class PersistentMapDelete : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapDelete>(*this);
+    }
+};
+
+// pmap-contains?
+class PersistentMapContains : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapContains>(*this);
+    }
+};
+
+// pmap-count
+class PersistentMapCount : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapCount>(*this);
+    }
+};
+
+// pmap->alist
+class PersistentMapToList : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentMapToList>(*this);
+    }
+};
+
+// pvector
+class MakePersistentVector : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<MakePersistentVector>(*this);
+    }
+};
+
+// pvector?
+class IsPersistentVector : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<IsPersistentVector>(*this);
+    }
+};
+
+// pvector-ref
+class PersistentVectorRef : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVectorRef>(*this);
+    }
+};
+
+// pvector-set, a new vector with the element replaced
+class PersistentVectorSet : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVectorSet>(*this);
+    }
+};
+
+// pvector-push, a new vector with the element added at the end
+class PersistentVectorPush : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVectorPush>(*this);
+    }
+};
+
+// pvector-length
+class PersistentVectorLength : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVectorLength>(*this);
+    }
+};
+
+// pvector->list
+class PersistentVectorToList : public Builtin {
+    friend class Heap;
+
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    Object* Clone() const {
+        return Heap::GetInstance().Make<PersistentVectorToList>(*this);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// strings
+
+// string?
+class IsString : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsNumber>(*this);
+        return Heap::GetInstance().Make<IsString>(*this);
     }
 };
 
-// symbol?
-class IsSymbol : public Object {
+// string-length
+class StringLength : public Builtin {
     friend class Heap;
 
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+public:
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsSymbol>(*this);
+        return Heap::GetInstance().Make<StringLength>(*this);
     }
 };
 
-// boolean?
-class IsBoolean : public Object {
+// string-append, long results share the arguments as a rope
+class StringAppend : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsBoolean>(*this);
+        return Heap::GetInstance().Make<StringAppend>(*this);
     }
 };
 
-// null?
-class IsNull : public Object {
+// substring, the end is optional
+class Substring : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsNull>(*this);
+        return Heap::GetInstance().Make<Substring>(*this);
     }
 };
 
-// pair?
-class IsPair : public Object {
+// string->symbol
+class StringToSymbol : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsPair>(*this);
+        return Heap::GetInstance().Make<StringToSymbol>(*this);
     }
 };
 
-// list?
-class IsList : public Object {
+// symbol->string
+class SymbolToString : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsList>(*this);
+        return Heap::GetInstance().Make<SymbolToString>(*this);
     }
 };
 
-//////////////////////////////////////////////////////////////////////
-// constructors
-
-// cons
-class MakePair : public Object {
+// number->string, the digits the number is printed with
+class NumberToString : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<MakePair>(*this);
+        return Heap::GetInstance().Make<NumberToString>(*this);
     }
 };
 
-// list
-class MakeList : public Object {
+// string->number, #f unless the string is a number literal
+class StringToNumber : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<MakeList>(*this);
+        return Heap::GetInstance().Make<StringToNumber>(*this);
     }
 };
 
 //////////////////////////////////////////////////////////////////////
-// getters
+// list library, iterative so that long lists don't overflow the stack; procedures are
+// called directly with their arguments
 
-// car
-class GetHead : public Object {
+// length
+class ListLength : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
+
+    bool ReadsArguments(size_t) const {
+        return true;
+    }
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<GetHead>(*this);
+        return Heap::GetInstance().Make<ListLength>(*this);
     }
 };
 
-// cdr
-class GetTail : public Object {
+// append, the last argument is shared by the result
+class Append : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<GetTail>(*this);
+        return Heap::GetInstance().Make<Append>(*this);
     }
 };
 
-// list-ref
-class Get : public Object {
+// reverse
+class Reverse : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Get>(*this);
+        return Heap::GetInstance().Make<Reverse>(*this);
     }
 };
 
-// list-tail
-class GetSuffix : public Object {
+// list-copy, an improper tail is kept
+class ListCopy : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<GetSuffix>(*this);
+        return Heap::GetInstance().Make<ListCopy>(*this);
     }
 };
 
-//////////////////////////////////////////////////////////////////////
-// basic arithmetic
-
-// not
-class Not : public Object {
+// map, over several lists up to the end of the shortest one
+class Map : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Not>(*this);
+        return Heap::GetInstance().Make<Map>(*this);
     }
 };
 
-// and
-class And : public Object {
+// for-each, over several lists up to the end of the shortest one
+class ForEach : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<And>(*this);
+        return Heap::GetInstance().Make<ForEach>(*this);
     }
 };
 
-// or
-class Or : public Object {
+// filter
+class Filter : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Or>(*this);
+        return Heap::GetInstance().Make<Filter>(*this);
     }
 };
 
-// +
-class Plus : public Object {
+// fold-left, calls (f acc x...) from the first elements to the last
+class FoldLeft : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Plus>(*this);
+        return Heap::GetInstance().Make<FoldLeft>(*this);
     }
 };
 
-// -
-class Minus : public Object {
+// fold-right, calls (f x... acc) from the last elements to the first
+class FoldRight : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Minus>(*this);
+        return Heap::GetInstance().Make<FoldRight>(*this);
     }
 };
 
-// *
-class Mult : public Object {
+// assoc, keys are compared by structure
+class Assoc : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Mult>(*this);
+        return Heap::GetInstance().Make<Assoc>(*this);
     }
 };
 
-// /
-class Div : public Object {
+// member, elements are compared by structure
+class Member : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Div>(*this);
+        return Heap::GetInstance().Make<Member>(*this);
     }
 };
 
-//////////////////////////////////////////////////////////////////////
-// simple integer operations
-
-// =
-class IsEqual : public Object {
+// sort, a stable merge sort of a list or a vector into a new one
+class Sort : public Builtin {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Apply(Scope* scope, std::vector<Node>& args);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsEqual>(*this);
+        return Heap::GetInstance().Make<Sort>(*this);
     }
 };
 
-// >
-class IsGreater : public Object {
+//////////////////////////////////////////////////////////////////////
+// pair mutation
+
+// set-car!
+class SetCar : public Object {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Run(Scope* scope, Node root);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsGreater>(*this);
+        return Heap::GetInstance().Make<SetCar>(*this);
     }
 };
 
-// <
-class IsSmaller : public Object {
+// set-cdr!
+class SetCdr : public Object {
     friend class Heap;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Run(Scope* scope, Node root);
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsSmaller>(*this);
+        return Heap::GetInstance().Make<SetCdr>(*this);
     }
 };
 
-// >=
-class IsGeq : public Object {
-    friend class Heap;
+//////////////////////////////////////////////////////////////////////
+// special forms, built once from the syntax tree by Analyze
 
+class SpecialForm : public Object {
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
-
-    Object* Clone() const {
-        return Heap::GetInstance().Make<IsGeq>(*this);
-    }
+    virtual Node Eval(Scope* scope) = 0;
+    virtual Compiled Compile() = 0;
 };
 
-// <=
-class IsLeq : public Object {
+// quote
+class Quote : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<IsLeq>(*this);
+        return Heap::GetInstance().Make<Quote>(*this);
     }
+
+    Node GetDatum() const {
+        return datum_;
+    }
+
+protected:
+    Quote(Node datum) : datum_(datum) {
+        AddDependant(datum_);
+    }
+
+private:
+    Node datum_;
 };
 
-// max
-class Max : public Object {
+// variable of the running lambda, either a slot of its frame or a value captured by the
+// closure; variables that are both captured and assigned live in a Box
+class LocalVariable : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Max>(*this);
+        return Heap::GetInstance().Make<LocalVariable>(*this);
+    }
+
+    void SetBoxed() {
+        boxed_ = true;
+    }
+
+    bool IsCaptured() const {
+        return captured_;
+    }
+
+    size_t GetIndex() const {
+        return index_;
+    }
+
+    bool IsBoxed() const {
+        return boxed_;
+    }
+
+protected:
+    LocalVariable(bool captured, size_t index) : captured_(captured), index_(index) {
     }
+
+private:
+    bool captured_;
+    size_t index_;
+    bool boxed_ = false;
 };
 
-// min
-class Min : public Object {
+// set! of a local variable or an internal define
+class LocalAssignment : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Min>(*this);
+        return Heap::GetInstance().Make<LocalAssignment>(*this);
     }
+
+    void SetBoxed() {
+        boxed_ = true;
+    }
+
+protected:
+    LocalAssignment(bool captured, size_t index, Node value)
+        : captured_(captured), index_(index), value_(value) {
+        AddDependant(value_);
+    }
+
+private:
+    bool captured_;
+    size_t index_;
+    Node value_;
+    bool boxed_ = false;
 };
 
-// abs
-class Abs : public Object {
+// if
+class If : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<Abs>(*this);
+        return Heap::GetInstance().Make<If>(*this);
     }
-};
 
-//////////////////////////////////////////////////////////////////////
-// variable manipulation
+    Node GetCondition() const {
+        return condition_;
+    }
+
+    Node GetThen() const {
+        return then_branch_;
+    }
+
+    bool HasElse() const {
+        return has_else_;
+    }
+
+    Node GetElse() const {
+        return else_branch_;
+    }
+
+protected:
+    If(Node condition, Node then_branch, Node else_branch, bool has_else)
+        : condition_(condition),
+          then_branch_(then_branch),
+          else_branch_(else_branch),
+          has_else_(has_else) {
+        AddDependant(condition_);
+        AddDependant(then_branch_);
+        AddDependant(else_branch_);
+    }
+
+private:
+    Node condition_;
+    Node then_branch_;
+    Node else_branch_;
+    bool has_else_;
+};
 
 // define
-class Define : public Object {
+class Define : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
         return Heap::GetInstance().Make<Define>(*this);
     }
+
+protected:
+    Define(const std::string& name, Node value) : name_(name), value_(value) {
+        AddDependant(value_);
+    }
+
+private:
+    std::string name_;
+    Node value_;
 };
 
 // set!
-class Set : public Object {
+class Set : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
         return Heap::GetInstance().Make<Set>(*this);
     }
+
+protected:
+    Set(const std::string& name, Node value) : name_(name), value_(value) {
+        AddDependant(value_);
+    }
+
+private:
+    std::string name_;
+    Node value_;
 };
 
-// set-car!
-class SetCar : public Object {
+// what a specialized body expects a parameter to be
+enum class NumberKind { kFixnum, kFlonum };
+
+// body of a lambda compiled for parameters that are numbers of some kind, see specialize.h
+struct SpecializedBody {
+    // parameters the body reads as numbers, checked on every call
+    std::vector<std::pair<size_t, NumberKind>> numeric;
+    // does flonum arithmetic, which native code would do on boxed values
+    bool flonum = false;
+    std::vector<Compiled> body;
+};
+
+// specialized bodies of a lambda expression
+struct Specialization {
+    // cleared once the assumptions fail, the bodies may still be running
+    bool active = false;
+    // calls no body fits
+    size_t fallbacks = 0;
+    // the integer body, then the ones made for calls with flonum arguments; a deque keeps
+    // the running ones in place
+    std::deque<SpecializedBody> bodies;
+    // bodies tried for flonum arguments, including those with nothing to specialize
+    size_t attempts = 0;
+    // parameters passed to arithmetic and comparisons, flonums there get a body
+    std::vector<size_t> operands;
+    // definition epochs of the builtins the bodies rely on
+    std::vector<std::pair<const uint64_t*, uint64_t>> dependencies;
+};
+
+// lambda
+class ConstructLambda : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<SetCar>(*this);
+        return Heap::GetInstance().Make<ConstructLambda>(*this);
     }
+
+    size_t GetArity() const {
+        return arity_;
+    }
+
+    // arguments go first, then internal definitions
+    size_t GetFrameSize() const {
+        return frame_size_;
+    }
+
+    // slots holding a Box
+    const std::vector<size_t>& GetBoxed() const {
+        return boxed_;
+    }
+
+    Node GetBody() const {
+        return body_;
+    }
+
+    // calls of its closures are cached by their arguments, see MemoTable
+    bool IsMemoized() const {
+        return memoized_;
+    }
+
+    void SetMemoized() {
+        memoized_ = true;
+    }
+
+    TierState& GetTier() {
+        return tier_;
+    }
+
+    Specialization& GetSpecialization() {
+        return specialization_;
+    }
+
+    // empty until the lambda expression is compiled
+    const std::vector<Compiled>& GetCompiledBody() const {
+        return compiled_body_;
+    }
+
+    // where the values captured by the closure come from in the frame creating it
+    struct Capture {
+        bool captured;
+        size_t index;
+    };
+
+protected:
+    // body is a list of already analyzed expressions
+    ConstructLambda(size_t arity, size_t frame_size, const std::vector<size_t>& boxed,
+                    const std::vector<Capture>& captures, Node body)
+        : arity_(arity), frame_size_(frame_size), boxed_(boxed), captures_(captures), body_(body) {
+        AddDependant(body_);
+    }
+
+private:
+    size_t arity_;
+    size_t frame_size_;
+    std::vector<size_t> boxed_;
+    std::vector<Capture> captures_;
+    Node body_;
+    bool memoized_ = false;
+    std::vector<Compiled> compiled_body_;
+    TierState tier_;
+    Specialization specialization_;
 };
 
-// set-cdr!
-class SetCdr : public Object {
+// and
+class And : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<SetCdr>(*this);
+        return Heap::GetInstance().Make<And>(*this);
     }
-};
 
-//////////////////////////////////////////////////////////////////////
-// control flow
+protected:
+    And(const std::vector<Node>& args) : args_(args) {
+        for (auto arg : args_) {
+            AddDependant(arg);
+        }
+    }
 
-// if
-class If : public Object {
+private:
+    std::vector<Node> args_;
+};
+
+// or
+class Or : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<If>(*this);
+        return Heap::GetInstance().Make<Or>(*this);
     }
-};
 
-//////////////////////////////////////////////////////////////////////
-// lambda
+protected:
+    Or(const std::vector<Node>& args) : args_(args) {
+        for (auto arg : args_) {
+            AddDependant(arg);
+        }
+    }
 
-// lambda
-class ConstructLambda : public Object {
+private:
+    std::vector<Node> args_;
+};
+
+// expression rewritten by Optimize under assumptions about the bindings of some globals,
+// the original is evaluated once any of them is defined or set again
+class Guard : public SpecialForm {
     friend class Heap;
+    friend class Optimizer;
+    friend class Specializer;
 
 public:
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    struct Dependency {
+        const uint64_t* epoch;
+        uint64_t expected;
+    };
+
+    Node Eval(Scope* scope);
+    Compiled Compile();
 
     Object* Clone() const {
-        return Heap::GetInstance().Make<ConstructLambda>(*this);
+        return Heap::GetInstance().Make<Guard>(*this);
+    }
+
+    bool Holds() const {
+        for (auto [epoch, expected] : dependencies_) {
+            if (*epoch != expected) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::vector<Dependency>& GetDependencies() const {
+        return dependencies_;
+    }
+
+    Node GetOptimized() const {
+        return optimized_;
+    }
+
+    Node GetOriginal() const {
+        return original_;
     }
+
+protected:
+    Guard(const std::vector<Dependency>& dependencies, Node optimized, Node original)
+        : dependencies_(dependencies), optimized_(optimized), original_(original) {
+        AddDependant(optimized_);
+        AddDependant(original_);
+    }
+
+private:
+    std::vector<Dependency> dependencies_;
+    Node optimized_;
+    Node original_;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -683,6 +2990,16 @@ inline int64_t GetValue(Object* root) {
     return As<Number>(root)->GetValue();
 }
 
+// numbers of any kind
+inline bool IsNumeric(Object* root) {
+    return Is<Number>(root) || Is<BigNumber>(root) || Is<Flonum>(root);
+}
+
+// values that evaluate to themselves
+inline bool IsSelfEvaluating(Object* root) {
+    return IsNumeric(root) || Is<Vector>(root) || Is<String>(root);
+}
+
 inline const std::string& GetName(Object* root) {
     return As<Symbol>(root)->GetName();
 }
@@ -700,30 +3017,88 @@ inline bool IsNullCell(Object* root) {
     return !GetFirst(root);
 }
 
+// results of the calls of a memoized closure. Arguments are compared by structure: lists
+// and vectors are copied into the table, so changing them later doesn't change the entry.
+// Once the table is full the least recently used result is dropped.
+class MemoTable : public Object {
+    friend class Heap;
+
+public:
+    // arguments with more pairs and vector elements than that are neither hashed nor kept
+    static constexpr size_t kMaxKeySize = 64;
+
+    // false if the arguments are too large to be kept
+    static bool Hash(const Node* args, size_t count, size_t* hash);
+
+    // arguments with their lists copied, taken before the body can change them
+    static std::vector<Node> Copy(const Node* args, size_t count);
+
+    // the result of an earlier call with equal arguments, it becomes the most recent one
+    bool Find(size_t hash, const Node* args, size_t count, Node* res);
+
+    // adds the result of a call with copied arguments, returns the number of entries
+    // dropped to keep at most capacity of them
+    size_t Insert(size_t hash, std::vector<Node> args, Node res, size_t capacity);
+
+    void Update();
+
+protected:
+    MemoTable() = default;
+
+private:
+    struct Entry {
+        size_t hash;
+        std::vector<Node> args;
+        Node res;
+    };
+
+    // the most recently used entry goes first
+    std::list<Entry> entries_;
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> index_;
+};
+
+// closure holding copies of the free variables of its body
 class Lambda : public Object {
     friend class Heap;
 
 public:
-    Lambda(std::shared_ptr<Scope> scope, const std::vector<Node>& args, Node calc)
-        : local_scope_(scope), args_(args), calc_(calc) {
-        dependants_ = std::multiset<Node>(args.begin(), args.end());
-        dependants_.insert(calc_);
+    Lambda(ConstructLambda* code, const std::vector<Node>& captures)
+        : code_(code), captures_(captures) {
+        for (auto value : captures_) {
+            AddDependant(value);
+        }
+        AddDependant(code_);
     }
 
-    Node Run(std::shared_ptr<Scope> scope, Node root);
+    Node Run(Scope* scope, Node root);
+
+    // call with already evaluated arguments
+    Node Apply(Scope* scope, Node* args, size_t count);
+
+    Node Invoke(Scope* scope, const std::vector<Compiled>& args, Node syntax);
+
+    Node* GetCaptures() {
+        return captures_.data();
+    }
+
+    ConstructLambda* GetCode() const {
+        return code_;
+    }
 
     Object* Clone() const {
-        auto ptr = As<Lambda>(Heap::GetInstance().Make<Lambda>(*this));
-        ptr->local_scope_ = local_scope_;
-        ptr->args_ = args_;
-        ptr->calc_ = calc_;
-        return ptr;
+        return Heap::GetInstance().Make<Lambda>(*this);
     }
 
 private:
-    std::shared_ptr<Scope> local_scope_;
-    std::vector<Node> args_;
-    Node calc_;
+    // runs the body once the arguments are in the frame, memoized lambdas look for the
+    // result first
+    Node Enter(Scope* scope, Frame* frame);
+    Node Execute(Scope* scope, Frame* frame);
+
+    ConstructLambda* code_;
+    std::vector<Node> captures_;
+    // made on the first call of a memoized lambda
+    MemoTable* memo_ = nullptr;
 };
 
 // #include <iostream>
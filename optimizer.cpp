@@ -0,0 +1,357 @@
+#include "optimizer.h"
+
+#include "error.h"
+
+#include <vector>
+
+using Dependencies = std::vector<Guard::Dependency>;
+
+// builtins without side effects that can be applied to constants ahead of time
+bool Foldable(Node func) {
+    return Is<Plus>(func) || Is<Minus>(func) || Is<Mult>(func) || Is<Div>(func) ||
+           Is<Max>(func) || Is<Min>(func) || Is<Abs>(func) || Is<IsEqual>(func) ||
+           Is<IsGreater>(func) || Is<IsSmaller>(func) || Is<IsGeq>(func) || Is<IsLeq>(func) ||
+           Is<IsNumber>(func) || Is<IsSymbol>(func) || Is<IsBoolean>(func) || Is<IsNull>(func);
+}
+
+class Optimizer {
+public:
+    explicit Optimizer(Scope* scope) : scope_(scope) {
+    }
+
+    Node Optimize(Node root);
+
+private:
+    static constexpr size_t kMaxInlineSize = 16;
+    static constexpr size_t kMaxInlineDepth = 4;
+
+    void Depend(const std::string& name, Dependencies* dependencies) {
+        const uint64_t* epoch = scope_->GetEpoch(name);
+        for (auto& dependency : *dependencies) {
+            if (dependency.epoch == epoch) {
+                return;
+            }
+        }
+        dependencies->push_back({epoch, *epoch});
+    }
+
+    Node Wrap(const Dependencies& dependencies, Node optimized, Node original) {
+        if (dependencies.empty()) {
+            return optimized;
+        }
+        return Heap::GetInstance().Make<Guard>(dependencies, optimized, original);
+    }
+
+    // children of special forms are also dependants for the GC
+    template <class T>
+    void Replace(T* owner, Node& child) {
+        Node res = Optimize(child);
+        if (res != child) {
+            owner->RemoveDependant(child);
+            child = res;
+            owner->AddDependant(child);
+        }
+    }
+
+    bool Constant(Node root, Node* value, Dependencies* dependencies);
+    Node OptimizeIf(If* root);
+    Node OptimizeCall(Node root);
+    Node Fold(Node root, Builtin* func, const std::vector<Node>& args,
+              Dependencies dependencies);
+    Node Inline(Node root, ConstructLambda* code, const std::string& name,
+                const std::vector<Node>& args, Dependencies dependencies);
+    size_t Size(Node root, const std::string& name, std::vector<size_t>* uses) const;
+    bool Substitute(Node root, const std::vector<Node>& args, Node* res);
+
+    Scope* scope_;
+    size_t depth_ = 0;
+};
+
+Node Optimizer::Optimize(Node root) {
+    if (auto form = As<If>(root)) {
+        return OptimizeIf(form);
+    }
+    if (auto form = As<Define>(root)) {
+        Replace(form, form->value_);
+    } else if (auto form = As<Set>(root)) {
+        Replace(form, form->value_);
+    } else if (auto form = As<LocalAssignment>(root)) {
+        Replace(form, form->value_);
+    } else if (auto form = As<ConstructLambda>(root)) {
+        for (Node cur = form->body_; cur; cur = GetSecond(cur)) {
+            GetFirst(cur) = Optimize(GetFirst(cur));
+        }
+    } else if (auto form = As<And>(root)) {
+        for (auto& arg : form->args_) {
+            Replace(form, arg);
+        }
+    } else if (auto form = As<Or>(root)) {
+        for (auto& arg : form->args_) {
+            Replace(form, arg);
+        }
+    } else if (Is<Cell>(root)) {
+        return OptimizeCall(root);
+    }
+    return root;
+}
+
+// value root always evaluates to while the dependencies hold
+bool Optimizer::Constant(Node root, Node* value, Dependencies* dependencies) {
+    if (IsSelfEvaluating(root)) {
+        *value = root;
+        return true;
+    }
+    if (auto quote = As<Quote>(root)) {
+        *value = quote->datum_;
+        return true;
+    }
+    if (auto guard = As<Guard>(root)) {
+        if (!Constant(guard->optimized_, value, dependencies)) {
+            return false;
+        }
+        for (auto [epoch, expected] : guard->dependencies_) {
+            dependencies->push_back({epoch, expected});
+        }
+        return true;
+    }
+    if (Is<Symbol>(root)) {
+        Node* slot = scope_->Lookup(GetName(root));
+        if (!slot) {
+            return false;
+        }
+        *value = *slot;
+        Depend(GetName(root), dependencies);
+        return true;
+    }
+    return false;
+}
+
+Node Optimizer::OptimizeIf(If* root) {
+    Replace(root, root->condition_);
+    Replace(root, root->then_branch_);
+    if (root->has_else_) {
+        Replace(root, root->else_branch_);
+    }
+
+    Node condition;
+    Dependencies dependencies;
+    if (!Constant(root->condition_, &condition, &dependencies)) {
+        return root;
+    }
+    Node branch;
+    if (IsTrue(condition)) {
+        branch = root->then_branch_;
+    } else if (root->has_else_) {
+        branch = root->else_branch_;
+    } else {
+        branch = Heap::GetInstance().Make<Quote>(nullptr);
+    }
+    // evaluating () is an error, which is left to the original
+    if (!branch) {
+        return root;
+    }
+    return Wrap(dependencies, branch, root);
+}
+
+Node Optimizer::OptimizeCall(Node root) {
+    Node head = GetFirst(root);
+    if (!Is<Symbol>(head)) {
+        GetFirst(root) = Optimize(head);
+    }
+    std::vector<Node> args;
+    bool proper = true;
+    Node cur = GetSecond(root);
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        Node arg = GetFirst(cur);
+        // the raw tail of (f a . 'b) and () arguments are special cased by ParseArguments
+        if (!arg || (Is<Symbol>(arg) && GetName(arg) == "quote")) {
+            proper = false;
+            break;
+        }
+        GetFirst(cur) = Optimize(arg);
+        args.push_back(GetFirst(cur));
+    }
+    if (!proper || cur || !Is<Symbol>(head)) {
+        return root;
+    }
+
+    const std::string& name = GetName(head);
+    Node* slot = scope_->Lookup(name);
+    if (!slot || !*slot) {
+        return root;
+    }
+    Dependencies dependencies;
+    Depend(name, &dependencies);
+    if (Foldable(*slot)) {
+        return Fold(root, As<Builtin>(*slot), args, dependencies);
+    }
+    if (auto func = As<Lambda>(*slot)) {
+        return Inline(root, func->GetCode(), name, args, dependencies);
+    }
+    return root;
+}
+
+Node Optimizer::Fold(Node root, Builtin* func, const std::vector<Node>& args,
+                     Dependencies dependencies) {
+    std::vector<Node> values;
+    for (auto arg : args) {
+        Node value;
+        if (!Constant(arg, &value, &dependencies)) {
+            return root;
+        }
+        values.push_back(value);
+    }
+    Node res;
+    try {
+        res = func->Apply(scope_, values);
+    } catch (std::runtime_error&) {
+        // the error is raised when the expression is evaluated
+        return root;
+    }
+    if (IsNumeric(res)) {
+        return Wrap(dependencies, res, root);
+    }
+    // predicates return the current bindings of #t and #f
+    Depend("#t", &dependencies);
+    Depend("#f", &dependencies);
+    return Wrap(dependencies, Heap::GetInstance().Make<Quote>(res), root);
+}
+
+// number of nodes of an inlinable body, -1 if it can't be inlined; counts the uses of the
+// arguments and fails on calls of name
+size_t Optimizer::Size(Node root, const std::string& name, std::vector<size_t>* uses) const {
+    constexpr size_t kNever = -1;
+    if (!root || IsSelfEvaluating(root) || Is<Quote>(root)) {
+        return 1;
+    }
+    if (Is<Symbol>(root)) {
+        return GetName(root) == name ? kNever : 1;
+    }
+    if (auto var = As<LocalVariable>(root)) {
+        if (var->captured_) {
+            return kNever;
+        }
+        ++(*uses)[var->index_];
+        return 1;
+    }
+    std::vector<Node> children;
+    if (auto form = As<If>(root)) {
+        children = {form->condition_, form->then_branch_, form->else_branch_};
+    } else if (auto form = As<And>(root)) {
+        children = form->args_;
+    } else if (auto form = As<Or>(root)) {
+        children = form->args_;
+    } else if (auto guard = As<Guard>(root)) {
+        children = {guard->optimized_, guard->original_};
+    } else if (Is<Cell>(root)) {
+        children = {GetFirst(root), GetSecond(root)};
+    } else {
+        return kNever;
+    }
+    size_t res = 1;
+    for (auto child : children) {
+        size_t size = Size(child, name, uses);
+        if (size == kNever) {
+            return kNever;
+        }
+        res += size;
+    }
+    return res;
+}
+
+// copy of the body with the arguments in place of the variables of the frame
+bool Optimizer::Substitute(Node root, const std::vector<Node>& args, Node* res) {
+    auto& heap = Heap::GetInstance();
+    if (auto var = As<LocalVariable>(root)) {
+        *res = args[var->index_];
+        return true;
+    }
+    if (auto form = As<If>(root)) {
+        Node condition, then_branch, else_branch;
+        if (!Substitute(form->condition_, args, &condition) ||
+            !Substitute(form->then_branch_, args, &then_branch) ||
+            !Substitute(form->else_branch_, args, &else_branch)) {
+            return false;
+        }
+        *res = heap.Make<If>(condition, then_branch, else_branch, form->has_else_);
+        return true;
+    }
+    if (Is<And>(root) || Is<Or>(root)) {
+        const auto& exprs = Is<And>(root) ? As<And>(root)->args_ : As<Or>(root)->args_;
+        std::vector<Node> copies(exprs.size());
+        for (size_t i = 0; i < exprs.size(); ++i) {
+            if (!Substitute(exprs[i], args, &copies[i])) {
+                return false;
+            }
+        }
+        *res = Is<And>(root) ? heap.Make<And>(copies) : heap.Make<Or>(copies);
+        return true;
+    }
+    if (auto guard = As<Guard>(root)) {
+        Node optimized, original;
+        if (!Substitute(guard->optimized_, args, &optimized) ||
+            !Substitute(guard->original_, args, &original)) {
+            return false;
+        }
+        *res = heap.Make<Guard>(guard->dependencies_, optimized, original);
+        return true;
+    }
+    if (Is<Cell>(root)) {
+        // quoted data in the raw tail of a call is shared
+        if (Is<Symbol>(GetFirst(root)) && GetName(GetFirst(root)) == "quote") {
+            *res = root;
+            return true;
+        }
+        Node first, second;
+        if (!Substitute(GetFirst(root), args, &first) ||
+            !Substitute(GetSecond(root), args, &second)) {
+            return false;
+        }
+        *res = heap.Make<Cell>(first, second);
+        return true;
+    }
+    *res = root;
+    return true;
+}
+
+Node Optimizer::Inline(Node root, ConstructLambda* code, const std::string& name,
+                       const std::vector<Node>& args, Dependencies dependencies) {
+    // only lambdas of one expression that don't capture or assign anything; memoized ones
+    // would skip their table
+    if (depth_ == kMaxInlineDepth || code->memoized_ || !code->captures_.empty() ||
+        !code->boxed_.empty() || code->frame_size_ != code->arity_ ||
+        code->arity_ != args.size() || !code->body_ || GetSecond(code->body_)) {
+        return root;
+    }
+    Node body = GetFirst(code->body_);
+    std::vector<size_t> uses(args.size());
+    size_t size = Size(body, name, &uses);
+    if (size == static_cast<size_t>(-1) || size > kMaxInlineSize) {
+        return root;
+    }
+
+    // arguments are moved into the body, so evaluating them must not do anything; a local
+    // may still be unassigned, that error must not get lost
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (IsSelfEvaluating(args[i]) || Is<Quote>(args[i])) {
+            continue;
+        }
+        auto var = As<LocalVariable>(args[i]);
+        if (!var || var->boxed_ || !uses[i]) {
+            return root;
+        }
+    }
+
+    Node inlined;
+    if (!Substitute(body, args, &inlined)) {
+        return root;
+    }
+    ++depth_;
+    inlined = Optimize(inlined);
+    --depth_;
+    return Wrap(dependencies, inlined, root);
+}
+
+Node Optimize(Scope* scope, Node root) {
+    return Optimizer(scope).Optimize(root);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "object.h"
+
+// Folds builtin applications of constants, drops if branches that can't be taken and inlines
+// calls of small lambdas. Every rewrite relies on the current bindings of some globals and is
+// wrapped in a Guard that falls back to the original expression once they change.
+Node Optimize(Scope* scope, Node root);
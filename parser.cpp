@@ -3,6 +3,7 @@
 #include "error.h"
 
 #include <sstream>
+#include <vector>
 
 void CheckEnd(Tokenizer* tokenizer) {
     if (tokenizer->IsEnd()) {
@@ -38,18 +39,33 @@ Object* Read(Tokenizer* tokenizer) {
     if (IsOpen(tokenizer)) {
         return ReadList(tokenizer);
     }
+    if (std::get_if<VectorToken>(&token)) {
+        return ReadVector(tokenizer);
+    }
     if (auto obj = std::get_if<ConstantToken>(&token)) {
         tokenizer->Next();
         return Heap::GetInstance().Make<Number>(obj->value_);
     }
+    if (auto obj = std::get_if<BigConstantToken>(&token)) {
+        tokenizer->Next();
+        return Heap::GetInstance().Make<BigNumber>(BigInt::Parse(obj->digits_));
+    }
+    if (auto obj = std::get_if<FloatConstantToken>(&token)) {
+        tokenizer->Next();
+        return Heap::GetInstance().Make<Flonum>(obj->value_);
+    }
+    if (auto obj = std::get_if<StringToken>(&token)) {
+        tokenizer->Next();
+        return Heap::GetInstance().Make<String>(std::string_view(obj->value_));
+    }
     if (auto obj = std::get_if<SymbolToken>(&token)) {
         tokenizer->Next();
-        return Heap::GetInstance().Make<Symbol>(obj->name_);
+        return Heap::GetInstance().Intern(obj->name_);
     }
     if (std::get_if<QuoteToken>(&token)) {
         tokenizer->Next();
         return Heap::GetInstance().Make<Cell>(
-            Heap::GetInstance().Make<Symbol>("quote"),
+            Heap::GetInstance().Intern("quote"),
             Heap::GetInstance().Make<Cell>(Read(tokenizer), nullptr));
     }
     Heap::GetInstance().RunGC();
@@ -67,20 +83,16 @@ Object* ReadList(Tokenizer* tokenizer) {
         return nullptr;
     }
 
-    Object* res = Heap::GetInstance().Make<Cell>();
-    Object* cur = res;
+    // the elements are read first to keep the pairs together in a block
+    std::vector<Object*> elements;
+    Object* tail = nullptr;
     while (!IsClosed(tokenizer)) {
-        GetFirst(cur) = Read(tokenizer);
-
-        if (!IsClosed(tokenizer)) {
-            if (GetDot(tokenizer)) {
-                Move(tokenizer);
-                GetSecond(cur) = Read(tokenizer);
-                break;
-            } else {
-                GetSecond(cur) = Heap::GetInstance().Make<Cell>();
-                cur = GetSecond(cur);
-            }
+        elements.push_back(Read(tokenizer));
+
+        if (!IsClosed(tokenizer) && GetDot(tokenizer)) {
+            Move(tokenizer);
+            tail = Read(tokenizer);
+            break;
         }
     }
 
@@ -89,7 +101,23 @@ Object* ReadList(Tokenizer* tokenizer) {
         throw SyntaxError("Invalid syntax");
     }
     tokenizer->Next();
-    return res;
+    return MakeListOf(elements, tail);
+}
+
+// elements up to the closing bracket, there is no dotted form
+Object* ReadVector(Tokenizer* tokenizer) {
+    Move(tokenizer);
+    std::vector<Object*> elements;
+    while (!IsClosed(tokenizer)) {
+        if (GetDot(tokenizer)) {
+            Heap::GetInstance().RunGC();
+            throw SyntaxError("Invalid syntax");
+        }
+        elements.push_back(Read(tokenizer));
+        CheckEnd(tokenizer);
+    }
+    tokenizer->Next();
+    return Heap::GetInstance().Make<Vector>(elements);
 }
 
 Object* ReadFullS(const std::string& str) {
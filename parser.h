@@ -9,4 +9,6 @@ Object* Read(Tokenizer* tokenizer);
 
 Object* ReadList(Tokenizer* tokenizer);
 
+Object* ReadVector(Tokenizer* tokenizer);
+
 Object* ReadFullS(const std::string& str);
\ No newline at end of file
@@ -1,21 +1,30 @@
 #include "scheme.h"
 
 #include "parser.h"
+#include "analyzer.h"
+#include "optimizer.h"
+#include "specialize.h"
 #include "error.h"
 
+#include <charconv>
+#include <cmath>
 #include <map>
 #include <vector>
 
-Node Evaluate(std::shared_ptr<Scope> scope, Node root) {
+Node Evaluate(Scope* scope, Node root) {
     if (!root) {
         throw RuntimeError("Evaluating null not allowed");
     }
 
-    if (Is<Number>(root)) {
+    if (IsSelfEvaluating(root)) {
         return root;
     }
-    if (Is<Symbol>(root)) {
-        return scope->ResolveSymbol(GetName(root));
+    if (auto symbol = As<Symbol>(root)) {
+        return scope->ResolveSymbol(symbol->GetName());
+    }
+
+    if (auto form = As<SpecialForm>(root)) {
+        return form->Eval(scope);
     }
 
     if (!Is<Cell>(root)) {
@@ -24,41 +33,62 @@ Node Evaluate(std::shared_ptr<Scope> scope, Node root) {
 
     if (!Is<Symbol>(GetFirst(root))) {
         auto func = Evaluate(scope, GetFirst(root));
-        if (Is<Lambda>(func)) {
-            return func->Run(scope, GetSecond(root));
+        if (!func) {
+            throw RuntimeError("Object not callable");
         }
-        throw RuntimeError("Function name has to be a string");
+        return func->Run(scope, GetSecond(root));
     }
 
-    const std::string& func = As<Symbol>(GetFirst(root))->GetName();
+    auto head = As<Symbol>(GetFirst(root));
+    return scope->ResolveSymbol(head->GetName())->Run(scope, GetSecond(root));
+}
 
-    // exceptionally special case
-    if (func == "quote") {
-        return GetFirst(GetSecond(root));
+// shortest digits that read back as the same double, with a dot or an exponent so it isn't
+// read as an integer
+std::string ConvertFlonum(double value) {
+    if (std::isnan(value)) {
+        return "+nan.0";
     }
-
-    return scope->ResolveSymbol(func)->Run(scope, GetSecond(root));
+    if (std::isinf(value)) {
+        return value > 0 ? "+inf.0" : "-inf.0";
+    }
+    char buffer[32];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    std::string res(buffer, end);
+    if (res.find_first_of(".e") == std::string::npos) {
+        res += ".0";
+    }
+    return res;
 }
 
-std::string Convert(Node root);
+// in quotes, with the escapes the tokenizer reads
+std::string ConvertString(std::string_view text) {
+    std::string res{'"'};
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            res.push_back('\\');
+            res.push_back(c);
+        } else if (c == '\n') {
+            res += "\\n";
+        } else if (c == '\t') {
+            res += "\\t";
+        } else {
+            res.push_back(c);
+        }
+    }
+    res.push_back('"');
+    return res;
+}
 
+// the elements of a list, with a dot before the tail of an improper one
 void ExpandIntoList(Node root, std::vector<std::string>& ans) {
-    if (!root) {
-        return;
-    }
-    if (!Is<Cell>(root)) {
-        ans.push_back(Convert(root));
-        return;
-    }
-    if (IsNullCell(root)) {
+    for (; Is<Cell>(root); root = GetSecond(root)) {
         ans.push_back(Convert(GetFirst(root)));
-        return;
     }
-    ExpandIntoList(GetFirst(root), ans);
-    if (GetSecond(root) && !Is<Cell>(GetSecond(root))) {
+    if (root) {
         ans.push_back(".");
+        ans.push_back(Convert(root));
     }
-    ExpandIntoList(GetSecond(root), ans);
 }
 
 std::string Convert(Node root) {
@@ -68,9 +98,35 @@ std::string Convert(Node root) {
     if (Is<Number>(root)) {
         return std::to_string(GetValue(root));
     }
+    if (auto number = As<BigNumber>(root)) {
+        return number->GetValue().ToString();
+    }
+    if (auto number = As<Flonum>(root)) {
+        return ConvertFlonum(number->GetValue());
+    }
+    if (auto vector = As<Vector>(root)) {
+        std::string ans = "#(";
+        for (size_t i = 0; i < vector->GetSize(); ++i) {
+            if (i) {
+                ans.push_back(' ');
+            }
+            if (vector->GetStorage() == Vector::Storage::kFixnums) {
+                ans += std::to_string(vector->GetFixnums()[i]);
+            } else if (vector->GetStorage() == Vector::Storage::kFlonums) {
+                ans += ConvertFlonum(vector->GetFlonums()[i]);
+            } else {
+                ans += Convert(vector->GetObjects()[i]);
+            }
+        }
+        ans.push_back(')');
+        return ans;
+    }
     if (Is<Symbol>(root)) {
         return GetName(root);
     }
+    if (auto string = As<String>(root)) {
+        return ConvertString(string->GetView());
+    }
     if (!Is<Cell>(root)) {
         throw SyntaxError("Invalid syntax");
     }
@@ -88,7 +144,11 @@ std::string Convert(Node root) {
 }
 
 std::string Interpreter::Run(const std::string& program) {
-    auto res = Convert(Evaluate(global_scope_, ReadFullS(program)));
+    Scope* scope = global_scope_.get();
+    Node tree = Optimize(scope, Analyze(ReadFullS(program)));
+    Compiled compiled = Compile(tree);
+    Specialize(scope, tree);
+    auto res = Convert(compiled(scope));
     Heap::GetInstance().RunGC();
     return res;
 }
@@ -4,11 +4,17 @@
 
 #include <string>
 
-Node Evaluate(std::shared_ptr<Scope> scope, Node root);
+Node Evaluate(Scope* scope, Node root);
+
+// the text Interpreter::Run gives for a value
+std::string Convert(Node root);
+
+// prepares an analyzed tree for evaluation, the bodies of its lambdas are compiled as well
+Compiled Compile(Node root);
 
 class Interpreter {
 public:
-    Interpreter() : global_scope_(new Scope(nullptr)) {
+    Interpreter() : global_scope_(new Scope()) {
     }
 
     ~Interpreter() {
@@ -18,6 +24,34 @@ public:
 
     std::string Run(const std::string& program);
 
+    // lambdas called more than threshold times run as native code, see jit.h
+    void SetJit(bool enabled, size_t threshold = JitOptions().threshold) {
+        auto& jit = global_scope_->GetJitOptions();
+        jit.enabled = enabled && kJitSupported;
+        jit.threshold = threshold;
+    }
+
+    // promotions to native code and deoptimizations back to the interpreter so far
+    const TierStats& GetTierStats() const {
+        return global_scope_->GetTierStats();
+    }
+
+    // calls of lambdas defined with define-memoized answered from their tables so far
+    const MemoStats& GetMemoStats() const {
+        return global_scope_->GetMemoStats();
+    }
+
+    // results every memoized lambda keeps at most, the least recently used go first
+    void SetMemoCapacity(size_t capacity) {
+        global_scope_->SetMemoCapacity(capacity);
+    }
+
+    // objects made on the heap and temporaries made in the scratch area instead so far
+    AllocationStats GetAllocationStats() const {
+        return {Heap::GetInstance().GetAllocations(),
+                global_scope_->GetScratch().GetAllocations()};
+    }
+
 private:
-    std::shared_ptr<Scope> global_scope_;
+    std::unique_ptr<Scope> global_scope_;
 };
@@ -0,0 +1,548 @@
+#include "simd.h"
+
+#include "bignum.h"
+
+#include <algorithm>
+#include <functional>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+// flonum reductions go through kPartials running values, element i of every full block of
+// kPartials goes to value i; AVX2 keeps them in two registers of four lanes
+constexpr size_t kPartials = 8;
+
+// the partial values combined as a tree, then the elements after the full blocks in order
+template <class Func>
+double FinishPartials(const double* partial, const double* data, size_t begin, size_t size,
+                      Func func) {
+    double res = func(func(func(partial[0], partial[4]), func(partial[1], partial[5])),
+                      func(func(partial[2], partial[6]), func(partial[3], partial[7])));
+    for (size_t i = begin; i < size; ++i) {
+        res = func(res, data[i]);
+    }
+    return res;
+}
+
+// the min and max of the partials are seeded with the first block, or with the first
+// element if there is no full block; seen twice it doesn't change the result
+size_t SeedPartials(const double* data, size_t size, double* partial) {
+    if (size < kPartials) {
+        std::fill(partial, partial + kPartials, data[0]);
+        return 0;
+    }
+    std::copy(data, data + kPartials, partial);
+    return kPartials;
+}
+
+double Lesser(double lhs, double rhs) {
+    return std::min(lhs, rhs);
+}
+
+double Greater(double lhs, double rhs) {
+    return std::max(lhs, rhs);
+}
+
+double Add(double lhs, double rhs) {
+    return lhs + rhs;
+}
+
+// sum of two fixnums wrapped around, with the sign bit set in overflow if it didn't fit
+int64_t WrappingAdd(int64_t lhs, int64_t rhs, int64_t* overflow) {
+    auto res = static_cast<int64_t>(static_cast<uint64_t>(lhs) + static_cast<uint64_t>(rhs));
+    *overflow |= (lhs ^ res) & (rhs ^ res);
+    return res;
+}
+
+template <class T, class Func>
+void PortableCompare(const T* lhs, const T* rhs, int64_t* res, size_t size, Func func) {
+    for (size_t i = 0; i < size; ++i) {
+        res[i] = func(lhs[i], rhs[i]);
+    }
+}
+
+template <class T>
+void PortableCompare(const T* lhs, const T* rhs, int64_t* res, size_t size,
+                     Comparison comparison) {
+    switch (comparison) {
+        case Comparison::kEqual:
+            return PortableCompare(lhs, rhs, res, size, std::equal_to<>());
+        case Comparison::kLess:
+            return PortableCompare(lhs, rhs, res, size, std::less<>());
+        case Comparison::kGreater:
+            return PortableCompare(lhs, rhs, res, size, std::greater<>());
+        case Comparison::kLeq:
+            return PortableCompare(lhs, rhs, res, size, std::less_equal<>());
+        case Comparison::kGeq:
+            return PortableCompare(lhs, rhs, res, size, std::greater_equal<>());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// portable kernels
+
+bool PortableSumFixnums(const int64_t* data, size_t size, int64_t* res) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (AddOverflow(sum, data[i], &sum)) {
+            return false;
+        }
+    }
+    *res = sum;
+    return true;
+}
+
+double PortableSumFlonums(const double* data, size_t size) {
+    double partial[kPartials] = {};
+    size_t blocks = size / kPartials * kPartials;
+    for (size_t i = 0; i < blocks; i += kPartials) {
+        for (size_t k = 0; k < kPartials; ++k) {
+            partial[k] += data[i + k];
+        }
+    }
+    return FinishPartials(partial, data, blocks, size, Add);
+}
+
+double PortableDotFlonums(const double* lhs, const double* rhs, size_t size) {
+    double partial[kPartials] = {};
+    size_t blocks = size / kPartials * kPartials;
+    for (size_t i = 0; i < blocks; i += kPartials) {
+        for (size_t k = 0; k < kPartials; ++k) {
+            partial[k] += lhs[i + k] * rhs[i + k];
+        }
+    }
+    double res = FinishPartials(partial, lhs, size, size, Add);
+    for (size_t i = blocks; i < size; ++i) {
+        res += lhs[i] * rhs[i];
+    }
+    return res;
+}
+
+bool PortableAddFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size) {
+    int64_t overflow = 0;
+    for (size_t i = 0; i < size; ++i) {
+        res[i] = WrappingAdd(lhs[i], rhs[i], &overflow);
+    }
+    return overflow >= 0;
+}
+
+void PortableAddFlonums(const double* lhs, const double* rhs, double* res, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        res[i] = lhs[i] + rhs[i];
+    }
+}
+
+void PortableMulFlonums(const double* lhs, const double* rhs, double* res, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        res[i] = lhs[i] * rhs[i];
+    }
+}
+
+template <class Func>
+double PortableExtremum(const double* data, size_t size, Func func) {
+    double partial[kPartials];
+    size_t begin = SeedPartials(data, size, partial);
+    size_t blocks = size / kPartials * kPartials;
+    bool nan = false;
+    for (size_t i = 0; i < size; ++i) {
+        nan |= data[i] != data[i];
+    }
+    if (nan) {
+        return *std::find_if(data, data + size, [](double x) { return x != x; });
+    }
+    for (size_t i = begin; i < blocks; i += kPartials) {
+        for (size_t k = 0; k < kPartials; ++k) {
+            partial[k] = func(partial[k], data[i + k]);
+        }
+    }
+    return FinishPartials(partial, data, std::max(begin, blocks), size, func);
+}
+
+//////////////////////////////////////////////////////////////////////
+// AVX2 kernels
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+bool HasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+bool avx2_enabled = HasAvx2();
+
+__attribute__((target("avx2"))) bool NoSignBit(__m256i flags) {
+    return !_mm256_movemask_pd(_mm256_castsi256_pd(flags));
+}
+
+// wrapping lane sums, sets the sign bits of overflow where one didn't fit
+__attribute__((target("avx2"))) __m256i WrappingAdd(__m256i lhs, __m256i rhs,
+                                                    __m256i* overflow) {
+    __m256i res = _mm256_add_epi64(lhs, rhs);
+    *overflow = _mm256_or_si256(
+        *overflow, _mm256_and_si256(_mm256_xor_si256(lhs, res), _mm256_xor_si256(rhs, res)));
+    return res;
+}
+
+__attribute__((target("avx2"))) bool Avx2SumFixnums(const int64_t* data, size_t size,
+                                                    int64_t* res) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i overflow = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        sum = WrappingAdd(sum, block, &overflow);
+    }
+    if (!NoSignBit(overflow)) {
+        return false;
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    int64_t total = 0;
+    for (auto lane : lanes) {
+        if (AddOverflow(total, lane, &total)) {
+            return false;
+        }
+    }
+    for (; i < size; ++i) {
+        if (AddOverflow(total, data[i], &total)) {
+            return false;
+        }
+    }
+    *res = total;
+    return true;
+}
+
+__attribute__((target("avx2"))) double Avx2SumFlonums(const double* data, size_t size) {
+    __m256d low = _mm256_setzero_pd();
+    __m256d high = _mm256_setzero_pd();
+    size_t blocks = size / kPartials * kPartials;
+    for (size_t i = 0; i < blocks; i += kPartials) {
+        low = _mm256_add_pd(low, _mm256_loadu_pd(data + i));
+        high = _mm256_add_pd(high, _mm256_loadu_pd(data + i + 4));
+    }
+    double partial[kPartials];
+    _mm256_storeu_pd(partial, low);
+    _mm256_storeu_pd(partial + 4, high);
+    return FinishPartials(partial, data, blocks, size, Add);
+}
+
+__attribute__((target("avx2"))) double Avx2DotFlonums(const double* lhs, const double* rhs,
+                                                      size_t size) {
+    __m256d low = _mm256_setzero_pd();
+    __m256d high = _mm256_setzero_pd();
+    size_t blocks = size / kPartials * kPartials;
+    for (size_t i = 0; i < blocks; i += kPartials) {
+        low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+        high = _mm256_add_pd(
+            high, _mm256_mul_pd(_mm256_loadu_pd(lhs + i + 4), _mm256_loadu_pd(rhs + i + 4)));
+    }
+    double partial[kPartials];
+    _mm256_storeu_pd(partial, low);
+    _mm256_storeu_pd(partial + 4, high);
+    double res = FinishPartials(partial, lhs, size, size, Add);
+    for (size_t i = blocks; i < size; ++i) {
+        res += lhs[i] * rhs[i];
+    }
+    return res;
+}
+
+__attribute__((target("avx2"))) bool Avx2AddFixnums(const int64_t* lhs, const int64_t* rhs,
+                                                    int64_t* res, size_t size) {
+    __m256i overflow = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        auto sum = WrappingAdd(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i)),
+                               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i)),
+                               &overflow);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i), sum);
+    }
+    return NoSignBit(overflow) && PortableAddFixnums(lhs + i, rhs + i, res + i, size - i);
+}
+
+__attribute__((target("avx2"))) void Avx2AddFlonums(const double* lhs, const double* rhs,
+                                                    double* res, size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm256_storeu_pd(res + i,
+                         _mm256_add_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+    }
+    PortableAddFlonums(lhs + i, rhs + i, res + i, size - i);
+}
+
+__attribute__((target("avx2"))) void Avx2MulFlonums(const double* lhs, const double* rhs,
+                                                    double* res, size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm256_storeu_pd(res + i,
+                         _mm256_mul_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+    }
+    PortableMulFlonums(lhs + i, rhs + i, res + i, size - i);
+}
+
+// lanes of the lesser or the greater values, there are no 64 bit min and max before AVX-512
+__attribute__((target("avx2"))) __m256i Avx2Extremum(__m256i lhs, __m256i rhs, bool max) {
+    __m256i greater = _mm256_cmpgt_epi64(lhs, rhs);
+    return max ? _mm256_blendv_epi8(rhs, lhs, greater) : _mm256_blendv_epi8(lhs, rhs, greater);
+}
+
+__attribute__((target("avx2"))) int64_t Avx2ExtremumFixnums(const int64_t* data, size_t size,
+                                                            bool max) {
+    __m256i acc = _mm256_set1_epi64x(data[0]);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        acc = Avx2Extremum(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)),
+                           max);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int64_t res = max ? *std::max_element(lanes, lanes + 4) : *std::min_element(lanes, lanes + 4);
+    for (; i < size; ++i) {
+        res = max ? std::max(res, data[i]) : std::min(res, data[i]);
+    }
+    return res;
+}
+
+// _mm256_min_pd(x, acc) is x < acc ? x : acc, which is std::min(acc, x)
+__attribute__((target("avx2"))) double Avx2ExtremumFlonums(const double* data, size_t size,
+                                                           bool max) {
+    double partial[kPartials];
+    size_t begin = SeedPartials(data, size, partial);
+    size_t blocks = size / kPartials * kPartials;
+    __m256d low = _mm256_loadu_pd(partial);
+    __m256d high = _mm256_loadu_pd(partial + 4);
+    __m256d nan = _mm256_setzero_pd();
+    for (size_t i = 0; i < blocks; i += kPartials) {
+        __m256d low_block = _mm256_loadu_pd(data + i);
+        __m256d high_block = _mm256_loadu_pd(data + i + 4);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(low_block, high_block, _CMP_UNORD_Q));
+        if (i >= begin) {
+            low = max ? _mm256_max_pd(low_block, low) : _mm256_min_pd(low_block, low);
+            high = max ? _mm256_max_pd(high_block, high) : _mm256_min_pd(high_block, high);
+        }
+    }
+    bool tail_nan = false;
+    for (size_t i = blocks; i < size; ++i) {
+        tail_nan |= data[i] != data[i];
+    }
+    if (_mm256_movemask_pd(nan) || tail_nan) {
+        return *std::find_if(data, data + size, [](double x) { return x != x; });
+    }
+    _mm256_storeu_pd(partial, low);
+    _mm256_storeu_pd(partial + 4, high);
+    return max ? FinishPartials(partial, data, std::max(begin, blocks), size, Greater)
+               : FinishPartials(partial, data, std::max(begin, blocks), size, Lesser);
+}
+
+__attribute__((target("avx2"))) void Avx2CompareFixnums(const int64_t* lhs, const int64_t* rhs,
+                                                        int64_t* res, size_t size,
+                                                        Comparison comparison) {
+    const __m256i one = _mm256_set1_epi64x(1);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        auto left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        auto right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        __m256i mask;
+        switch (comparison) {
+            case Comparison::kEqual:
+                mask = _mm256_and_si256(_mm256_cmpeq_epi64(left, right), one);
+                break;
+            case Comparison::kLess:
+                mask = _mm256_and_si256(_mm256_cmpgt_epi64(right, left), one);
+                break;
+            case Comparison::kGreater:
+                mask = _mm256_and_si256(_mm256_cmpgt_epi64(left, right), one);
+                break;
+            case Comparison::kLeq:
+                mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(left, right), one);
+                break;
+            default:
+                mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(right, left), one);
+                break;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i), mask);
+    }
+    PortableCompare(lhs + i, rhs + i, res + i, size - i, comparison);
+}
+
+// the ordered predicates, false for NaN like the comparisons of numbers
+template <int kPredicate>
+__attribute__((target("avx2"))) void Avx2CompareFlonums(const double* lhs, const double* rhs,
+                                                        int64_t* res, size_t size) {
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        __m256d mask =
+            _mm256_cmp_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i), kPredicate);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i),
+                            _mm256_and_si256(_mm256_castpd_si256(mask), one));
+    }
+}
+
+__attribute__((target("avx2"))) void Avx2CompareFlonums(const double* lhs, const double* rhs,
+                                                        int64_t* res, size_t size,
+                                                        Comparison comparison) {
+    switch (comparison) {
+        case Comparison::kEqual:
+            Avx2CompareFlonums<_CMP_EQ_OQ>(lhs, rhs, res, size);
+            break;
+        case Comparison::kLess:
+            Avx2CompareFlonums<_CMP_LT_OQ>(lhs, rhs, res, size);
+            break;
+        case Comparison::kGreater:
+            Avx2CompareFlonums<_CMP_GT_OQ>(lhs, rhs, res, size);
+            break;
+        case Comparison::kLeq:
+            Avx2CompareFlonums<_CMP_LE_OQ>(lhs, rhs, res, size);
+            break;
+        case Comparison::kGeq:
+            Avx2CompareFlonums<_CMP_GE_OQ>(lhs, rhs, res, size);
+            break;
+    }
+    size_t done = size / 4 * 4;
+    PortableCompare(lhs + done, rhs + done, res + done, size - done, comparison);
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// dispatch
+
+bool UseAvx2(bool enabled) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    avx2_enabled = enabled && HasAvx2();
+    return avx2_enabled;
+#else
+    (void)enabled;
+    return false;
+#endif
+}
+
+bool SumFixnums(const int64_t* data, size_t size, int64_t* res) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2SumFixnums(data, size, res);
+    }
+#endif
+    return PortableSumFixnums(data, size, res);
+}
+
+double SumFlonums(const double* data, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2SumFlonums(data, size);
+    }
+#endif
+    return PortableSumFlonums(data, size);
+}
+
+bool DotFixnums(const int64_t* lhs, const int64_t* rhs, size_t size, int64_t* res) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        int64_t product;
+        if (MulOverflow(lhs[i], rhs[i], &product) || AddOverflow(sum, product, &sum)) {
+            return false;
+        }
+    }
+    *res = sum;
+    return true;
+}
+
+double DotFlonums(const double* lhs, const double* rhs, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2DotFlonums(lhs, rhs, size);
+    }
+#endif
+    return PortableDotFlonums(lhs, rhs, size);
+}
+
+bool AddFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2AddFixnums(lhs, rhs, res, size);
+    }
+#endif
+    return PortableAddFixnums(lhs, rhs, res, size);
+}
+
+bool MulFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size) {
+    bool overflow = false;
+    for (size_t i = 0; i < size; ++i) {
+        overflow |= MulOverflow(lhs[i], rhs[i], res + i);
+    }
+    return !overflow;
+}
+
+void AddFlonums(const double* lhs, const double* rhs, double* res, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2AddFlonums(lhs, rhs, res, size);
+    }
+#endif
+    PortableAddFlonums(lhs, rhs, res, size);
+}
+
+void MulFlonums(const double* lhs, const double* rhs, double* res, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2MulFlonums(lhs, rhs, res, size);
+    }
+#endif
+    PortableMulFlonums(lhs, rhs, res, size);
+}
+
+int64_t MinFixnums(const int64_t* data, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2ExtremumFixnums(data, size, false);
+    }
+#endif
+    return *std::min_element(data, data + size);
+}
+
+int64_t MaxFixnums(const int64_t* data, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2ExtremumFixnums(data, size, true);
+    }
+#endif
+    return *std::max_element(data, data + size);
+}
+
+double MinFlonums(const double* data, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2ExtremumFlonums(data, size, false);
+    }
+#endif
+    return PortableExtremum(data, size, Lesser);
+}
+
+double MaxFlonums(const double* data, size_t size) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2ExtremumFlonums(data, size, true);
+    }
+#endif
+    return PortableExtremum(data, size, Greater);
+}
+
+void CompareFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size,
+                    Comparison comparison) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2CompareFixnums(lhs, rhs, res, size, comparison);
+    }
+#endif
+    PortableCompare(lhs, rhs, res, size, comparison);
+}
+
+void CompareFlonums(const double* lhs, const double* rhs, int64_t* res, size_t size,
+                    Comparison comparison) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (avx2_enabled) {
+        return Avx2CompareFlonums(lhs, rhs, res, size, comparison);
+    }
+#endif
+    PortableCompare(lhs, rhs, res, size, comparison);
+}
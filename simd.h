@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels over the unboxed storage of numeric vectors. On x86 the AVX2 versions are picked
+// at runtime if the processor has it, the portable ones are plain loops the compiler
+// vectorizes for the baseline. Both give the same results: flonum reductions keep the same
+// eight partial sums, and integer results are exact or reported as out of range.
+
+// which ones to use, returns whether AVX2 is used afterwards
+bool UseAvx2(bool enabled);
+
+// false if the result is out of the range of int64_t
+bool SumFixnums(const int64_t* data, size_t size, int64_t* res);
+double SumFlonums(const double* data, size_t size);
+
+// false if a product or the sum is out of the range of int64_t; there is no 64 bit lane
+// multiplication before AVX-512, so this one is always portable
+bool DotFixnums(const int64_t* lhs, const int64_t* rhs, size_t size, int64_t* res);
+double DotFlonums(const double* lhs, const double* rhs, size_t size);
+
+// element-wise, false if one of the results is out of the range of int64_t
+bool AddFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size);
+bool MulFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size);
+void AddFlonums(const double* lhs, const double* rhs, double* res, size_t size);
+void MulFlonums(const double* lhs, const double* rhs, double* res, size_t size);
+
+// of a non-empty array; NaN if one of the flonums is
+int64_t MinFixnums(const int64_t* data, size_t size);
+int64_t MaxFixnums(const int64_t* data, size_t size);
+double MinFlonums(const double* data, size_t size);
+double MaxFlonums(const double* data, size_t size);
+
+enum class Comparison { kEqual, kLess, kGreater, kLeq, kGeq };
+
+// masks of 1 where the comparison holds and 0 elsewhere, nothing holds for NaN
+void CompareFixnums(const int64_t* lhs, const int64_t* rhs, int64_t* res, size_t size,
+                    Comparison comparison);
+void CompareFlonums(const double* lhs, const double* rhs, int64_t* res, size_t size,
+                    Comparison comparison);
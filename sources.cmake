@@ -3,6 +3,13 @@ add_library(scheme_tidy
     parser.cpp
     scheme.cpp
     object.cpp
+    analyzer.cpp
+    jit.cpp
+    compile.cpp
+    optimizer.cpp
+    specialize.cpp
+    bignum.cpp
+    simd.cpp
     
     # maybe more .cpp files here
 )
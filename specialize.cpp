@@ -0,0 +1,767 @@
+#include "specialize.h"
+
+#include "scheme.h"
+#include "error.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// number expressions of the specialized body; they have no side effects, so the order in
+// which they are evaluated doesn't matter
+using Fixnum = std::function<int64_t(Scope*)>;
+using Real = std::function<double(Scope*)>;
+using Condition = std::function<bool(Scope*)>;
+
+// thrown by an integer expression whose result doesn't fit a Number; the expression is then
+// evaluated again by the generic code, which makes a BigNumber
+struct Overflow {};
+
+// op reports overflow like AddOverflow
+template <class Op>
+Fixnum Combine(const std::vector<Fixnum>& args, Op op) {
+    if (args.size() == 1) {
+        return args[0];
+    }
+    if (args.size() == 2) {
+        return [lhs = args[0], rhs = args[1], op](Scope* scope) {
+            int64_t res;
+            if (op(lhs(scope), rhs(scope), &res)) {
+                throw Overflow();
+            }
+            return res;
+        };
+    }
+    return [args, op](Scope* scope) {
+        int64_t res = args[0](scope);
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (op(res, args[i](scope), &res)) {
+                throw Overflow();
+            }
+        }
+        return res;
+    };
+}
+
+// like Div::Combine; a zero divisor counts as overflow too, the generic code raises the error
+bool DivOverflow(int64_t lhs, int64_t rhs, int64_t* res) {
+    if (!rhs || (lhs == INT64_MIN && rhs == -1)) {
+        return true;
+    }
+    *res = lhs / rhs;
+    return false;
+}
+
+Real ToReal(Fixnum fixnum) {
+    return [fixnum](Scope* scope) { return static_cast<double>(fixnum(scope)); };
+}
+
+// the arguments up to the first flonum are combined as integers, like Reduction does, the
+// rest as doubles; rest isn't empty
+template <class FixnumOp, class Op>
+Real CombineReal(const std::vector<Fixnum>& prefix, std::vector<Real> rest, FixnumOp fixnum_op,
+                 Op op) {
+    if (!prefix.empty()) {
+        rest.insert(rest.begin(), ToReal(Combine(prefix, fixnum_op)));
+    }
+    if (rest.size() == 1) {
+        return rest[0];
+    }
+    if (rest.size() == 2) {
+        return [lhs = rest[0], rhs = rest[1], op](Scope* scope) {
+            return op(lhs(scope), rhs(scope));
+        };
+    }
+    return [rest, op](Scope* scope) {
+        double res = rest[0](scope);
+        for (size_t i = 1; i < rest.size(); ++i) {
+            res = op(res, rest[i](scope));
+        }
+        return res;
+    };
+}
+
+template <class T, class Op>
+Condition Chain(const std::vector<std::function<T(Scope*)>>& args, Op op) {
+    if (args.size() == 2) {
+        return [lhs = args[0], rhs = args[1], op](Scope* scope) {
+            return op(lhs(scope), rhs(scope));
+        };
+    }
+    return [args, op](Scope* scope) {
+        std::vector<T> values;
+        for (auto& arg : args) {
+            values.push_back(arg(scope));
+        }
+        for (size_t i = 1; i < values.size(); ++i) {
+            if (!op(values[i - 1], values[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+}
+
+// the relation the comparison builtin func checks between neighbouring arguments
+template <class T>
+Condition Relation(Node func, const std::vector<std::function<T(Scope*)>>& args) {
+    if (Is<IsEqual>(func)) {
+        return Chain(args, std::equal_to<>());
+    }
+    if (Is<IsSmaller>(func)) {
+        return Chain(args, std::less<>());
+    }
+    if (Is<IsGreater>(func)) {
+        return Chain(args, std::greater<>());
+    }
+    if (Is<IsLeq>(func)) {
+        return Chain(args, std::less_equal<>());
+    }
+    return Chain(args, std::greater_equal<>());
+}
+
+class Specializer {
+public:
+    // kinds are what the parameters are assumed to be
+    Specializer(Scope* scope, ConstructLambda* code, std::vector<NumberKind> kinds)
+        : scope_(scope),
+          code_(code),
+          kinds_(std::move(kinds)),
+          numeric_(code->GetArity(), true),
+          used_(code->GetArity()),
+          operands_(code->GetArity()) {
+    }
+
+    // false if nothing in the body could be specialized
+    bool Build(SpecializedBody* res);
+
+    // parameters passed to arithmetic, known after Build
+    std::vector<size_t> GetOperands() const {
+        std::vector<size_t> res;
+        for (size_t i = 0; i < operands_.size(); ++i) {
+            if (operands_[i]) {
+                res.push_back(i);
+            }
+        }
+        return res;
+    }
+
+    const std::vector<std::pair<const uint64_t*, uint64_t>>& GetDependencies() const {
+        return dependencies_;
+    }
+
+    // calls visit on the subexpressions of root
+    template <class F>
+    static void ForEachChild(Node root, F visit);
+
+private:
+    void Depend(const std::string& name) {
+        const uint64_t* epoch = scope_->GetEpoch(name);
+        for (auto& dependency : dependencies_) {
+            if (dependency.first == epoch) {
+                return;
+            }
+        }
+        dependencies_.emplace_back(epoch, *epoch);
+    }
+
+    bool IsParameter(LocalVariable* var) const {
+        return !var->captured_ && !var->boxed_ && var->index_ < numeric_.size() &&
+               numeric_[var->index_];
+    }
+
+    void FindAssigned(Node root);
+    void FindOperands(Node root);
+    Node Callee(Node root);
+    bool Arguments(Node root, std::vector<Fixnum>* args);
+    bool KindOf(Node root, NumberKind* kind);
+    bool CompileFixnum(Node root, Fixnum* res);
+    bool CompileReal(Node root, Real* res);
+    Real MakeReal(Node root);
+    bool CompileCondition(Node root, Condition* res);
+    Compiled CompileGeneric(Node root);
+
+    Scope* scope_;
+    ConstructLambda* code_;
+    std::vector<NumberKind> kinds_;
+    // parameters that are never assigned
+    std::vector<bool> numeric_;
+    // parameters the body reads as numbers, the only ones checked on entry
+    std::vector<bool> used_;
+    std::vector<bool> operands_;
+    std::vector<std::pair<const uint64_t*, uint64_t>> dependencies_;
+    bool specialized_ = false;
+    bool flonum_ = false;
+};
+
+template <class F>
+void Specializer::ForEachChild(Node root, F visit) {
+    if (auto form = As<LocalAssignment>(root)) {
+        visit(form->value_);
+    } else if (auto form = As<If>(root)) {
+        visit(form->condition_);
+        visit(form->then_branch_);
+        visit(form->else_branch_);
+    } else if (auto form = As<Define>(root)) {
+        visit(form->value_);
+    } else if (auto form = As<Set>(root)) {
+        visit(form->value_);
+    } else if (auto form = As<And>(root)) {
+        for (auto arg : form->args_) {
+            visit(arg);
+        }
+    } else if (auto form = As<Or>(root)) {
+        for (auto arg : form->args_) {
+            visit(arg);
+        }
+    } else if (auto guard = As<Guard>(root)) {
+        visit(guard->optimized_);
+        visit(guard->original_);
+    } else if (auto form = As<ConstructLambda>(root)) {
+        visit(form->body_);
+    } else if (Is<Cell>(root)) {
+        visit(GetFirst(root));
+        visit(GetSecond(root));
+    }
+}
+
+// parameters that may be given another value in the body aren't known to stay numbers;
+// nested lambdas assign them only through boxes, which aren't numeric anyway
+void Specializer::FindAssigned(Node root) {
+    if (auto form = As<LocalAssignment>(root)) {
+        if (!form->captured_ && form->index_ < numeric_.size()) {
+            numeric_[form->index_] = false;
+        }
+    }
+    if (!Is<ConstructLambda>(root)) {
+        ForEachChild(root, [this](Node child) { FindAssigned(child); });
+    }
+}
+
+void Specializer::FindOperands(Node root) {
+    if (Is<Cell>(root)) {
+        Node func = Callee(root);
+        bool numeric = Is<Arithmetic>(func) || Is<Abs>(func) || Is<IsEqual>(func) ||
+                       Is<IsSmaller>(func) || Is<IsGreater>(func) || Is<IsLeq>(func) ||
+                       Is<IsGeq>(func);
+        for (Node cur = root; Is<Cell>(cur); cur = GetSecond(cur)) {
+            // the compiled argument may be a parameter the optimizer left behind a guard
+            Node arg = GetFirst(cur);
+            while (auto guard = As<Guard>(arg)) {
+                arg = guard->optimized_;
+            }
+            auto var = As<LocalVariable>(arg);
+            if (numeric && cur != root && var && IsParameter(var)) {
+                operands_[var->index_] = true;
+            }
+            FindOperands(GetFirst(cur));
+        }
+        return;
+    }
+    if (!Is<ConstructLambda>(root)) {
+        ForEachChild(root, [this](Node child) { FindOperands(child); });
+    }
+}
+
+// current value of the global a call applies
+Node Specializer::Callee(Node root) {
+    if (!Is<Symbol>(GetFirst(root))) {
+        return nullptr;
+    }
+    Node* slot = scope_->Lookup(GetName(GetFirst(root)));
+    if (!slot) {
+        return nullptr;
+    }
+    return *slot;
+}
+
+// parameters only need checking if the call gets specialized
+bool Specializer::Arguments(Node root, std::vector<Fixnum>* args) {
+    auto used = used_;
+    for (; Is<Cell>(root); root = GetSecond(root)) {
+        Fixnum arg;
+        if (!CompileFixnum(GetFirst(root), &arg)) {
+            used_ = used;
+            return false;
+        }
+        args->push_back(arg);
+    }
+    if (root) {
+        used_ = used;
+    }
+    return !root;
+}
+
+// what root evaluates to in the specialized body, false if it can't be compiled there
+bool Specializer::KindOf(Node root, NumberKind* kind) {
+    if (Is<Number>(root)) {
+        *kind = NumberKind::kFixnum;
+        return true;
+    }
+    if (Is<Flonum>(root)) {
+        *kind = NumberKind::kFlonum;
+        return true;
+    }
+    if (auto var = As<LocalVariable>(root)) {
+        if (!IsParameter(var)) {
+            return false;
+        }
+        *kind = kinds_[var->index_];
+        return true;
+    }
+    if (auto guard = As<Guard>(root)) {
+        return guard->Holds() && KindOf(guard->optimized_, kind);
+    }
+    if (!Is<Cell>(root)) {
+        return false;
+    }
+    Node func = Callee(root);
+    if (!Is<Arithmetic>(func) && !Is<Abs>(func)) {
+        return false;
+    }
+    size_t count = 0;
+    bool flonum = false;
+    Node cur = GetSecond(root);
+    for (; Is<Cell>(cur); cur = GetSecond(cur), ++count) {
+        NumberKind arg;
+        if (!KindOf(GetFirst(cur), &arg)) {
+            return false;
+        }
+        flonum |= arg == NumberKind::kFlonum;
+    }
+    if (cur || (!count && !Is<Plus>(func) && !Is<Mult>(func)) || (Is<Abs>(func) && count != 1)) {
+        return false;
+    }
+    *kind = flonum ? NumberKind::kFlonum : NumberKind::kFixnum;
+    return true;
+}
+
+bool Specializer::CompileFixnum(Node root, Fixnum* res) {
+    if (auto number = As<Number>(root)) {
+        int64_t value = number->GetValue();
+        *res = [value](Scope*) { return value; };
+        return true;
+    }
+    if (auto var = As<LocalVariable>(root)) {
+        size_t index = var->index_;
+        if (!IsParameter(var) || kinds_[index] != NumberKind::kFixnum) {
+            return false;
+        }
+        used_[index] = true;
+        *res = [index](Scope* scope) -> int64_t {
+            return static_cast<Number*>(scope->GetFrame()->slots[index])->GetValue();
+        };
+        return true;
+    }
+    if (auto guard = As<Guard>(root)) {
+        if (!guard->Holds() || !CompileFixnum(guard->optimized_, res)) {
+            return false;
+        }
+        for (auto [epoch, expected] : guard->dependencies_) {
+            dependencies_.emplace_back(epoch, expected);
+        }
+        return true;
+    }
+    if (!Is<Cell>(root)) {
+        return false;
+    }
+
+    Node func = Callee(root);
+    bool arithmetic = Is<Arithmetic>(func) || Is<Abs>(func);
+    std::vector<Fixnum> args;
+    if (!arithmetic || !Arguments(GetSecond(root), &args)) {
+        return false;
+    }
+    if (Is<Plus>(func) || Is<Mult>(func)) {
+        if (args.empty()) {
+            int64_t neutral = Is<Plus>(func);
+            *res = [neutral](Scope*) { return neutral; };
+        } else if (Is<Plus>(func)) {
+            *res = Combine(args, AddOverflow);
+        } else {
+            *res = Combine(args, MulOverflow);
+        }
+    } else if (Is<Minus>(func) && !args.empty()) {
+        *res = Combine(args, SubOverflow);
+    } else if (Is<Div>(func) && !args.empty()) {
+        *res = Combine(args, DivOverflow);
+    } else if (Is<Max>(func) && !args.empty()) {
+        *res = Combine(args, [](int64_t lhs, int64_t rhs, int64_t* res) {
+            *res = std::max(lhs, rhs);
+            return false;
+        });
+    } else if (Is<Min>(func) && !args.empty()) {
+        *res = Combine(args, [](int64_t lhs, int64_t rhs, int64_t* res) {
+            *res = std::min(lhs, rhs);
+            return false;
+        });
+    } else if (Is<Abs>(func) && args.size() == 1) {
+        *res = [arg = args[0]](Scope* scope) {
+            int64_t value = arg(scope);
+            if (value == INT64_MIN) {
+                throw Overflow();
+            }
+            return std::abs(value);
+        };
+    } else {
+        return false;
+    }
+    Depend(GetName(GetFirst(root)));
+    specialized_ = true;
+    return true;
+}
+
+// flonum expressions, integer parts of them are computed as integers first
+bool Specializer::CompileReal(Node root, Real* res) {
+    NumberKind kind;
+    if (!KindOf(root, &kind) || kind != NumberKind::kFlonum) {
+        return false;
+    }
+    *res = MakeReal(root);
+    flonum_ = true;
+    specialized_ = true;
+    return true;
+}
+
+// root is a number expression of either kind, see KindOf
+Real Specializer::MakeReal(Node root) {
+    NumberKind kind;
+    KindOf(root, &kind);
+    if (kind == NumberKind::kFixnum) {
+        Fixnum fixnum;
+        CompileFixnum(root, &fixnum);
+        return ToReal(fixnum);
+    }
+    if (auto number = As<Flonum>(root)) {
+        double value = number->GetValue();
+        return [value](Scope*) { return value; };
+    }
+    if (auto var = As<LocalVariable>(root)) {
+        size_t index = var->index_;
+        used_[index] = true;
+        return [index](Scope* scope) {
+            return static_cast<Flonum*>(scope->GetFrame()->slots[index])->GetValue();
+        };
+    }
+    if (auto guard = As<Guard>(root)) {
+        for (auto [epoch, expected] : guard->dependencies_) {
+            dependencies_.emplace_back(epoch, expected);
+        }
+        return MakeReal(guard->optimized_);
+    }
+
+    Node func = Callee(root);
+    std::vector<Fixnum> prefix;
+    std::vector<Real> rest;
+    for (Node cur = GetSecond(root); cur; cur = GetSecond(cur)) {
+        NumberKind arg;
+        KindOf(GetFirst(cur), &arg);
+        if (rest.empty() && arg == NumberKind::kFixnum) {
+            prefix.emplace_back();
+            CompileFixnum(GetFirst(cur), &prefix.back());
+        } else {
+            rest.push_back(MakeReal(GetFirst(cur)));
+        }
+    }
+    Depend(GetName(GetFirst(root)));
+    if (Is<Abs>(func)) {
+        return [arg = rest[0]](Scope* scope) { return std::fabs(arg(scope)); };
+    }
+    if (Is<Plus>(func)) {
+        return CombineReal(prefix, rest, AddOverflow, std::plus<>());
+    }
+    if (Is<Minus>(func)) {
+        return CombineReal(prefix, rest, SubOverflow, std::minus<>());
+    }
+    if (Is<Mult>(func)) {
+        return CombineReal(prefix, rest, MulOverflow, std::multiplies<>());
+    }
+    if (Is<Div>(func)) {
+        return CombineReal(prefix, rest, DivOverflow, std::divides<>());
+    }
+    if (Is<Max>(func)) {
+        return CombineReal(
+            prefix, rest,
+            [](int64_t lhs, int64_t rhs, int64_t* res) {
+                *res = std::max(lhs, rhs);
+                return false;
+            },
+            [](double lhs, double rhs) { return std::max(lhs, rhs); });
+    }
+    return CombineReal(
+        prefix, rest,
+        [](int64_t lhs, int64_t rhs, int64_t* res) {
+            *res = std::min(lhs, rhs);
+            return false;
+        },
+        [](double lhs, double rhs) { return std::min(lhs, rhs); });
+}
+
+bool Specializer::CompileCondition(Node root, Condition* res) {
+    if (!Is<Cell>(root)) {
+        return false;
+    }
+    Node func = Callee(root);
+    bool comparison = Is<IsEqual>(func) || Is<IsSmaller>(func) || Is<IsGreater>(func) ||
+                      Is<IsLeq>(func) || Is<IsGeq>(func);
+    if (!comparison) {
+        return false;
+    }
+    std::vector<NumberKind> kinds;
+    Node cur = GetSecond(root);
+    for (; Is<Cell>(cur); cur = GetSecond(cur)) {
+        kinds.emplace_back();
+        if (!KindOf(GetFirst(cur), &kinds.back())) {
+            return false;
+        }
+    }
+    // fewer arguments are always true
+    if (cur || kinds.size() < 2) {
+        return false;
+    }
+    if (std::count(kinds.begin(), kinds.end(), NumberKind::kFlonum)) {
+        // the generic code compares two integers exactly, not as doubles
+        for (size_t i = 1; i < kinds.size(); ++i) {
+            if (kinds[i - 1] == NumberKind::kFixnum && kinds[i] == NumberKind::kFixnum) {
+                return false;
+            }
+        }
+        std::vector<Real> args;
+        for (cur = GetSecond(root); cur; cur = GetSecond(cur)) {
+            args.push_back(MakeReal(GetFirst(cur)));
+        }
+        *res = Relation(func, args);
+        flonum_ = true;
+    } else {
+        std::vector<Fixnum> args;
+        Arguments(GetSecond(root), &args);
+        *res = Relation(func, args);
+    }
+    Depend(GetName(GetFirst(root)));
+    // the result is whatever #t and #f are bound to
+    Depend("#t");
+    Depend("#f");
+    specialized_ = true;
+    return true;
+}
+
+Compiled Specializer::CompileGeneric(Node root) {
+    Fixnum fixnum;
+    Condition condition;
+    Real real;
+    bool constant = IsNumeric(root) || Is<LocalVariable>(root);
+    if (!constant && CompileFixnum(root, &fixnum)) {
+        return [fixnum, generic = Compile(root)](Scope* scope) -> Node {
+            try {
+                return Heap::GetInstance().Make<Number>(fixnum(scope));
+            } catch (Overflow&) {
+                return generic(scope);
+            }
+        };
+    }
+    if (!constant && CompileReal(root, &real)) {
+        return [real, generic = Compile(root)](Scope* scope) -> Node {
+            try {
+                return Heap::GetInstance().Make<Flonum>(real(scope));
+            } catch (Overflow&) {
+                return generic(scope);
+            }
+        };
+    }
+    if (CompileCondition(root, &condition)) {
+        return [condition, generic = Compile(root)](Scope* scope) {
+            try {
+                return Bool(scope, condition(scope));
+            } catch (Overflow&) {
+                return generic(scope);
+            }
+        };
+    }
+
+    if (auto form = As<If>(root)) {
+        Compiled then_branch = CompileGeneric(form->then_branch_);
+        Compiled else_branch = form->has_else_ ? CompileGeneric(form->else_branch_)
+                                               : [](Scope*) -> Node { return nullptr; };
+        if (CompileCondition(form->condition_, &condition)) {
+            return [condition, generic = Compile(form->condition_), then_branch,
+                    else_branch](Scope* scope) {
+                bool holds;
+                try {
+                    holds = condition(scope);
+                } catch (Overflow&) {
+                    holds = IsTrue(generic(scope));
+                }
+                return holds ? then_branch(scope) : else_branch(scope);
+            };
+        }
+        Compiled test = CompileGeneric(form->condition_);
+        return [test, then_branch, else_branch](Scope* scope) {
+            return IsTrue(test(scope)) ? then_branch(scope) : else_branch(scope);
+        };
+    }
+    if (auto guard = As<Guard>(root)) {
+        if (!guard->Holds()) {
+            return Compile(root);
+        }
+        for (auto [epoch, expected] : guard->dependencies_) {
+            dependencies_.emplace_back(epoch, expected);
+        }
+        return CompileGeneric(guard->optimized_);
+    }
+    if (!Is<Cell>(root)) {
+        return Compile(root);
+    }
+
+    // calls of anything else still get their arguments specialized
+    std::vector<Compiled> args;
+    Node syntax = GetSecond(root);
+    for (Node cur = syntax; cur; cur = GetSecond(cur)) {
+        if (!Is<Cell>(cur)) {
+            return Compile(root);
+        }
+        Node arg = GetFirst(cur);
+        // (f a . 'b) and () arguments are special cased by ParseArguments
+        if (!arg || (Is<Symbol>(arg) && GetName(arg) == "quote")) {
+            return Compile(root);
+        }
+        args.push_back(CompileGeneric(arg));
+    }
+    return [head = Compile(GetFirst(root)), args, syntax](Scope* scope) {
+        Node func = head(scope);
+        if (!func) {
+            throw RuntimeError("Object not callable");
+        }
+        return func->Invoke(scope, args, syntax);
+    };
+}
+
+bool Specializer::Build(SpecializedBody* res) {
+    for (auto index : code_->GetBoxed()) {
+        if (index < numeric_.size()) {
+            numeric_[index] = false;
+        }
+    }
+    for (Node cur = code_->GetBody(); cur; cur = GetSecond(cur)) {
+        FindAssigned(GetFirst(cur));
+    }
+    for (Node cur = code_->GetBody(); cur; cur = GetSecond(cur)) {
+        FindOperands(GetFirst(cur));
+    }
+
+    std::vector<Compiled> body;
+    for (Node cur = code_->GetBody(); cur; cur = GetSecond(cur)) {
+        body.push_back(CompileGeneric(GetFirst(cur)));
+    }
+    if (!specialized_) {
+        return false;
+    }
+    res->numeric.clear();
+    for (size_t i = 0; i < used_.size(); ++i) {
+        if (used_[i]) {
+            res->numeric.emplace_back(i, kinds_[i]);
+        }
+    }
+    res->flonum = flonum_;
+    res->body = std::move(body);
+    return true;
+}
+
+void AddDependencies(Specialization* specialization, const Specializer& specializer) {
+    auto& dependencies = specialization->dependencies;
+    for (auto dependency : specializer.GetDependencies()) {
+        if (std::find(dependencies.begin(), dependencies.end(), dependency) ==
+            dependencies.end()) {
+            dependencies.push_back(dependency);
+        }
+    }
+}
+
+void Specialize(Scope* scope, Node root) {
+    if (auto code = As<ConstructLambda>(root)) {
+        Specializer specializer(scope, code,
+                                std::vector<NumberKind>(code->GetArity(), NumberKind::kFixnum));
+        auto& specialization = code->GetSpecialization();
+        specialization = Specialization();
+        SpecializedBody body;
+        if (specializer.Build(&body)) {
+            specialization.bodies.push_back(std::move(body));
+            ++scope->GetTierStats().specializations;
+        }
+        specialization.operands = specializer.GetOperands();
+        specialization.active = !specialization.bodies.empty() || !specialization.operands.empty();
+        AddDependencies(&specialization, specializer);
+    }
+    Specializer::ForEachChild(root, [scope](Node child) { Specialize(scope, child); });
+}
+
+// calls with other arguments after which the lambda keeps to the generic body
+constexpr size_t kMaxFallbacks = 64;
+
+// flonum bodies a lambda gets at most, it keeps to the others after that
+constexpr size_t kMaxAttempts = 4;
+
+bool Fits(const SpecializedBody& body, Node* args) {
+    for (auto [index, kind] : body.numeric) {
+        if (kind == NumberKind::kFixnum ? !Is<Number>(args[index]) : !Is<Flonum>(args[index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a body for the kinds of numbers the operands are if there is a flonum among them
+const SpecializedBody* SpecializeFlonums(Scope* scope, ConstructLambda* code, Node* args) {
+    auto& specialization = code->GetSpecialization();
+    if (specialization.attempts == kMaxAttempts) {
+        return nullptr;
+    }
+    std::vector<NumberKind> kinds(code->GetArity(), NumberKind::kFixnum);
+    bool flonum = false;
+    for (auto index : specialization.operands) {
+        if (Is<Flonum>(args[index])) {
+            kinds[index] = NumberKind::kFlonum;
+            flonum = true;
+        } else if (!Is<Number>(args[index])) {
+            return nullptr;
+        }
+    }
+    if (!flonum) {
+        return nullptr;
+    }
+    ++specialization.attempts;
+    Specializer specializer(scope, code, kinds);
+    SpecializedBody body;
+    // the body may read parameters that aren't operands as numbers too
+    if (!specializer.Build(&body) || !Fits(body, args)) {
+        return nullptr;
+    }
+    ++scope->GetTierStats().specializations;
+    AddDependencies(&specialization, specializer);
+    specialization.bodies.push_back(std::move(body));
+    return &specialization.bodies.back();
+}
+
+const SpecializedBody* GetSpecialized(Scope* scope, ConstructLambda* code, Node* args) {
+    auto& specialization = code->GetSpecialization();
+    if (!specialization.active) {
+        return nullptr;
+    }
+    for (auto [epoch, expected] : specialization.dependencies) {
+        if (*epoch != expected) {
+            specialization.active = false;
+            return nullptr;
+        }
+    }
+    for (auto& body : specialization.bodies) {
+        if (Fits(body, args)) {
+            return &body;
+        }
+    }
+    if (auto body = SpecializeFlonums(scope, code, args)) {
+        return body;
+    }
+    if (++specialization.fallbacks == kMaxFallbacks) {
+        specialization.active = false;
+    }
+    return nullptr;
+}
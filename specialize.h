@@ -0,0 +1,18 @@
+#pragma once
+
+#include "object.h"
+
+// Every lambda expression gets a second body which assumes that the parameters it uses in
+// arithmetic and comparisons are numbers. There, those operations work on plain integers,
+// without argument vectors or type checks per operation. Calls check the parameters once and
+// run the generic body if one of them is something else.
+//
+// The first call passing flonums to arithmetic gets another body for those parameters, in
+// which the flonum expressions are computed on plain doubles; only their results are boxed.
+
+// compiles the integer bodies of the lambda expressions in root using the current builtins
+void Specialize(Scope* scope, Node root);
+
+// the body of code the arguments of the call fit, made for them if they are flonums;
+// nullptr if there is none or the builtins it was compiled against changed
+const SpecializedBody* GetSpecialized(Scope* scope, ConstructLambda* code, Node* args);
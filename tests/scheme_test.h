@@ -6,8 +6,21 @@
 #include <scheme.h>
 #include <allocations_checker.h>
 
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
 class SchemeTest {
 public:
+    SchemeTest() {
+#ifdef SCHEME_TEST_JIT_THRESHOLD
+        interpreter_.SetJit(true, SCHEME_TEST_JIT_THRESHOLD);
+#else
+        interpreter_.SetJit(false);
+#endif
+    }
+
     void ExpectEq(std::string expression, const std::string& result) {
         REQUIRE(interpreter_.Run(expression) == result);
     }
@@ -28,6 +41,47 @@ public:
         REQUIRE_THROWS_AS(interpreter_.Run(expression), NameError);
     }
 
+    void SetJit(bool enabled, size_t threshold) {
+        interpreter_.SetJit(enabled, threshold);
+    }
+
+    const TierStats& GetTierStats() const {
+        return interpreter_.GetTierStats();
+    }
+
+    const MemoStats& GetMemoStats() const {
+        return interpreter_.GetMemoStats();
+    }
+
+    void SetMemoCapacity(size_t capacity) {
+        interpreter_.SetMemoCapacity(capacity);
+    }
+
+    AllocationStats GetAllocationStats() const {
+        return interpreter_.GetAllocationStats();
+    }
+
+    // for the hidden [.benchmark] cases: prints the best time of a few runs of expression
+    // after label, or after the expression itself; setup runs untimed before each run
+    void Benchmark(const std::string& expression, const std::string& label = "",
+                   const std::vector<std::string>& setup = {}) {
+        constexpr int kRuns = 5;
+        double best = 0;
+        for (int run = 0; run < kRuns; ++run) {
+            for (auto& step : setup) {
+                ExpectNoError(step);
+            }
+            auto start = std::chrono::steady_clock::now();
+            ExpectNoError(expression);
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            if (!run || elapsed.count() < best) {
+                best = elapsed.count();
+            }
+        }
+        std::cerr << (label.empty() ? expression : label) << ": " << best << " ms\n";
+    }
+
 private:
     Interpreter interpreter_;
 };
@@ -0,0 +1,49 @@
+#include "scheme_test.h"
+
+#include <string>
+
+// n-ary arithmetic folds its arguments into an integer and only makes the result
+
+TEST_CASE_METHOD(SchemeTest, "NaryArithmeticAllocations") {
+    // pairs keep the bodies off the integer path of specialize.h and out of the optimizer
+    ExpectNoError("(define p '(7 6 5 4 3))");
+    ExpectNoError("(define (first p) (car p))");
+    for (std::string op : {"+", "-", "*", "/", "max", "min"}) {
+        ExpectNoError("(define (f p) (" + op +
+                      " (car p) (car (cdr p)) (car (cdr (cdr p))) (car (cdr (cdr (cdr p)))) "
+                      "(car (cdr (cdr (cdr (cdr p)))))))");
+        auto before = GetAllocationStats().heap;
+        ExpectNoError("(f p)");
+        auto reduced = GetAllocationStats().heap - before;
+
+        // the same call without arithmetic
+        before = GetAllocationStats().heap;
+        ExpectNoError("(first p)");
+        REQUIRE(reduced - (GetAllocationStats().heap - before) == 1);
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "NaryArithmeticValues") {
+    ExpectNoError("(define (f a b c d e) (list (+ a b c d e) (- a b c d e) (* a b c d e)))");
+    ExpectEq("(f 7 6 5 4 3)", "(25 -11 2520)");
+    ExpectNoError("(define (g a b c) (list (/ a b c) (max a b c) (min a b c) (+ a) (- a) (+) (*)))");
+    ExpectEq("(g 100 5 2)", "(10 100 2 100 100 0 1)");
+
+    // every argument is evaluated before the type error is raised
+    ExpectNoError("(define (h x) (+ x 'a undefined))");
+    ExpectNameError("(h 1)");
+    ExpectRuntimeError("(+ 1 'a 2)");
+    ExpectRuntimeError("(-)");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "NaryArithmeticBenchmark", "[.benchmark]") {
+    // pairs keep the body off the integer path of specialize.h
+    ExpectNoError(
+        "(define (f p) (+ (* (car p) (cdr p) 3) (- (car p) (cdr p) 1) (max (car p) (cdr p) 4) "
+        "(min (car p) 2 (cdr p))))");
+    ExpectNoError(
+        "(define (loop n acc) (if (= n 0) acc (loop (- n 1) (+ acc (f (cons n 3))))))");
+
+    Benchmark("(loop 10000 0)", "10000 calls of 4 n-ary operations");
+}
@@ -0,0 +1,80 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "FixnumRange") {
+    ExpectEq("9223372036854775807", "9223372036854775807");
+    ExpectEq("-9223372036854775808", "-9223372036854775808");
+    ExpectEq("(* 65536 65536)", "4294967296");
+    ExpectEq("(- 4294967296 1)", "4294967295");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FixnumOverflow") {
+    ExpectEq("(+ 9223372036854775807 1)", "9223372036854775808");
+    ExpectEq("(- -9223372036854775808 1)", "-9223372036854775809");
+    ExpectEq("(* 9223372036854775808 3)", "27670116110564327424");
+    ExpectEq("(* 4294967296 4294967296)", "18446744073709551616");
+    ExpectEq("(/ -9223372036854775808 -1)", "9223372036854775808");
+    ExpectEq("(abs -9223372036854775808)", "9223372036854775808");
+
+    // results that fit again are fixnums
+    ExpectEq("(- (+ 9223372036854775807 1) 1)", "9223372036854775807");
+    ExpectEq("(= (- (+ 9223372036854775807 1) 1) 9223372036854775807)", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "BignumLiterals") {
+    ExpectEq("123456789012345678901234567890", "123456789012345678901234567890");
+    ExpectEq("-123456789012345678901234567890", "-123456789012345678901234567890");
+    ExpectEq("'(100000000000000000000 1)", "(100000000000000000000 1)");
+    ExpectEq("(+ 100000000000000000000 -100000000000000000000)", "0");
+    ExpectEq("(number? 100000000000000000000)", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "BignumArithmetic") {
+    ExpectEq("(/ 100000000000000000000000 7)", "14285714285714285714285");
+    ExpectEq("(/ -100000000000000000000000 7)", "-14285714285714285714285");
+    ExpectEq("(/ 100000000000000000000000 100000000000000000000)", "1000");
+    ExpectEq("(/ 7 100000000000000000000)", "0");
+    ExpectEq("(max 1 100000000000000000000 -100000000000000000000)", "100000000000000000000");
+    ExpectEq("(min 1 100000000000000000000 -100000000000000000000)", "-100000000000000000000");
+    ExpectEq("(abs -100000000000000000000)", "100000000000000000000");
+
+    ExpectEq("(< 9223372036854775807 9223372036854775808)", "#t");
+    ExpectEq("(> -9223372036854775809 -9223372036854775808)", "#f");
+    ExpectEq("(= 100000000000000000000 100000000000000000000)", "#t");
+    ExpectEq("(<= 1 100000000000000000000 100000000000000000001)", "#t");
+
+    ExpectRuntimeError("(/ 1 0)");
+    ExpectNoError("(define (f) (/ 1 0))");
+    ExpectRuntimeError("(f)");
+    ExpectRuntimeError("(/ 100000000000000000000 0)");
+    ExpectRuntimeError("(+ 100000000000000000000 'a)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "BignumFunctions") {
+    ExpectNoError("(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))");
+    ExpectEq("(fact 30)", "265252859812191058636308480000000");
+    ExpectEq("(/ (fact 30) (fact 28))", "870");
+
+    // operands of thousands of bits are multiplied by Karatsuba
+    ExpectNoError("(define (pow b e) (if (= e 0) 1 (* b (pow b (- e 1)))))");
+    ExpectNoError("(define a (pow 3 1000))");
+    ExpectEq("(= (* a a) (pow 9 1000))", "#t");
+    ExpectEq("(- (* (+ a 1) (- a 1)) (* a a))", "-1");
+    ExpectEq("(= (/ (* a (pow 7 500)) a) (pow 7 500))", "#t");
+    ExpectEq("(= (/ (- (* a a) 1) (- a 1)) (+ a 1))", "#t");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "BignumBenchmark", "[.benchmark]") {
+    ExpectNoError("(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))");
+    ExpectNoError("(define (square x) (* x x))");
+    ExpectNoError(
+        "(define (pow b e) (if (= e 0) 1 (if (= e (* 2 (/ e 2))) (square (pow b (/ e 2))) "
+        "(* b (pow b (- e 1))))))");
+
+    // about 2600 and 9600 digits, without printing them
+    for (std::string expression : {"(number? (fact 1000))", "(number? (pow 3 20000))"}) {
+        Benchmark(expression);
+    }
+}
@@ -21,3 +21,13 @@ TEST_CASE_METHOD(SchemeTest, "IfSyntax") {
     ExpectSyntaxError("(if)");
     ExpectSyntaxError("(if 1 2 3 4)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "SyntaxCheckedBeforeEvaluation") {
+    ExpectNoError("(define x 1)");
+
+    ExpectSyntaxError("(if #f (lambda))");
+    ExpectSyntaxError("(and (set! x 2) (if))");
+    ExpectEq("x", "1");
+
+    ExpectEq("'(if define)", "(if define)");
+}
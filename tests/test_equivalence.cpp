@@ -0,0 +1,128 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "EqIsIdentity") {
+    // symbols with the same name are the same object
+    ExpectEq("(eq? 'a 'a)", "#t");
+    ExpectEq("(eq? (string->symbol \"ab\") 'ab)", "#t");
+    ExpectEq("(eq? (car '(x y)) (car (cdr '(y x))))", "#t");
+    ExpectEq("(eq? 'a 'b)", "#f");
+    ExpectEq("(eq? '() '())", "#t");
+    ExpectEq("(eq? #t (= 1 1))", "#t");
+    ExpectEq("(eq? car car)", "#t");
+
+    ExpectNoError("(define l '(1 2))");
+    ExpectEq("(eq? l l)", "#t");
+    ExpectEq("(eq? l '(1 2))", "#f");
+    ExpectEq("(eq? (cdr l) (cdr l))", "#t");
+    ExpectEq("(eq? \"ab\" \"ab\")", "#f");
+    ExpectRuntimeError("(eq? 'a)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EqvComparesNumbers") {
+    ExpectEq("(eqv? 2 (+ 1 1))", "#t");
+    ExpectEq("(eqv? 100000000000000000000 (* 10000000000 10000000000))", "#t");
+    ExpectEq("(eqv? 1.5 (/ 3.0 2))", "#t");
+    ExpectEq("(eqv? 1 1.0)", "#f");
+    ExpectEq("(eqv? 0.0 -0.0)", "#f");
+    ExpectEq("(eqv? 'a 'a)", "#t");
+    ExpectEq("(eqv? '(1) '(1))", "#f");
+    ExpectRuntimeError("(eqv? 1 2 3)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EqualComparesStructure") {
+    ExpectEq("(equal? '(1 (2 #(3 a)) \"x\") (list 1 (list 2 (vector 3 'a)) \"x\"))", "#t");
+    ExpectEq("(equal? '(1 2) '(1 2 3))", "#f");
+    ExpectEq("(equal? '(1 . 2) (cons 1 2))", "#t");
+    ExpectEq("(equal? \"abc\" (string-append \"a\" \"bc\"))", "#t");
+    ExpectEq("(equal? \"abc\" 'abc)", "#f");
+    ExpectEq("(equal? 1 1.0)", "#f");
+
+    // unboxed and boxed vectors
+    ExpectEq("(equal? #(1 2) (vector 1 2))", "#t");
+    ExpectEq("(equal? #(1 2) #(1.0 2.0))", "#f");
+    ExpectEq("(equal? #(0.5) (vector 0.5))", "#t");
+    ExpectNoError("(define v (vector 1 2))");
+    ExpectNoError("(vector-set! v 1 'b)");
+    ExpectNoError("(vector-set! v 1 2)");
+    ExpectEq("(equal? v #(1 2))", "#t");
+    ExpectEq("(equal? #() #(1.0))", "#f");
+
+    // a long list doesn't overflow the stack
+    ExpectNoError("(define (range a b acc) (if (= a b) acc (range a (- b 1) (cons (- b 1) acc))))");
+    ExpectNoError(
+        "(define (build i acc) (if (= i 0) acc "
+        "(build (- i 1) (range (* (- i 1) 1000) (* i 1000) acc))))");
+    ExpectNoError("(define l (build 100 '()))");
+    ExpectEq("(equal? l (list-copy l))", "#t");
+    ExpectEq("(equal? (list l) (list (reverse (reverse l))))", "#t");
+    ExpectEq("(equal? l (cdr l))", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EqualOnCycles") {
+    ExpectNoError("(define (cycle l) (set-cdr! (list-tail l (- (length l) 1)) l) l)");
+    ExpectNoError("(define a (cycle (list 1 2)))");
+    ExpectNoError("(define b (cycle (list 1 2 1 2)))");
+    ExpectNoError("(define c (cycle (list 1 2 3)))");
+    ExpectEq("(equal? a a)", "#t");
+    ExpectEq("(equal? a b)", "#t");
+    ExpectEq("(equal? a c)", "#f");
+    ExpectEq("(equal? a '(1 2 1 2))", "#f");
+
+    // a vector holding itself
+    ExpectNoError("(define v (vector 1 0))");
+    ExpectNoError("(vector-set! v 1 v)");
+    ExpectNoError("(define w (vector 1 0))");
+    ExpectNoError("(vector-set! w 1 w)");
+    ExpectEq("(equal? v w)", "#t");
+
+    // cyclic keys of hash tables
+    ExpectEq("(= (equal-hash a) (equal-hash b))", "#t");
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError("(hash-table-set! t a 'found)");
+    ExpectEq("(hash-table-ref t b)", "found");
+    ExpectEq("(hash-table-ref t c 'none)", "none");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EqualHash") {
+    ExpectEq("(= (equal-hash '(1 (2 \"x\"))) (equal-hash (list 1 (list 2 \"x\"))))", "#t");
+    ExpectEq("(= (equal-hash #(1 2)) (equal-hash (vector 1 2)))", "#t");
+    ExpectEq("(= (equal-hash '(1 2)) (equal-hash '(2 1)))", "#f");
+    ExpectEq("(>= (equal-hash 'a) 0)", "#t");
+    ExpectRuntimeError("(equal-hash)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InternedSymbolsSurviveGC") {
+    ExpectNoError("(define s (string->symbol \"fresh\"))");
+    ExpectNoError("(define (garbage n) (if (= n 0) 0 (begin-list (list n n) (garbage (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    ExpectNoError("(garbage 100)");
+    ExpectEq("(eq? s 'fresh)", "#t");
+    ExpectEq("(eq? (string->symbol \"unused\") 'unused)", "#t");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "EquivalenceBenchmark", "[.benchmark]") {
+    // lists of 10 elements as hash table keys, and equal? on long lists
+    ExpectNoError("(define (range a b acc) (if (= a b) acc (range a (- b 1) (cons (- b 1) acc))))");
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError(
+        "(define (fill i) (if (= i 1000) i "
+        "(begin-list (hash-table-set! t (range i (+ i 10) '()) i) (fill (+ i 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    ExpectNoError("(fill 0)");
+    ExpectNoError(
+        "(define (lookup i acc) (if (= i 1000) acc "
+        "(lookup (+ i 1) (+ acc (hash-table-ref t (range i (+ i 10) '()))))))");
+    ExpectNoError(
+        "(define (build i acc) (if (= i 0) acc "
+        "(build (- i 1) (range (* (- i 1) 1000) (* i 1000) acc))))");
+    ExpectNoError("(define l (build 1000 '()))");
+    ExpectNoError("(define m (list-copy l))");
+
+    // (length l) is what walking l once costs
+    for (std::string expression : {"(lookup 0 0)", "(length l)", "(equal? l m)"}) {
+        Benchmark(expression);
+    }
+}
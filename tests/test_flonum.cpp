@@ -0,0 +1,143 @@
+#include "scheme_test.h"
+
+#include <tokenizer.h>
+
+#include <sstream>
+#include <string>
+
+// inexact numbers, arithmetic with one of them gives a flonum
+
+TEST_CASE("Tokenizer reads flonums") {
+    std::stringstream ss{"1.5 -0.25 2e3 1.5e-3 (1 . 2)"};
+    Tokenizer tokenizer{&ss};
+    REQUIRE(tokenizer.GetToken() == Token{FloatConstantToken{1.5}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{FloatConstantToken{-0.25}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{FloatConstantToken{2000}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{FloatConstantToken{0.0015}});
+    tokenizer.Next();
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken{1}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{DotToken{}});
+
+    std::stringstream bad{"1e+"};
+    REQUIRE_THROWS_AS(Tokenizer{&bad}, SyntaxError);
+}
+
+TEST_CASE_METHOD(SchemeTest, "FlonumLiterals") {
+    ExpectEq("1.5", "1.5");
+    ExpectEq("-0.25", "-0.25");
+    ExpectEq("2.0", "2.0");
+    ExpectEq("1e3", "1000.0");
+    ExpectEq("1e30", "1e+30");
+    ExpectEq("'(0.5 . 1)", "(0.5 . 1)");
+    ExpectEq("(number? 0.1)", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FlonumArithmetic") {
+    ExpectEq("(+ 1 2.5)", "3.5");
+    ExpectEq("(* 2 0.5)", "1.0");
+    ExpectEq("(- 1.5)", "1.5");
+    ExpectEq("(/ 1.0 4)", "0.25");
+    ExpectEq("(abs -1.5)", "1.5");
+    ExpectEq("(+ 0.1 0.2)", "0.30000000000000004");
+
+    // integers before the first flonum are combined as integers
+    ExpectEq("(/ 7 2 1.0)", "3.0");
+    ExpectEq("(/ 7 2.0)", "3.5");
+    ExpectEq("(+ 1.0 100000000000000000000)", "1e+20");
+    ExpectEq("(max 1 2.0)", "2.0");
+    ExpectEq("(min 1 2.0)", "1.0");
+
+    // dividing by an inexact zero isn't an error
+    ExpectEq("(/ 1 0.0)", "+inf.0");
+    ExpectEq("(/ -1.0 0)", "-inf.0");
+    ExpectEq("(- (/ 1 0.0) (/ 1 0.0))", "+nan.0");
+    ExpectRuntimeError("(+ 1.5 'a)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FlonumComparisons") {
+    ExpectEq("(= 1 1.0)", "#t");
+    ExpectEq("(< 1 1.5 2)", "#t");
+    ExpectEq("(> 100000000000000000000 1e19)", "#t");
+    ExpectEq("(<= 0.5 0.25)", "#f");
+    ExpectNoError("(define nan (- (/ 1 0.0) (/ 1 0.0)))");
+    ExpectEq("(= nan nan)", "#f");
+    ExpectEq("(< nan 1)", "#f");
+    ExpectEq("(>= nan 1)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedFlonums") {
+    ExpectNoError("(define (norm x y) (+ (* x x) (* y y)))");
+    REQUIRE(GetTierStats().specializations == 1);
+    ExpectEq("(norm 3 4)", "25");
+    ExpectEq("(norm 3.0 4)", "25.0");
+    REQUIRE(GetTierStats().specializations == 2);
+    ExpectEq("(norm 0.5 0.5)", "0.5");
+    REQUIRE(GetTierStats().specializations == 3);
+    ExpectEq("(norm 3 4)", "25");
+
+    // the integer part still overflows into a bignum before it is converted
+    ExpectNoError("(define (scale n x) (* n n n x))");
+    ExpectEq("(scale 3000000 0.5)", "1.35e+19");
+    ExpectEq("(scale 3 0.5)", "13.5");
+
+    ExpectNoError("(define (clamp x) (if (< x 0) 0.0 (if (> x 1) 1.0 x)))");
+    ExpectEq("(clamp -0.5)", "0.0");
+    ExpectEq("(clamp 0.25)", "0.25");
+    ExpectEq("(clamp 7)", "1.0");
+    ExpectNoError("(define (mid a b) (/ (+ a b) 2.0))");
+    ExpectEq("(mid 1 2)", "1.5");
+    ExpectEq("(mid 1.0 0)", "0.5");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedFlonumsBehindGuards") {
+    // the optimizer leaves b behind a guard of the folded if; the same expression outside of
+    // a lambda is never specialized
+    ExpectNoError("(define (f a b c) (+ (* c a) (if #f -3 b)))");
+    for (std::string args : {"2.0 1.5 10", "2 1.5 10", "2.0 1 10", "2 1 10", "0.5 -1.5 3"}) {
+        std::string a = args.substr(0, args.find(' '));
+        std::string b = args.substr(args.find(' ') + 1, args.rfind(' ') - args.find(' ') - 1);
+        std::string c = args.substr(args.rfind(' ') + 1);
+        std::string expected = "(+ (* " + c + " " + a + ") (if #f -3 " + b + "))";
+        for (int i = 0; i < 3; ++i) {
+            ExpectEq("(equal? (f " + args + ") " + expected + ")", "#t");
+        }
+    }
+    ExpectEq("(f 2.0 1.5 10)", "21.5");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedFlonumsStayUnboxed") {
+    // arguments are globals so that the call isn't inlined
+    ExpectNoError("(define x 0.5)");
+    ExpectNoError("(define y 0.25)");
+    ExpectNoError("(define (poly x y) (+ (* x x x) (* 3 x y) (- 1.0 y)))");
+    ExpectNoError("(define (pick x y) x)");
+    ExpectEq("(poly x y)", "1.25");
+
+    // only the result is made, the products aren't even temporaries
+    auto before = GetAllocationStats();
+    ExpectEq("(poly x y)", "1.25");
+    auto after = GetAllocationStats();
+    REQUIRE(after.scratch == before.scratch);
+    auto made = after.heap - before.heap;
+
+    // the same call without arithmetic
+    before = GetAllocationStats();
+    ExpectEq("(pick x y)", "0.5");
+    REQUIRE(made - (GetAllocationStats().heap - before.heap) == 1);
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "FlonumBenchmark", "[.benchmark]") {
+    // midpoint rule for the integral of x^3 - 2x + 1 over [0, 1]
+    ExpectNoError("(define (f x) (+ (* x x x) (* -2 x) 1))");
+    ExpectNoError(
+        "(define (integrate n h x acc) (if (= n 0) (* h acc) "
+        "(integrate (- n 1) h (+ x h) (+ acc (f (+ x (* 0.5 h)))))))");
+
+    Benchmark("(integrate 10000 0.0001 0.0 0.0)", "10000 steps of the midpoint rule");
+}
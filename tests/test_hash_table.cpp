@@ -0,0 +1,154 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "HashTableOperations") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectEq("(hash-table? t)", "#t");
+    ExpectEq("(hash-table? '(1))", "#f");
+    ExpectEq("(hash-table-count t)", "0");
+
+    ExpectNoError("(hash-table-set! t 'a 1)");
+    ExpectNoError("(hash-table-set! t 'b '(2 3))");
+    ExpectEq("(hash-table-ref t 'a)", "1");
+    ExpectEq("(hash-table-ref t 'b)", "(2 3)");
+    ExpectEq("(hash-table-count t)", "2");
+    ExpectNoError("(hash-table-set! t 'a 10)");
+    ExpectEq("(hash-table-ref t 'a)", "10");
+    ExpectEq("(hash-table-count t)", "2");
+
+    ExpectEq("(hash-table-contains? t 'b)", "#t");
+    ExpectNoError("(hash-table-delete! t 'b)");
+    ExpectEq("(hash-table-contains? t 'b)", "#f");
+    ExpectNoError("(hash-table-delete! t 'b)");
+    ExpectEq("(hash-table-ref t 'b 'none)", "none");
+    ExpectEq("(hash-table-count t)", "1");
+
+    // () is a value like any other
+    ExpectNoError("(hash-table-set! t '() '())");
+    ExpectEq("(hash-table-contains? t '())", "#t");
+    ExpectEq("(hash-table-ref t '() 'none)", "()");
+
+    ExpectRuntimeError("(hash-table-ref t 'b)");
+    ExpectRuntimeError("(hash-table-ref '((a . 1)) 'a)");
+    ExpectRuntimeError("(hash-table-set! t 'a)");
+    ExpectRuntimeError("(make-hash-table 1)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HashTableKeys") {
+    // keys are compared by structure, numbers by value and exactness
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError("(hash-table-set! t '(1 (2 . 3)) 'list)");
+    ExpectNoError("(hash-table-set! t #(1 2) 'vector)");
+    ExpectNoError("(hash-table-set! t 100000000000000000000 'big)");
+    ExpectNoError("(hash-table-set! t 1 'fixnum)");
+    ExpectNoError("(hash-table-set! t 1.0 'flonum)");
+    ExpectEq("(hash-table-ref t (list 1 (cons 2 3)))", "list");
+    ExpectEq("(hash-table-ref t (vector 1 2))", "vector");
+    ExpectEq("(hash-table-ref t (* 10000000000 10000000000))", "big");
+    ExpectEq("(hash-table-ref t (- 2 1))", "fixnum");
+    ExpectEq("(hash-table-ref t (/ 2.0 2))", "flonum");
+    ExpectEq("(hash-table-ref t '(1 2) 'none)", "none");
+    ExpectEq("(hash-table-count t)", "5");
+
+    // procedures only equal themselves
+    ExpectNoError("(define (f x) x)");
+    ExpectNoError("(hash-table-set! t f 'f)");
+    ExpectEq("(hash-table-ref t f)", "f");
+    ExpectEq("(hash-table-ref t (lambda (x) x) 'none)", "none");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HashTableIteration") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectEq("(hash-table-keys t)", "()");
+    ExpectNoError("(hash-table-set! t 1 10)");
+    ExpectNoError("(hash-table-set! t 2 20)");
+    ExpectNoError("(hash-table-set! t 3 30)");
+
+    ExpectNoError("(define (sum l) (if (null? l) 0 (+ (car l) (sum (cdr l)))))");
+    ExpectEq("(sum (hash-table-keys t))", "6");
+    ExpectEq("(sum (hash-table-values t))", "60");
+    ExpectNoError("(define (sum-products l) (if (null? l) 0 "
+                  "(+ (* (car (car l)) (cdr (car l))) (sum-products (cdr l)))))");
+    ExpectEq("(sum-products (hash-table->alist t))", "140");
+
+    // the procedure may change the table it walks
+    ExpectNoError("(define (double! key value) (hash-table-set! t (* 10 key) value))");
+    ExpectNoError("(hash-table-walk t double!)");
+    ExpectEq("(hash-table-count t)", "6");
+    ExpectEq("(hash-table-ref t 30)", "30");
+    ExpectNoError("(define (drop! key value) (hash-table-delete! t key))");
+    ExpectNoError("(hash-table-walk t drop!)");
+    ExpectEq("(hash-table-count t)", "0");
+    ExpectRuntimeError("(hash-table-walk t 1)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HashTableGrowsAndShrinks") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError("(define (fill i n) (if (= i n) n (fill (set i) n)))");
+    ExpectNoError("(define (set i) (hash-table-set! t i (* i i)) (+ i 1))");
+    ExpectNoError("(define (drop i n) (if (>= i n) n (drop (remove i) n)))");
+    ExpectNoError("(define (remove i) (hash-table-delete! t i) (+ i 2))");
+    ExpectNoError(
+        "(define (check i n) (if (>= i n) #t "
+        "(if (= (hash-table-ref t i -1) (* i i)) (check (+ i 2) n) i)))");
+
+    ExpectNoError("(fill 0 2000)");
+    ExpectEq("(hash-table-count t)", "2000");
+    ExpectNoError("(drop 0 2000)");
+    ExpectEq("(hash-table-count t)", "1000");
+    ExpectEq("(check 1 2000)", "#t");
+    ExpectEq("(hash-table-contains? t 1000)", "#f");
+
+    // deleted slots are reused
+    ExpectNoError("(fill 0 2000)");
+    ExpectEq("(hash-table-count t)", "2000");
+    ExpectEq("(check 0 2000)", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HashTableSurvivesGC") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError("(hash-table-set! t (list 'k 1) (list 'v 1))");
+    ExpectNoError("(hash-table-set! t 'square (lambda (x) (* x x)))");
+    ExpectNoError("(hash-table-set! t 'self t)");
+    ExpectNoError("(define (garbage n) (if (= n 0) 0 (begin-list (list n n) (garbage (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    ExpectNoError("(garbage 100)");
+    ExpectEq("(hash-table-ref t '(k 1))", "(v 1)");
+    ExpectEq("((hash-table-ref t 'square) 5)", "25");
+    ExpectEq("(hash-table-count (hash-table-ref t 'self))", "3");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "HashTableBenchmark", "[.benchmark]") {
+    // 2000 keys, looked up from an association list and from a table
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError(
+        "(define (fill i alist) (if (= i 2000) alist "
+        "(fill (+ (set i) 1) (cons (cons i i) alist))))");
+    ExpectNoError("(define (set i) (hash-table-set! t i i) i)");
+    ExpectNoError("(define alist (fill 0 '()))");
+    ExpectNoError(
+        "(define (assoc key l) (if (= (car (car l)) key) (car l) (assoc key (cdr l))))");
+    ExpectNoError(
+        "(define (lookup-alist i acc) (if (= i 2000) acc "
+        "(lookup-alist (+ i 1) (+ acc (cdr (assoc i alist))))))");
+    ExpectNoError(
+        "(define (lookup-table i acc) (if (= i 2000) acc "
+        "(lookup-table (+ i 1) (+ acc (hash-table-ref t i)))))");
+
+    // a million entries, filled in blocks so that the recursion stays shallow
+    ExpectNoError("(define big (make-hash-table))");
+    ExpectNoError(
+        "(define (fill-range base n) (if (= n 0) base (fill-range (put base n) (- n 1))))");
+    ExpectNoError("(define (put base n) (hash-table-set! big (+ base n) n) base)");
+    ExpectNoError(
+        "(define (fill-big i) (if (= i 0) (hash-table-count big) "
+        "(fill-big (- (/ (fill-range (* i 1000) 1000) 1000) 1))))");
+
+    for (std::string expression :
+         {"(lookup-alist 0 0)", "(lookup-table 0 0)", "(fill-big 1000)"}) {
+        Benchmark(expression);
+    }
+    ExpectEq("(hash-table-count big)", "1000000");
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scheme_test.h"
+
+#include <catch.hpp>
+
+// test_scheme_tidy_jit compiles every lambda on its first call, these cover the paths where
+// compiled code has to give control back to the interpreter
+
+TEST_CASE_METHOD(SchemeTest, "RebindingInlinedBuiltins") {
+    ExpectNoError("(define (inc x) (+ x 1))");
+    ExpectNoError("(define (positive? x) (if (< 0 x) #t #f))");
+    ExpectEq("(inc 1)", "2");
+    ExpectEq("(positive? 5)", "#t");
+
+    ExpectNoError("(define + -)");
+    ExpectNoError("(set! < (lambda (x y) (= x y)))");
+    ExpectEq("(inc 1)", "0");
+    ExpectEq("(positive? 5)", "#f");
+    ExpectEq("(positive? 0)", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "NonNumbersInInlinedArithmetic") {
+    ExpectNoError("(define (add x y) (+ x y))");
+    ExpectNoError("(define (less? x y) (if (< x y) 'yes 'no))");
+    ExpectEq("(add 1 2)", "3");
+    ExpectRuntimeError("(add 1 'a)");
+    ExpectRuntimeError("(add '() 1)");
+    ExpectRuntimeError("(less? #t 1)");
+    ExpectEq("(less? 1 2)", "yes");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ConditionsOnAnyValue") {
+    ExpectNoError("(define (pick x) (if x 'yes 'no))");
+    ExpectEq("(pick 0)", "yes");
+    ExpectEq("(pick '())", "yes");
+    ExpectEq("(pick #f)", "no");
+    ExpectEq("(pick '#f)", "no");
+    ExpectEq("(pick (= 1 2))", "no");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ErrorsInsideCompiledCode") {
+    ExpectNoError("(define (dive x) (if (= x 0) (car '()) (+ 1 (dive (- x 1)))))");
+    ExpectNoError("(define (one x) x)");
+    ExpectNoError("(define (call-badly) (one 1 2))");
+
+    ExpectRuntimeError("(dive 10)");
+    ExpectRuntimeError("(call-badly)");
+    ExpectNameError("(one undefined-name)");
+    ExpectEq("(one (+ 2 3))", "5");
+}
+
+TEST_CASE_METHOD(SchemeTest, "CallsThroughValues") {
+    ExpectNoError("(define (twice f x) (f (f x)))");
+    ExpectEq("(twice (lambda (y) (+ y 3)) 1)", "7");
+    ExpectEq("(twice - 5)", "5");
+
+    ExpectNoError("(define (adder n) (lambda (x) (+ x n)))");
+    ExpectNoError("(define add5 (adder 5))");
+    WITH_ALLOCATION_DIFFERENCE_CHECK(0, {
+        ExpectEq("(add5 10)", "15");
+        ExpectEq("(twice add5 0)", "10");
+    });
+}
+
+TEST_CASE_METHOD(SchemeTest, "DeoptimizationOnRedefinition") {
+    if (!kJitSupported) {
+        return;
+    }
+    SetJit(true, 2);
+    ExpectNoError("(define (inc x) (+ x 1))");
+    ExpectNoError("(define (count-up n acc) (if (= n 0) acc (count-up (- n 1) (inc acc))))");
+    ExpectEq("(count-up 10 0)", "10");
+    // inc is inlined into count-up, so only count-up gets hot
+    REQUIRE(GetTierStats().promotions == 1);
+    REQUIRE(GetTierStats().deoptimizations == 0);
+
+    // count-up was specialized on the builtin + through the inlined inc
+    ExpectNoError("(define + -)");
+    ExpectEq("(count-up 10 0)", "-10");
+    REQUIRE(GetTierStats().deoptimizations == 1);
+
+    ExpectNoError("(set! inc (lambda (x) x))");
+    ExpectEq("(count-up 10 0)", "0");
+    REQUIRE(GetTierStats().deoptimizations == 2);
+    // count-up got hot again twice, the second time calling the new inc which got hot too
+    REQUIRE(GetTierStats().promotions == 4);
+
+    // the global a lambda depends on is redefined while the lambda is running
+    ExpectNoError("(define (step x) (- x 1))");
+    ExpectNoError("(define (down n) (if (= n 5) (set! step (lambda (x) (- x 2)))) (if (< n 1) n (down (step n))))");
+    ExpectEq("(down 10)", "-1");
+}
+
+// results of the expressions in a new interpreter at the default threshold, or with the
+// native tier off; errors are results too
+std::vector<std::string> RunEach(const std::vector<std::string>& program, bool jit) {
+    Interpreter interpreter;
+    interpreter.SetJit(jit);
+    std::vector<std::string> res;
+    for (auto& expression : program) {
+        try {
+            res.push_back(interpreter.Run(expression));
+        } catch (const RuntimeError& error) {
+            res.push_back(std::string("runtime error: ") + error.what());
+        }
+    }
+    if (jit && kJitSupported) {
+        REQUIRE(interpreter.GetTierStats().promotions > 0);
+    }
+    return res;
+}
+
+// every lambda here is called well past the threshold, so the results after it come from
+// native code
+TEST_CASE("JitAgreesWithInterpreter") {
+    std::vector<std::string> program = {
+        "(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))",
+        "(fib 20)",
+        "(define (count-up n acc) (if (= n 0) acc (count-up (- n 1) (+ acc n))))",
+        "(count-up 1000 0)",
+        "(count-up 1000 4611686018427387904)",
+        "(count-up 1000 -9223372036854775807)",
+        "(define (halve n acc) (if (< n 1) acc (halve (- n 1) (/ acc 2))))",
+        "(halve 100 100000000000000000000000)",
+        "(halve 100 -7)",
+        "(define (scale n x) (if (= n 0) x (scale (- n 1) (* x 1.5))))",
+        "(scale 100 1)",
+        "(scale 100 0.5)",
+        "(define (pick n x y) (if (= n 0) (if x 'yes 'no) (pick (- n 1) y x)))",
+        "(pick 101 #f '())",
+        "(pick 100 #f 0)",
+        "(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))",
+        "(define (sum l) (if (null? l) 0 (+ (car l) (sum (cdr l)))))",
+        "(sum (range 0 1000))",
+        "(sum (range 0 100.0))",
+        "(sum '(1 a))",
+        "(define (adder n) (lambda (x) (+ x n)))",
+        "(define (apply-n f n x) (if (= n 0) x (apply-n f (- n 1) (f x))))",
+        "(apply-n (adder 3) 500 0)",
+        "(apply-n car 1 '(1 2))",
+        "(define (inc x) (+ x 1))",
+        "(define (count n acc) (if (= n 0) acc (count (- n 1) (inc acc))))",
+        "(count 500 0)",
+        "(define + -)",
+        "(count 500 0)",
+        "(fib 10)",
+    };
+    auto expected = RunEach(program, false);
+    auto actual = RunEach(program, true);
+    for (size_t i = 0; i < program.size(); ++i) {
+        INFO(program[i]);
+        REQUIRE(actual[i] == expected[i]);
+    }
+}
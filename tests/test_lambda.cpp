@@ -152,3 +152,72 @@ TEST_CASE_METHOD(SchemeTest, "Redefinition and scoping") {
     ExpectEq("((foobar) 1 2)", "3");
     ExpectEq("(+ 1 2 -3)", "0");
 }
+
+TEST_CASE_METHOD(SchemeTest, "Call site cache invalidation") {
+    ExpectNoError("(define (g) 1)");
+    ExpectNoError("(define (call-g) (g))");
+    ExpectEq("(call-g)", "1");
+    ExpectNoError("(define (g) 2)");
+    ExpectEq("(call-g)", "2");
+    ExpectNoError("(set! g (lambda () 3))");
+    ExpectEq("(call-g)", "3");
+    ExpectNoError("(define (shadow) (define (g) 4) (g))");
+    ExpectEq("(shadow)", "4");
+    ExpectEq("(call-g)", "3");
+}
+
+// the scopes of successive interpreters may have the same address and versions, but each
+// call site has its own cache
+TEST_CASE("Call site caches of separate interpreters") {
+    for (int i = 0; i < 3; ++i) {
+        Interpreter interpreter;
+        interpreter.Run("(define (g) " + std::to_string(i) + ")");
+        interpreter.Run("(define (call-g) (g))");
+        REQUIRE(interpreter.Run("(call-g)") == std::to_string(i));
+        REQUIRE(interpreter.Run("(g)") == std::to_string(i));
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "InternalDefinitions") {
+    ExpectNoError(R"EOF(
+        (define (parity n)
+            (define (even n) (if (= n 0) 'even (odd (- n 1))))
+            (define (odd n) (if (= n 0) 'odd (even (- n 1))))
+            (even n))
+    )EOF");
+    ExpectEq("(parity 10)", "even");
+    ExpectEq("(parity 7)", "odd");
+
+    ExpectNoError("(define (early) (define y z) (define z 1) y)");
+    ExpectNameError("(early)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FramesAfterError") {
+    ExpectNoError("(define (fail x) (if (= x 0) (car '()) (fail (- x 1))))");
+    ExpectNoError("(define (make x) (lambda () x))");
+    ExpectRuntimeError("(fail 5)");
+    ExpectEq("((make 7))", "7");
+    ExpectNoError("(define (apply-op op x y) (op x y))");
+    ExpectEq("(apply-op + 1 2)", "3");
+    ExpectEq("(apply-op - 1 2)", "-1");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ClosuresCaptureFreeVariables") {
+    ExpectNoError("(define (adder a) (lambda (b) (lambda (c) (+ a b c))))");
+    ExpectEq("(((adder 1) 2) 3)", "6");
+
+    ExpectNoError(R"EOF(
+        (define (counter)
+            (define n 0)
+            (define (inc) (set! n (+ n 1)) n)
+            (inc)
+            (inc)
+            (list n (inc)))
+    )EOF");
+    ExpectEq("(counter)", "(2 3)");
+
+    ExpectNoError("(define (outer x) (lambda () (lambda () (set! x (* x 2)) x)))");
+    ExpectNoError("(define twice ((outer 5)))");
+    ExpectEq("(twice)", "10");
+    ExpectEq("(twice)", "20");
+}
@@ -1,5 +1,7 @@
 #include "scheme_test.h"
 
+#include <string>
+
 TEST_CASE_METHOD(SchemeTest, "ListsAreNotSelfEvaliating") {
     ExpectRuntimeError("()");
     ExpectRuntimeError("(1)");
@@ -33,12 +35,18 @@ TEST_CASE_METHOD(SchemeTest, "PairPredicate") {
     ExpectEq("(pair? '(1 . 2))", "#t");
     ExpectEq("(pair? '(1 2))", "#t");
     ExpectEq("(pair? '())", "#f");
+    ExpectEq("(pair? '(1 2 3))", "#t");
+    ExpectEq("(pair? '(a b))", "#t");
+    ExpectEq("(pair? 5)", "#f");
+    ExpectRuntimeError("(pair? '(1) '(2))");
 }
 
 TEST_CASE_METHOD(SchemeTest, "NullPredicate") {
     ExpectEq("(null? '())", "#t");
     ExpectEq("(null? '(1 2))", "#f");
     ExpectEq("(null? '(1 . 2))", "#f");
+    ExpectEq("(null? '(()))", "#f");
+    ExpectEq("(null? 5)", "#f");
 }
 
 TEST_CASE_METHOD(SchemeTest, "ListPredicate") {
@@ -46,6 +54,39 @@ TEST_CASE_METHOD(SchemeTest, "ListPredicate") {
     ExpectEq("(list? '(1 2))", "#t");
     ExpectEq("(list? '(1 . 2))", "#f");
     ExpectEq("(list? '(1 2 3 4 . 5))", "#f");
+    ExpectEq("(list? 5)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "CyclicLists") {
+    // cycles of odd and even length, and ones that start after a few pairs
+    ExpectNoError("(define (cycle l) (set-cdr! (list-tail l (- (length l) 1)) l) l)");
+    for (std::string list : {"'(1)", "'(1 2)", "'(1 2 3)"}) {
+        ExpectNoError("(define c (cycle (list-copy " + list + ")))");
+        ExpectEq("(list? c)", "#f");
+        ExpectEq("(pair? c)", "#t");
+        ExpectEq("(null? c)", "#f");
+        ExpectRuntimeError("(length c)");
+        ExpectNoError("(define d (cons 0 (cons 0 c)))");
+        ExpectEq("(list? d)", "#f");
+        ExpectRuntimeError("(length d)");
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListPredicatesDontAllocate") {
+    // walking a long list makes nothing more than walking a short one
+    std::string elements;
+    for (int i = 0; i < 1000; ++i) {
+        elements += std::to_string(i) + " ";
+    }
+    ExpectNoError("(define short '(1))");
+    ExpectNoError("(define long '(" + elements + "))");
+    for (std::string predicate : {"pair?", "null?", "list?", "length"}) {
+        auto before = GetAllocationStats().heap;
+        ExpectNoError("(" + predicate + " short)");
+        auto middle = GetAllocationStats().heap;
+        ExpectNoError("(" + predicate + " long)");
+        REQUIRE(GetAllocationStats().heap - middle == middle - before);
+    }
 }
 
 TEST_CASE_METHOD(SchemeTest, "PairOperations") {
@@ -0,0 +1,131 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "ListBlockOperations") {
+    ExpectNoError("(define l (list 1 2 3 4))");
+    ExpectEq("l", "(1 2 3 4)");
+    ExpectEq("(car (cdr l))", "2");
+    ExpectEq("(cdr (cdr (cdr l)))", "(4)");
+    ExpectEq("(list-ref l 3)", "4");
+    ExpectEq("(list-tail l 2)", "(3 4)");
+    ExpectEq("(list-tail l 4)", "()");
+    ExpectEq("(list-ref (cdr l) 2)", "4");
+    ExpectEq("(length l)", "4");
+    ExpectEq("(pair? (cdr l))", "#t");
+    ExpectEq("(list? l)", "#t");
+    ExpectRuntimeError("(list-ref l 4)");
+    ExpectRuntimeError("(list-tail l 5)");
+
+    // quoted lists, dotted ones end with their last cdr
+    ExpectEq("(list-ref '(a b c) 2)", "c");
+    ExpectEq("(cdr (cdr '(1 2 . 3)))", "3");
+    ExpectEq("(list-tail '(1 2 . 3) 2)", "3");
+    ExpectRuntimeError("(list-ref '(1 2 . 3) 2)");
+    ExpectEq("(list? '(1 2 . 3))", "#f");
+    ExpectEq("(equal? '(1 2 3) (cons 1 (cons 2 (cons 3 '()))))", "#t");
+
+    // a list sharing the pairs of another one
+    ExpectNoError("(define m (cons 0 (cdr l)))");
+    ExpectEq("(list-ref m 3)", "4");
+    ExpectEq("(list-tail m 1)", "(2 3 4)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListBlockMutation") {
+    ExpectNoError("(define l (list 1 2 3 4 5))");
+    ExpectNoError("(set-car! (cdr l) 'b)");
+    ExpectEq("l", "(1 b 3 4 5)");
+    ExpectEq("(list-ref l 1)", "b");
+
+    // set-cdr! makes the following pairs unreachable from l
+    ExpectNoError("(define tail (cdr (cdr l)))");
+    ExpectNoError("(set-cdr! (cdr l) '(x y))");
+    ExpectEq("l", "(1 b x y)");
+    ExpectEq("(list-ref l 2)", "x");
+    ExpectEq("(list-ref l 3)", "y");
+    ExpectRuntimeError("(list-ref l 4)");
+    ExpectEq("(list-tail l 2)", "(x y)");
+    ExpectEq("(length l)", "4");
+    ExpectEq("tail", "(3 4 5)");
+    ExpectEq("(list-ref tail 2)", "5");
+
+    // and a cycle
+    ExpectNoError("(define c '(1 2 3))");
+    ExpectNoError("(set-cdr! (cdr (cdr c)) c)");
+    ExpectEq("(list? c)", "#f");
+    ExpectEq("(list-ref c 7)", "2");
+    ExpectEq("(car (list-tail c 9))", "1");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListBlockSurvivesGC") {
+    ExpectNoError("(define l (list (list 1 2) \"s\" (lambda (x) (* x x)) 4 5))");
+    ExpectNoError("(define t (list-tail (list 'a 'b (list 'c 'd) 'e) 2))");
+    ExpectNoError("(define u (list 1 2 3))");
+    ExpectNoError("(set-cdr! (cdr u) (list 'v 'w))");
+    ExpectNoError("(define (garbage n) (if (= n 0) 0 (begin-list (list n n n) (garbage (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    for (int i = 0; i < 3; ++i) {
+        ExpectNoError("(garbage 100)");
+        ExpectEq("(car (list-ref l 0))", "1");
+        ExpectEq("((list-ref l 2) 5)", "25");
+        ExpectEq("t", "((c d) e)");
+        ExpectEq("u", "(1 2 v w)");
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListBlockAllocatesOnce") {
+    // eight elements in one object on the heap instead of eight pairs
+    ExpectNoError("(define (block a) (list a a a a a a a a))");
+    ExpectNoError(
+        "(define (pairs a) "
+        "(cons a (cons a (cons a (cons a (cons a (cons a (cons a (cons a '())))))))))");
+    ExpectEq("(equal? (block 1) (pairs 1))", "#t");
+    auto before = GetAllocationStats().heap;
+    ExpectNoError("(block 1)");
+    auto middle = GetAllocationStats().heap;
+    ExpectNoError("(pairs 1)");
+    REQUIRE(GetAllocationStats().heap - middle == middle - before + 7);
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListBlockMemory") {
+    // a pair made on its own is an allocation, and two more for its dependants once it has
+    // been marked; the 1000 pairs of this block are one allocation together and have no
+    // dependants
+    std::string elements;
+    for (int i = 0; i < 1000; ++i) {
+        elements += "a ";
+    }
+    ExpectNoError("(define l '())");
+    WITH_ALLOCATION_DIFFERENCE_CHECK(20, {
+        ExpectNoError("(set! l '(" + elements + "))");
+        ExpectNoError("(set! l (cons 'b (cdr l)))");
+    });
+
+    // nothing is freed while one pair of the block is reachable, even after set-cdr! cut the
+    // others off
+    WITH_ALLOCATION_DIFFERENCE_CHECK(10, {
+        ExpectNoError("(set-cdr! (cdr l) '())");
+        ExpectEq("l", "(b a)");
+    });
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "ListBlockBenchmark", "[.benchmark]") {
+    // indexing every element and walking a list of 2000 elements, read as one block against
+    // a copy made of separate pairs
+    std::string elements;
+    for (int i = 0; i < 2000; ++i) {
+        elements += std::to_string(i) + " ";
+    }
+    ExpectNoError("(define block '(" + elements + "))");
+    ExpectNoError("(define pairs (list-copy block))");
+    ExpectNoError(
+        "(define (index l i acc) (if (= i 2000) acc (index l (+ i 1) (+ acc (list-ref l i)))))");
+    ExpectNoError("(define (walk l n) (if (= n 0) n (begin-list (length l) (walk l (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+
+    for (std::string expression :
+         {"(index block 0 0)", "(index pairs 0 0)", "(walk block 1000)", "(walk pairs 1000)"}) {
+        Benchmark(expression);
+    }
+}
@@ -0,0 +1,126 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "ListBasics") {
+    ExpectEq("(length '())", "0");
+    ExpectEq("(length '(1 (2 3) 4))", "3");
+    ExpectRuntimeError("(length '(1 . 2))");
+    ExpectRuntimeError("(length 1)");
+
+    ExpectEq("(append)", "()");
+    ExpectEq("(append '(1 2) '(3) '() '(4 5))", "(1 2 3 4 5)");
+    ExpectEq("(append '(1) 2)", "(1 . 2)");
+    ExpectEq("(append '() 'a)", "a");
+    ExpectRuntimeError("(append '(1 . 2) '(3))");
+
+    ExpectEq("(reverse '(1 2 3))", "(3 2 1)");
+    ExpectEq("(reverse '())", "()");
+    ExpectRuntimeError("(reverse '(1 2 . 3))");
+
+    ExpectEq("(list-copy '(1 2 . 3))", "(1 2 . 3)");
+    ExpectEq("(list-copy 5)", "5");
+
+    // the last argument of append is shared, the others and list-copy are copied
+    ExpectNoError("(define a '(1 2))");
+    ExpectNoError("(define b '(3 4))");
+    ExpectNoError("(define c (append a b))");
+    ExpectNoError("(define d (list-copy a))");
+    ExpectNoError("(set-car! b 30)");
+    ExpectNoError("(set-car! a 10)");
+    ExpectEq("c", "(1 2 30 4)");
+    ExpectEq("d", "(1 2)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListResultsOutliveTheirCall") {
+    // cdr reads its argument, but the part it returns is kept
+    ExpectNoError("(define z (cdr (reverse '(1 2 3))))");
+    ExpectNoError("(define y (cdr (list-copy '(1 2 3))))");
+    ExpectNoError("(define x (cdr (append '(1 2) '(3))))");
+    ExpectNoError("(define w (car (cdr (append '(1 (2 3)) '(4)))))");
+    ExpectEq("(+ (* 2 3) (* 4 5) (car (cons 1 2)) (length (reverse '(7 8 9))))", "30");
+    ExpectEq("z", "(2 1)");
+    ExpectEq("y", "(2 3)");
+    ExpectEq("x", "(2 3)");
+    ExpectEq("w", "(2 3)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListSearch") {
+    ExpectEq("(member 2 '(1 2 3))", "(2 3)");
+    ExpectEq("(member '(1) '(0 (1) 2))", "((1) 2)");
+    ExpectEq("(member 4 '(1 2 3))", "#f");
+    ExpectEq("(assoc 'b '((a . 1) (b . 2)))", "(b . 2)");
+    ExpectEq("(assoc 'x '())", "#f");
+    ExpectEq("(assoc 2.0 '((2 . exact) (2.0 . inexact)))", "(2.0 . inexact)");
+    ExpectRuntimeError("(assoc 'c '((a . 1) b))");
+    ExpectRuntimeError("(member 4 '(1 . 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HigherOrderListProcedures") {
+    ExpectNoError("(define (odd? x) (= (abs (- x (* 2 (/ x 2)))) 1))");
+    ExpectEq("(map (lambda (x) (* x x)) '(1 2 3))", "(1 4 9)");
+    ExpectEq("(map + '(1 2 3) '(10 20))", "(11 22)");
+    ExpectEq("(map car '((a 1) (b 2)))", "(a b)");
+    ExpectEq("(map list '())", "()");
+    ExpectEq("(filter odd? '(1 2 3 4 5))", "(1 3 5)");
+    ExpectEq("(filter (lambda (x) (> x 2)) '(1 2 3 4 5))", "(3 4 5)");
+    ExpectEq("(fold-left cons '() '(1 2 3))", "(((() . 1) . 2) . 3)");
+    ExpectEq("(fold-right cons '() '(1 2 3))", "(1 2 3)");
+    ExpectEq("(fold-left - 0 '(1 2 3))", "-6");
+    ExpectEq("(fold-right - 0 '(1 2 3))", "2");
+    ExpectEq("(fold-left (lambda (acc x y) (+ acc (* x y))) 0 '(1 2 3) '(4 5 6))", "32");
+    ExpectEq("(fold-right list 'end '(1 2) '(3 4))", "(1 3 (2 4 end))");
+
+    ExpectNoError("(define sum 0)");
+    ExpectNoError("(for-each (lambda (x y) (set! sum (+ sum (* x y)))) '(1 2 3) '(4 5 6))");
+    ExpectEq("sum", "32");
+
+    // procedures given to them may be redefined, and may call them again
+    ExpectNoError("(define (f x) (map (lambda (y) (* x y)) '(1 2)))");
+    ExpectEq("(map f '(1 2))", "((1 2) (2 4))");
+    ExpectNoError("(define (f x) x)");
+    ExpectEq("(map f '(1 2))", "(1 2)");
+
+    ExpectRuntimeError("(map 1 '(1 2))");
+    ExpectRuntimeError("(map (lambda (x y) x) '(1 2))");
+    ExpectRuntimeError("(map list '(1 . 2))");
+    ExpectRuntimeError("(filter odd?)");
+    ExpectRuntimeError("(fold-left + 0)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "LongLists") {
+    // built in blocks, so that the recursion of the definitions stays shallow
+    ExpectNoError("(define (range a b acc) (if (= a b) acc (range a (- b 1) (cons (- b 1) acc))))");
+    ExpectNoError(
+        "(define (build i acc) (if (= i 0) acc "
+        "(build (- i 1) (range (* (- i 1) 1000) (* i 1000) acc))))");
+    ExpectNoError("(define l (build 1000 '()))");
+    ExpectNoError("(define (odd? x) (= (abs (- x (* 2 (/ x 2)))) 1))");
+    ExpectEq("(length l)", "1000000");
+    ExpectEq("(fold-left + 0 l)", "499999500000");
+    ExpectEq("(fold-right + 0 (map (lambda (x) (* 2 x)) l))", "999999000000");
+    ExpectEq("(car (reverse l))", "999999");
+    ExpectEq("(length (filter odd? (append l l)))", "1000000");
+    ExpectEq("(car (member 999999 (list-copy l)))", "999999");
+    ExpectEq("(assoc 5 (map (lambda (x) (cons x x)) l))", "(5 . 5)");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "ListLibraryBenchmark", "[.benchmark]") {
+    ExpectNoError("(define (range a b acc) (if (= a b) acc (range a (- b 1) (cons (- b 1) acc))))");
+    ExpectNoError("(define l (range 0 10000 '()))");
+    ExpectNoError(
+        "(define (my-map f l) (if (null? l) '() (cons (f (car l)) (my-map f (cdr l)))))");
+    ExpectNoError(
+        "(define (my-fold f acc l) (if (null? l) acc (my-fold f (f acc (car l)) (cdr l))))");
+    ExpectNoError(
+        "(define (my-reverse l acc) (if (null? l) acc (my-reverse (cdr l) (cons (car l) acc))))");
+    ExpectNoError("(define (square x) (* x x))");
+
+    // (car l) is what any call costs
+    for (std::string expression :
+         {"(car l)", "(my-map square l)", "(map square l)", "(my-fold + 0 l)", "(fold-left + 0 l)",
+          "(my-reverse l '())", "(reverse l)"}) {
+        Benchmark(expression, "10000 elements, " + expression);
+    }
+}
@@ -0,0 +1,70 @@
+#include "scheme_test.h"
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedFib") {
+    ExpectNoError(
+        "(define-memoized (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    // exponential without the table
+    ExpectEq("(fib 40)", "102334155");
+    REQUIRE(GetMemoStats().misses == 41);
+    REQUIRE(GetMemoStats().hits == 38);
+
+    ExpectEq("(fib 40)", "102334155");
+    REQUIRE(GetMemoStats().misses == 41);
+    REQUIRE(GetMemoStats().hits == 39);
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedListArguments") {
+    ExpectNoError("(define-memoized (sum l) (if (null? l) 0 (+ (car l) (sum (cdr l)))))");
+    ExpectEq("(sum '(1 2 3))", "6");
+    auto misses = GetMemoStats().misses;
+    // equal lists hit the same entry
+    ExpectEq("(sum (list 1 2 3))", "6");
+    REQUIRE(GetMemoStats().misses == misses);
+
+    // the table keeps its own copy of the arguments
+    ExpectNoError("(define l (list 1 2))");
+    ExpectEq("(sum l)", "3");
+    ExpectNoError("(set-car! l 5)");
+    ExpectEq("(sum l)", "7");
+    ExpectEq("(sum '(1 2))", "3");
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedEviction") {
+    SetMemoCapacity(2);
+    ExpectNoError("(define-memoized (sq x) (* x x))");
+    ExpectEq("(sq 1)", "1");
+    ExpectEq("(sq 2)", "4");
+    ExpectEq("(sq 1)", "1");
+    REQUIRE(GetMemoStats().hits == 1);
+
+    // 2 is the least recently used one
+    ExpectEq("(sq 3)", "9");
+    REQUIRE(GetMemoStats().evictions == 1);
+    ExpectEq("(sq 1)", "1");
+    REQUIRE(GetMemoStats().hits == 2);
+    ExpectEq("(sq 2)", "4");
+    REQUIRE(GetMemoStats().hits == 2);
+    REQUIRE(GetMemoStats().misses == 4);
+    REQUIRE(GetMemoStats().evictions == 2);
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedClosures") {
+    // every closure has a table of its own
+    ExpectNoError("(define (adder k) (define-memoized (add x) (+ x k)) add)");
+    ExpectEq("((adder 1) 1)", "2");
+    ExpectEq("((adder 2) 1)", "3");
+    REQUIRE(GetMemoStats().hits == 0);
+
+    ExpectNoError("(define-memoized (f x) 1)");
+    ExpectEq("(f 0)", "1");
+    ExpectNoError("(define-memoized (f x) 2)");
+    ExpectEq("(f 0)", "2");
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedSyntax") {
+    ExpectSyntaxError("(define-memoized f 1)");
+    ExpectSyntaxError("(define-memoized)");
+    ExpectSyntaxError("(define-memoized (1) 1)");
+    ExpectNoError("(define-memoized (f x) x)");
+    ExpectRuntimeError("(f)");
+}
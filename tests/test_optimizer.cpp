@@ -0,0 +1,83 @@
+#include "scheme_test.h"
+
+// the optimizer rewrites lambda bodies using the bindings of globals at the time they are
+// defined, these check that the results don't change once those bindings do
+
+TEST_CASE_METHOD(SchemeTest, "FoldedConstants") {
+    ExpectEq("(+ 1 2 3)", "6");
+    ExpectEq("(max 1 (- 7 2) (abs -3))", "5");
+
+    ExpectNoError("(define (f) (+ 1 (* 2 3)))");
+    ExpectEq("(f)", "7");
+    ExpectNoError("(set! * +)");
+    ExpectEq("(f)", "6");
+    ExpectNoError("(define + -)");
+    ExpectEq("(f)", "-4");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FoldedPredicates") {
+    ExpectNoError("(define (kind) (if (number? 1) 'number 'other))");
+    ExpectEq("(kind)", "number");
+    ExpectNoError("(set! number? symbol?)");
+    ExpectEq("(kind)", "other");
+
+    ExpectNoError("(define (small?) (< 1 2))");
+    ExpectEq("(small?)", "#t");
+    ExpectNoError("(define < >)");
+    ExpectEq("(small?)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ErrorsAreNotFolded") {
+    // dividing by zero isn't done ahead of time
+    ExpectNoError("(define (div) (/ 1 0))");
+    ExpectNoError("(define (add) (+ 1 'a))");
+    ExpectNoError("(define (compare) (< 1 #t))");
+    ExpectRuntimeError("(div)");
+    ExpectRuntimeError("(add)");
+    ExpectRuntimeError("(compare)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "DeadBranches") {
+    ExpectNoError("(define debug #f)");
+    ExpectNoError("(define (checked x) (if debug (car '()) x))");
+    ExpectNoError("(define (only-debug) (if debug 1))");
+    ExpectEq("(checked 3)", "3");
+    ExpectEq("(only-debug)", "()");
+
+    ExpectNoError("(set! debug #t)");
+    ExpectRuntimeError("(checked 3)");
+    ExpectEq("(only-debug)", "1");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InlinedLambdas") {
+    ExpectNoError("(define (square x) (* x x))");
+    ExpectNoError("(define (sum-squares a b) (+ (square a) (square b)))");
+    ExpectEq("(sum-squares 3 4)", "25");
+    ExpectRuntimeError("(sum-squares 3 'a)");
+
+    ExpectNoError("(define (square x) x)");
+    ExpectEq("(sum-squares 3 4)", "7");
+    ExpectNoError("(set! square (lambda (x) (- 0 x)))");
+    ExpectEq("(sum-squares 3 4)", "-7");
+}
+
+TEST_CASE_METHOD(SchemeTest, "RecursiveLambdasAreNotInlined") {
+    ExpectNoError("(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))");
+    ExpectNoError("(define (use-fact) (fact 5))");
+    ExpectEq("(use-fact)", "120");
+
+    ExpectNoError("(define (even? n) (if (= n 0) #t (odd? (- n 1))))");
+    ExpectNoError("(define (odd? n) (if (= n 0) #f (even? (- n 1))))");
+    ExpectEq("(odd? 7)", "#t");
+    ExpectEq("(even? 7)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InliningKeepsErrors") {
+    ExpectNoError("(define (id x) x)");
+    ExpectNoError("(define (one x) 1)");
+    ExpectNoError("(define (f) (define y (id y)) y)");
+    ExpectNoError("(define (g) (define y (one y)) y)");
+    ExpectNameError("(f)");
+    ExpectNameError("(g)");
+    ExpectRuntimeError("(id 1 2)");
+}
@@ -0,0 +1,186 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "PersistentMapOperations") {
+    ExpectNoError("(define m (pmap 'a 1 'b '(2 3)))");
+    ExpectEq("(pmap? m)", "#t");
+    ExpectEq("(pmap? '((a . 1)))", "#f");
+    ExpectEq("(pmap-count m)", "2");
+    ExpectEq("(pmap-ref m 'b)", "(2 3)");
+    ExpectEq("(pmap-ref m 'c 'none)", "none");
+    ExpectEq("(pmap-count (pmap))", "0");
+
+    // changes make new maps, the old ones stay as they were
+    ExpectNoError("(define m2 (pmap-set m 'a 10))");
+    ExpectNoError("(define m3 (pmap-set m2 'c 3))");
+    ExpectNoError("(define m4 (pmap-delete m3 'b))");
+    ExpectEq("(pmap-ref m 'a)", "1");
+    ExpectEq("(pmap-ref m2 'a)", "10");
+    ExpectEq("(pmap-count m2)", "2");
+    ExpectEq("(pmap-count m3)", "3");
+    ExpectEq("(pmap-contains? m3 'b)", "#t");
+    ExpectEq("(pmap-contains? m4 'b)", "#f");
+    ExpectEq("(pmap-count m4)", "2");
+    ExpectEq("(pmap-count (pmap-delete m4 'b))", "2");
+    ExpectEq("(pmap->alist (pmap-delete m 'a))", "((b 2 3))");
+
+    // keys are compared by structure
+    ExpectNoError("(define k (pmap '(1 2) 'list #(1 2) 'vector 1 'fixnum 1.0 'flonum))");
+    ExpectEq("(pmap-ref k (list 1 2))", "list");
+    ExpectEq("(pmap-ref k (vector 1 2))", "vector");
+    ExpectEq("(pmap-ref k (- 2 1))", "fixnum");
+    ExpectEq("(pmap-ref k 1.0)", "flonum");
+
+    ExpectRuntimeError("(pmap-ref m 'c)");
+    ExpectRuntimeError("(pmap 'a)");
+    ExpectRuntimeError("(pmap-set m 'a)");
+    ExpectRuntimeError("(pmap-ref '((a . 1)) 'a)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PersistentMapManyKeys") {
+    ExpectNoError("(define (fill m i n) (if (= i n) m (fill (pmap-set m i (* i i)) (+ i 1) n)))");
+    ExpectNoError("(define (drop m i n) (if (>= i n) m (drop (pmap-delete m i) (+ i 2) n)))");
+    ExpectNoError(
+        "(define (check m i n step) (if (>= i n) #t "
+        "(if (= (pmap-ref m i -1) (* i i)) (check m (+ i step) n step) i)))");
+
+    ExpectNoError("(define full (fill (pmap) 0 2000))");
+    ExpectNoError("(define half (drop full 0 2000))");
+    ExpectEq("(pmap-count full)", "2000");
+    ExpectEq("(pmap-count half)", "1000");
+    ExpectEq("(check full 0 2000 1)", "#t");
+    ExpectEq("(check half 1 2000 2)", "#t");
+    ExpectEq("(pmap-contains? half 1000)", "#f");
+
+    // removing every key leaves an empty map
+    ExpectNoError("(define empty (drop half 1 2000))");
+    ExpectEq("(pmap-count empty)", "0");
+    ExpectEq("(pmap->alist empty)", "()");
+    ExpectEq("(pmap-count (fill empty 0 100))", "100");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PersistentMapCollisions") {
+    // only a prefix of large keys is hashed, so these all have the same hash
+    std::string prefix = "(";
+    for (int i = 0; i < 100; ++i) {
+        prefix += "0 ";
+    }
+    ExpectNoError("(define m (pmap))");
+    for (int i = 0; i < 10; ++i) {
+        ExpectNoError("(define m (pmap-set m '" + prefix + std::to_string(i) + ") " +
+                      std::to_string(i) + "))");
+    }
+    ExpectNoError("(define m (pmap-set m 'other 'other))");
+    ExpectEq("(pmap-count m)", "11");
+    for (int i = 0; i < 10; ++i) {
+        ExpectEq("(pmap-ref m '" + prefix + std::to_string(i) + "))", std::to_string(i));
+    }
+    ExpectEq("(pmap-ref m '" + prefix + "10) 'none)", "none");
+
+    ExpectNoError("(define m2 m)");
+    for (int i = 0; i < 9; ++i) {
+        ExpectNoError("(define m2 (pmap-delete m2 '" + prefix + std::to_string(i) + ")))");
+    }
+    ExpectEq("(pmap-count m2)", "2");
+    ExpectEq("(pmap-ref m2 '" + prefix + "9))", "9");
+    ExpectEq("(pmap-ref m2 'other)", "other");
+    ExpectEq("(pmap-count m)", "11");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PersistentVectorOperations") {
+    ExpectNoError("(define v (pvector 1 2 3))");
+    ExpectEq("(pvector? v)", "#t");
+    ExpectEq("(pvector? #(1 2 3))", "#f");
+    ExpectEq("(pvector-length v)", "3");
+    ExpectEq("(pvector-ref v 1)", "2");
+    ExpectEq("(pvector->list (pvector))", "()");
+
+    ExpectNoError("(define v2 (pvector-set v 1 'b))");
+    ExpectNoError("(define v3 (pvector-push v2 4))");
+    ExpectEq("(pvector->list v)", "(1 2 3)");
+    ExpectEq("(pvector->list v2)", "(1 b 3)");
+    ExpectEq("(pvector->list v3)", "(1 b 3 4)");
+
+    ExpectRuntimeError("(pvector-ref v 3)");
+    ExpectRuntimeError("(pvector-ref v -1)");
+    ExpectRuntimeError("(pvector-set v 3 0)");
+    ExpectRuntimeError("(pvector-push v)");
+    ExpectRuntimeError("(pvector-length '(1 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PersistentVectorLevels") {
+    // past the tail, a full root of leaves and a full root of 32 * 32 leaves; filled and
+    // checked in blocks so that the recursion stays shallow
+    ExpectNoError(
+        "(define (push-range v i n) (if (= i n) v (push-range (pvector-push v i) (+ i 1) n)))");
+    ExpectNoError(
+        "(define (fill v i n) (if (> (+ i 1000) n) (push-range v i n) "
+        "(fill (push-range v i (+ i 1000)) (+ i 1000) n)))");
+    ExpectNoError(
+        "(define (check-range v i n) (if (= i n) #t "
+        "(if (= (pvector-ref v i) i) (check-range v (+ i 1) n) i)))");
+    ExpectNoError(
+        "(define (check v i n) (if (> (+ i 1000) n) (check-range v i n) "
+        "(if (number? (check-range v i (+ i 1000))) i (check v (+ i 1000) n))))");
+    ExpectNoError(
+        "(define (negate v i n) (if (>= i n) v (negate (pvector-set v i (- i)) (+ i 97) n)))");
+    ExpectNoError(
+        "(define (check-negated v i n) (if (>= i n) #t "
+        "(if (= (pvector-ref v i) (- i)) (check-negated v (+ i 97) n) i)))");
+    for (std::string size : {"31", "32", "33", "1024", "1056", "1057", "33000", "33825"}) {
+        ExpectNoError("(define v (fill (pvector) 0 " + size + "))");
+        ExpectEq("(pvector-length v)", size);
+        ExpectEq("(check v 0 " + size + ")", "#t");
+        ExpectNoError("(define w (negate v 0 " + size + "))");
+        ExpectEq("(check-negated w 0 " + size + ")", "#t");
+        ExpectEq("(check v 0 " + size + ")", "#t");
+        ExpectEq("(pvector-ref (pvector-push w 'end) " + size + ")", "end");
+    }
+    ExpectEq("(length (pvector->list v))", "33825");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PersistentSurviveGC") {
+    ExpectNoError("(define m (pmap (list 'k 1) (list 'v 1) 'square (lambda (x) (* x x))))");
+    ExpectNoError("(define v (pvector (list 1 2) m))");
+    ExpectNoError("(define (fill v i n) (if (= i n) v (fill (pvector-push v (list i)) (+ i 1) n)))");
+    ExpectNoError("(define big (fill v 0 2000))");
+    ExpectNoError("(define (garbage n) (if (= n 0) 0 (begin-list (list n n) (garbage (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    ExpectNoError("(garbage 100)");
+    ExpectEq("(pmap-ref m '(k 1))", "(v 1)");
+    ExpectEq("((pmap-ref (pvector-ref v 1) 'square) 5)", "25");
+    ExpectEq("(pvector-ref big 0)", "(1 2)");
+    ExpectEq("(pvector-ref big 2001)", "(1999)");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "PersistentBenchmark", "[.benchmark]") {
+    // keeping every version of a table of 1000 entries: an association list copied on each
+    // change against a map, and a list copied on each change against a vector
+    ExpectNoError(
+        "(define (alist-set l key value) (if (null? l) (list (cons key value)) "
+        "(if (= (car (car l)) key) (cons (cons key value) (cdr l)) "
+        "(cons (car l) (alist-set (cdr l) key value)))))");
+    ExpectNoError(
+        "(define (fill-alist l i) (if (= i 1000) l (fill-alist (alist-set l i i) (+ i 1))))");
+    ExpectNoError("(define (fill-map m i) (if (= i 1000) m (fill-map (pmap-set m i i) (+ i 1))))");
+    ExpectNoError(
+        "(define (list-set l i value) (if (= i 0) (cons value (cdr l)) "
+        "(cons (car l) (list-set (cdr l) (- i 1) value))))");
+    ExpectNoError(
+        "(define (fill-vector v i) (if (= i 1000) v (fill-vector (pvector-push v i) (+ i 1))))");
+    ExpectNoError("(define l (pvector->list (fill-vector (pvector) 0)))");
+    ExpectNoError("(define v (fill-vector (pvector) 0))");
+    ExpectNoError(
+        "(define (update-list l i) (if (= i 1000) l (update-list (list-set l i 0) (+ i 1))))");
+    ExpectNoError(
+        "(define (update-vector v i) "
+        "(if (= i 1000) v (update-vector (pvector-set v i 0) (+ i 1))))");
+
+    for (std::string expression :
+         {"(length (fill-alist '() 0))", "(pmap-count (fill-map (pmap) 0))",
+          "(length (update-list l 0))", "(pvector-length (update-vector v 0))"}) {
+        Benchmark(expression);
+    }
+}
@@ -0,0 +1,50 @@
+#include "scheme_test.h"
+
+// values only read by the builtin they are passed to are made in the scratch area, these
+// check that none of them outlives the call reading it
+
+TEST_CASE_METHOD(SchemeTest, "TemporaryNumbers") {
+    // native code doesn't make temporaries
+    SetJit(false, 0);
+    ExpectNoError("(define (f p) (+ (* (car p) (cdr p)) (abs (- (car p) 5)) (- (cdr p))))");
+    auto before = GetAllocationStats();
+    ExpectEq("(f '(2 . 3))", "12");
+    auto after = GetAllocationStats();
+    // the product, the difference and its absolute value
+    REQUIRE(after.scratch - before.scratch == 3);
+
+    ExpectNoError("(define (g p) (list (* (car p) 2) (< (* (car p) 2) (+ (cdr p) 2) 10)))");
+    ExpectEq("(g '(2 . 3))", "(4 #t)");
+    ExpectNoError("(define (h p) (max (- (cdr p) (car p)) (min (* (car p) 4) 7)))");
+    ExpectEq("(h '(2 . 3))", "7");
+}
+
+TEST_CASE_METHOD(SchemeTest, "TemporaryPairs") {
+    ExpectEq("(car (cons (* 2 3) 4))", "6");
+    ExpectEq("(cdr (cons 1 (cons 2 '())))", "(2)");
+    ExpectEq("(pair? (cons 1 2))", "#t");
+    ExpectEq("(null? (cons 1 2))", "#f");
+    ExpectEq("(list? (cons 1 '()))", "#t");
+}
+
+TEST_CASE_METHOD(SchemeTest, "TemporariesInLambdas") {
+    ExpectNoError("(define (mk-dot a b) (lambda (c d) (+ (* a c) (* b d))))");
+    ExpectNoError("(define dot (mk-dot 2 3))");
+    ExpectEq("(dot 4 5)", "23");
+
+    ExpectNoError("(define (sum-products lst) (if (null? lst) 0 "
+                  "(+ (* (car lst) (car lst)) (sum-products (cdr lst)))))");
+    ExpectEq("(sum-products '(1 2 3 4))", "30");
+}
+
+TEST_CASE_METHOD(SchemeTest, "RebindingReadersOfTemporaries") {
+    ExpectNoError("(define saved '())");
+    ExpectNoError("(define (keep x y) (set! saved (cons x saved)) y)");
+    ExpectNoError("(define + keep)");
+    ExpectEq("(+ (* 2 3) 1)", "1");
+    ExpectEq("(+ (* 4 5) 1)", "1");
+    ExpectEq("saved", "(20 6)");
+
+    ExpectNoError("(define car cons)");
+    ExpectEq("(car (- 7 2) 1)", "(5 . 1)");
+}
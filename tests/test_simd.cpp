@@ -0,0 +1,140 @@
+#include "scheme_test.h"
+
+#include <simd.h>
+
+#include <string>
+
+// bulk operations on numeric vectors, unboxed ones are run by the kernels of simd.h
+
+TEST_CASE_METHOD(SchemeTest, "NumericVectorStorage") {
+    // storing something else boxes the elements, filling with a number unboxes them again
+    ExpectNoError("(define v (make-vector 3 1.5))");
+    ExpectEq("(vector-ref v 2)", "1.5");
+    ExpectNoError("(vector-set! v 0 2)");
+    ExpectEq("v", "#(2 1.5 1.5)");
+    ExpectEq("(+ (vector-ref v 0) (vector-ref v 1))", "3.5");
+    ExpectNoError("(vector-fill! v -4)");
+    ExpectEq("v", "#(-4 -4 -4)");
+    ExpectNoError("(vector-set! v 1 100000000000000000000)");
+    ExpectEq("v", "#(-4 100000000000000000000 -4)");
+    ExpectEq("#(0.5 -0.0 1e30)", "#(0.5 -0.0 1e+30)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorReductions") {
+    ExpectEq("(vector-sum #(1 2 3 4 5 6 7 8 9 10))", "55");
+    ExpectEq("(vector-sum #(0.5 0.25))", "0.75");
+    ExpectEq("(vector-sum #(1 0.5))", "1.5");
+    ExpectEq("(vector-sum #())", "0");
+    ExpectEq("(vector-sum (make-vector 5 9223372036854775807))", "46116860184273879035");
+
+    ExpectEq("(vector-dot #(1 2 3) #(4 5 6))", "32");
+    ExpectEq("(vector-dot #(1 2 3) #(0.5 0.5 0.5))", "3.0");
+    ExpectEq("(vector-dot #(4294967296 1) #(4294967296 1))", "18446744073709551617");
+
+    ExpectEq("(vector-min #(3 -7 5 2 9 -1 0 4 8))", "-7");
+    ExpectEq("(vector-max #(3 -7 5 2 9 -1 0 4 8))", "9");
+    ExpectEq("(vector-max #(0.5 2.5 -1.0))", "2.5");
+    ExpectEq("(vector-min #(1 0.5))", "0.5");
+
+    ExpectRuntimeError("(vector-min #())");
+    ExpectRuntimeError("(vector-sum #(1 a))");
+    ExpectRuntimeError("(vector-dot #(1 2) #(1 2 3))");
+    ExpectRuntimeError("(vector-sum '(1 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ElementWiseOperations") {
+    ExpectEq("(vector-add #(1 2 3) #(10 20 30))", "#(11 22 33)");
+    ExpectEq("(vector-mul #(1 2 3) #(10 20 30))", "#(10 40 90)");
+    ExpectEq("(vector-add #(1 2) #(0.5 0.25))", "#(1.5 2.25)");
+    ExpectEq("(vector-mul #(1.5 2.0) 2)", "#(3.0 4.0)");
+    ExpectEq("(vector-add 1 #(1 2))", "#(2 3)");
+    ExpectEq("(vector-add #() #())", "#()");
+
+    // results that don't fit are bignums
+    ExpectEq("(vector-add #(9223372036854775807 1) #(1 1))", "#(9223372036854775808 2)");
+    ExpectEq("(vector-mul #(4294967296 2) 4294967296)", "#(18446744073709551616 8589934592)");
+
+    ExpectRuntimeError("(vector-add #(1 2) #(1))");
+    ExpectRuntimeError("(vector-add #(1 2) 'a)");
+    ExpectRuntimeError("(vector-mul #(1 a) #(1 2))");
+    ExpectRuntimeError("(vector-add 1 2)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorMasks") {
+    ExpectEq("(vector< #(1 5 3) #(2 2 3))", "#(1 0 0)");
+    ExpectEq("(vector<= #(1 5 3) #(2 2 3))", "#(1 0 1)");
+    ExpectEq("(vector> #(1 5 3) 2)", "#(0 1 1)");
+    ExpectEq("(vector>= #(1 5 3) 3)", "#(0 1 1)");
+    ExpectEq("(vector= #(1 2.0 3) #(1 2 4))", "#(1 1 0)");
+    ExpectEq("(vector< #(0.5 1.5) 1)", "#(1 0)");
+
+    // nothing holds for NaN
+    ExpectNoError("(define nan (- (/ 1 0.0) (/ 1 0.0)))");
+    ExpectEq("(vector= (vector nan 1.0) (vector nan 1.0))", "#(0 1)");
+    ExpectEq("(vector>= (vector nan 1.0) 0)", "#(0 1)");
+
+    // masks select and count
+    ExpectNoError("(define v #(4 -2 7 0 -5 3))");
+    ExpectEq("(vector-sum (vector> v 0))", "3");
+    ExpectEq("(vector-mul v (vector> v 0))", "#(4 0 7 0 0 3)");
+    ExpectRuntimeError("(vector< #(1 a) #(1 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "KernelsAgree") {
+    // the portable and the AVX2 kernels on sizes around the block sizes, flonum sums keep
+    // the same partial sums in both
+    for (size_t size : {1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 101}) {
+        std::string fixnums = "#(", flonums = "#(";
+        for (size_t i = 0; i < size; ++i) {
+            fixnums += std::to_string(static_cast<int64_t>(i * 37 % 11) - 5) + " ";
+            flonums += std::to_string(i * 0.1 - 0.7) + "1 ";
+        }
+        ExpectNoError("(define a " + fixnums + "))");
+        ExpectNoError("(define b " + flonums + "))");
+
+        const std::string expressions[] = {"(vector-sum a)",
+                                           "(vector-sum b)",
+                                           "(vector-dot a b)",
+                                           "(vector-dot b b)",
+                                           "(vector-min a)",
+                                           "(vector-max a)",
+                                           "(vector-min b)",
+                                           "(vector-max b)",
+                                           "(vector-sum (vector-add a b))",
+                                           "(vector-sum (vector-mul a a))",
+                                           "(vector-sum (vector< a b))",
+                                           "(vector-sum (vector>= a 0))"};
+        UseAvx2(false);
+        for (size_t i = 0; i < std::size(expressions); ++i) {
+            ExpectNoError("(define r" + std::to_string(i) + " " + expressions[i] + ")");
+        }
+        UseAvx2(true);
+        for (size_t i = 0; i < std::size(expressions); ++i) {
+            ExpectEq("(= r" + std::to_string(i) + " " + expressions[i] + ")", "#t");
+        }
+    }
+
+    // exact integer results don't depend on the order
+    ExpectNoError(
+        "(define (sum v i acc) (if (= i 0) acc (sum v (- i 1) (+ acc (vector-ref v (- i 1))))))");
+    ExpectEq("(= (vector-sum a) (sum a (vector-length a) 0))", "#t");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "SimdBenchmark", "[.benchmark]") {
+    ExpectNoError("(define a (make-vector 10000 3))");
+    ExpectNoError("(define b (make-vector 10000 0.5))");
+    ExpectNoError(
+        "(define (sum v i acc) (if (= i 0) acc (sum v (- i 1) (+ acc (vector-ref v (- i 1))))))");
+    ExpectNoError(
+        "(define (dot u v i acc) (if (= i 0) acc "
+        "(dot u v (- i 1) (+ acc (* (vector-ref u (- i 1)) (vector-ref v (- i 1)))))))");
+
+    // (vector-length a) is what any call costs
+    for (std::string expression :
+         {"(sum a 10000 0)", "(vector-length a)", "(vector-sum a)", "(sum b 10000 0)",
+          "(vector-sum b)", "(dot b b 10000 0)", "(vector-dot b b)",
+          "(vector-sum (vector-add a a))"}) {
+        Benchmark(expression, "10000 elements, " + expression);
+    }
+}
@@ -0,0 +1,101 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "SortBasics") {
+    ExpectEq("(sort '(3 1 2) <)", "(1 2 3)");
+    ExpectEq("(sort '(3 1 2) >)", "(3 2 1)");
+    ExpectEq("(sort '() <)", "()");
+    ExpectEq("(sort '(1.5 -2.5 0.5) <=)", "(-2.5 0.5 1.5)");
+    ExpectEq("(sort '(3 1.5 100000000000000000000 -2) <)", "(-2 1.5 3 100000000000000000000)");
+    ExpectEq("(sort #(5 3 4 1 2) <)", "#(1 2 3 4 5)");
+    ExpectEq("(sort #(0.5 2.5 1.5) >=)", "#(2.5 1.5 0.5)");
+    ExpectEq("(sort (vector 'b 2 'a 1) (lambda (x y) (and (number? x) (not (number? y)))))",
+             "#(2 1 b a)");
+
+    // the argument isn't changed
+    ExpectNoError("(define l '(2 1))");
+    ExpectNoError("(define v #(2 1))");
+    ExpectNoError("(sort l <)");
+    ExpectNoError("(sort v <)");
+    ExpectEq("l", "(2 1)");
+    ExpectEq("v", "#(2 1)");
+
+    ExpectRuntimeError("(sort '(1 a) <)");
+    ExpectRuntimeError("(sort '(2 . 1) <)");
+    ExpectRuntimeError("(sort '(2 1) 1)");
+    ExpectRuntimeError("(sort '(2 1))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SortIsStable") {
+    ExpectNoError("(define (by-key x y) (< (car x) (car y)))");
+    ExpectEq("(sort '((1 . a) (0 . b) (1 . c) (0 . d)) by-key)",
+             "((0 . b) (0 . d) (1 . a) (1 . c))");
+    ExpectEq("(sort #((1 . a) (0 . b) (1 . c) (0 . d)) by-key)",
+             "#((0 . b) (0 . d) (1 . a) (1 . c))");
+
+    // a procedure that isn't an ordering still gives every element once
+    ExpectNoError("(define (sum l) (if (null? l) 0 (+ (car l) (sum (cdr l)))))");
+    ExpectEq("(sum (sort '(1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20) "
+             "(lambda (x y) #t)))",
+             "210");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SortedListsOutliveTheirCall") {
+    // cdr reads its argument, but the part it returns is kept
+    ExpectNoError("(define s (cdr (sort '(3 2 1) <)))");
+    ExpectNoError("(define t (cdr (sort '(3 2 1) (lambda (x y) (< x y)))))");
+    ExpectEq("(+ (* 2 3) (* 4 5) (length (sort '(9 8 7) <)))", "29");
+    ExpectEq("s", "(2 3)");
+    ExpectEq("t", "(2 3)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SortAgreesWithProcedures") {
+    // sizes around the runs sorted by insertion, with many equal keys
+    ExpectNoError("(define (next x) (- (* x 7919) (* 1009 (/ (* x 7919) 1009))))");
+    ExpectNoError(
+        "(define (numbers n x acc) (if (= n 0) acc "
+        "(numbers (- n 1) (next x) (cons (/ x 10) acc))))");
+    ExpectNoError(
+        "(define (sorted? l) (if (null? (cdr l)) #t (if (> (car l) (car (cdr l))) #f "
+        "(sorted? (cdr l)))))");
+    ExpectNoError(
+        "(define (equal-lists? a b) (if (null? a) (null? b) (if (null? b) #f "
+        "(if (= (car a) (car b)) (equal-lists? (cdr a) (cdr b)) #f))))");
+    ExpectNoError("(define (fill! v i l) (if (null? l) v (fill-next! v i l)))");
+    ExpectNoError(
+        "(define (fill-next! v i l) (vector-set! v i (car l)) (fill! v (+ i 1) (cdr l)))");
+    ExpectNoError("(define (to-vector l) (fill! (make-vector (length l) 0) 0 l))");
+    for (int size : {1, 2, 15, 16, 17, 33, 100, 513}) {
+        ExpectNoError("(define l (numbers " + std::to_string(size) + " 1 '()))");
+        ExpectEq("(sorted? (sort l <))", "#t");
+        ExpectEq("(equal-lists? (sort l <) (sort l (lambda (x y) (< x y))))", "#t");
+        ExpectEq("(equal-lists? (sort l >) (reverse (sort l <)))", "#t");
+        ExpectEq("(vector-sum (vector= (sort (to-vector l) <) (to-vector (sort l <))))",
+                 std::to_string(size));
+    }
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "SortBenchmark", "[.benchmark]") {
+    ExpectNoError("(define (next x) (- (* x 7919) (* 1000003 (/ (* x 7919) 1000003))))");
+    ExpectNoError(
+        "(define (numbers n x acc) (if (= n 0) acc (numbers (- n 1) (next x) (cons x acc))))");
+    // a million elements, built in blocks so that the recursion stays shallow
+    ExpectNoError(
+        "(define (build i acc) (if (= i 0) acc (build (- i 1) (numbers 1000 (+ i 1) acc))))");
+    ExpectNoError("(define big (build 1000 '()))");
+    ExpectNoError("(define small (numbers 2000 1 '()))");
+    ExpectNoError(
+        "(define (insert x l) (if (null? l) (list x) "
+        "(if (< x (car l)) (cons x l) (cons (car l) (insert x (cdr l))))))");
+    ExpectNoError(
+        "(define (insertion-sort l acc) (if (null? l) acc "
+        "(insertion-sort (cdr l) (insert (car l) acc))))");
+
+    for (std::string expression :
+         {"(car small)", "(insertion-sort small '())", "(sort small <)", "(car big)",
+          "(sort big <)", "(sort big (lambda (x y) (< x y)))"}) {
+        Benchmark(expression);
+    }
+}
@@ -0,0 +1,55 @@
+#include "scheme_test.h"
+
+// lambdas run an integer version of their body while the parameters it does arithmetic on
+// are numbers, these check that it gives the same results as the generic one
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedArithmetic") {
+    ExpectNoError("(define (f x y) (if (< x y) (- (* x 3) y) (max x (abs y) (+ x y 1))))");
+    REQUIRE(GetTierStats().specializations == 1);
+    ExpectEq("(f 1 5)", "-2");
+    ExpectEq("(f 5 -7)", "7");
+    ExpectEq("(f 5 1)", "7");
+
+    // results that overflow are computed again by the generic body
+    ExpectNoError("(define (square x) (* x x))");
+    ExpectEq("(square 100000)", "10000000000");
+    ExpectEq("(< (square 100000) 0)", "#f");
+    ExpectEq("(square 4294967296)", "18446744073709551616");
+    ExpectEq("(< (square 4294967296) 0)", "#f");
+
+    ExpectNoError("(define (ordered? a b c) (<= a b c))");
+    ExpectEq("(ordered? 1 2 2)", "#t");
+    ExpectEq("(ordered? 1 3 2)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedBodyFallsBack") {
+    ExpectNoError("(define (add x y) (+ x y))");
+    ExpectEq("(add 1 2)", "3");
+    ExpectRuntimeError("(add 1 'a)");
+    ExpectRuntimeError("(add '(1) 2)");
+    ExpectEq("(add 3 4)", "7");
+
+    // parameters that aren't used in arithmetic can be anything
+    ExpectNoError("(define (pick n lst) (if (= n 0) (car lst) (pick (- n 1) (cdr lst))))");
+    ExpectEq("(pick 2 '(a b c d))", "c");
+
+    // nor can ones that get assigned
+    ExpectNoError("(define (g x) (set! x (+ x 1)) (set! x 'done) x)");
+    ExpectEq("(g 1)", "done");
+}
+
+TEST_CASE_METHOD(SchemeTest, "SpecializedBodyAfterRedefinition") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(sum 10 0)", "55");
+    ExpectNoError("(define + *)");
+    ExpectEq("(sum 5 1)", "120");
+    ExpectNoError("(set! = (lambda (x y) (< x 2)))");
+    ExpectEq("(sum 5 1)", "120");
+}
+
+TEST_CASE_METHOD(SchemeTest, "NothingToSpecialize") {
+    ExpectNoError("(define (id x) x)");
+    ExpectNoError("(define (second lst) (car (cdr lst)))");
+    REQUIRE(GetTierStats().specializations == 0);
+    ExpectEq("(second '(1 2))", "2");
+}
@@ -0,0 +1,107 @@
+#include "scheme_test.h"
+
+#include <string>
+#include <vector>
+
+TEST_CASE_METHOD(SchemeTest, "StringLiterals") {
+    ExpectEq("\"hello\"", "\"hello\"");
+    ExpectEq("\"\"", "\"\"");
+    ExpectEq("\"a\\\"b\\\\c\\nd\"", "\"a\\\"b\\\\c\\nd\"");
+    ExpectEq("'(\"a\" . \"b\")", "(\"a\" . \"b\")");
+    ExpectEq("(string? \"x\")", "#t");
+    ExpectEq("(string? 'x)", "#f");
+    ExpectSyntaxError("\"abc");
+}
+
+TEST_CASE_METHOD(SchemeTest, "StringOperations") {
+    ExpectEq("(string-length \"hello\")", "5");
+    ExpectEq("(string-append)", "\"\"");
+    ExpectEq("(string-append \"ab\" \"\" \"cd\")", "\"abcd\"");
+    ExpectEq("(substring \"hello\" 1 3)", "\"el\"");
+    ExpectEq("(substring \"hello\" 2)", "\"llo\"");
+    ExpectEq("(substring \"hello\" 5 5)", "\"\"");
+    ExpectRuntimeError("(substring \"hello\" 3 2)");
+    ExpectRuntimeError("(substring \"hello\" 0 6)");
+    ExpectRuntimeError("(string-append \"a\" 'b)");
+    ExpectRuntimeError("(string-length 'abc)");
+
+    ExpectEq("(string->symbol \"foo\")", "foo");
+    ExpectEq("(symbol->string 'bar)", "\"bar\"");
+    ExpectEq("(symbol? (string->symbol \"x\"))", "#t");
+    ExpectRuntimeError("(symbol->string \"bar\")");
+
+    ExpectEq("(number->string 42)", "\"42\"");
+    ExpectEq("(number->string -1.5)", "\"-1.5\"");
+    ExpectEq("(number->string (* 10000000000 10000000000))", "\"100000000000000000000\"");
+    ExpectEq("(string->number \"42\")", "42");
+    ExpectEq("(string->number \"2e3\")", "2000.0");
+    ExpectEq("(string->number \"100000000000000000000\")", "100000000000000000000");
+    ExpectEq("(string->number \"abc\")", "#f");
+    ExpectEq("(string->number \"1 2\")", "#f");
+    ExpectEq("(string->number \" 1\")", "#f");
+    ExpectEq("(string->number \"(\")", "#f");
+    ExpectEq("(+ 1 (string->number (number->string 41)))", "42");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EmptyStrings") {
+    // string-append starts from an empty view without data
+    ExpectEq("(string-append)", "\"\"");
+    ExpectEq("(string-length (string-append))", "0");
+    ExpectEq("(string-append (string-append) \"a\" (string-append))", "\"a\"");
+    ExpectEq("(equal? (string-append) \"\")", "#t");
+    ExpectEq("(substring \"\" 0)", "\"\"");
+    ExpectEq("(symbol->string (string->symbol \"\"))", "\"\"");
+}
+
+TEST_CASE_METHOD(SchemeTest, "StringRopes") {
+    // appending piece by piece, in blocks so that the recursion stays shallow
+    ExpectNoError("(define s \"\")");
+    ExpectNoError("(define (add! piece n) (if (= n 0) s (add-next! piece n)))");
+    ExpectNoError(
+        "(define (add-next! piece n) (set! s (string-append s piece)) (add! piece (- n 1)))");
+    ExpectNoError("(define (add-blocks! n) (if (= n 0) s (add-block! n)))");
+    ExpectNoError("(define (add-block! n) (add! \"0123456789\" 1000) (add-blocks! (- n 1)))");
+    ExpectNoError("(add-blocks! 100)");
+    ExpectEq("(string-length s)", "1000000");
+    ExpectEq("(substring s 999995)", "\"56789\"");
+
+    // the parts are shared, and they survive collection
+    ExpectNoError("(define a (string-append s \"x\"))");
+    ExpectNoError("(define b (string-append \"y\" s))");
+    ExpectNoError("(add! \"abc\" 1)");
+    ExpectEq("(string-length s)", "1000003");
+    ExpectEq("(substring a 999998)", "\"89x\"");
+    ExpectEq("(substring b 0 3)", "\"y01\"");
+    ExpectEq("(substring s 999998)", "\"89abc\"");
+}
+
+TEST_CASE_METHOD(SchemeTest, "StringKeys") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectNoError("(hash-table-set! t \"key\" 1)");
+    ExpectNoError("(hash-table-set! t 'key 2)");
+    ExpectEq("(hash-table-ref t (string-append \"k\" \"ey\"))", "1");
+    ExpectEq("(hash-table-ref t 'key)", "2");
+    ExpectEq("(member \"b\" '(\"a\" \"b\"))", "(\"b\")");
+    ExpectEq("(assoc \"b\" '((\"a\" . 1) (\"b\" . 2)))", "(\"b\" . 2)");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "StringBenchmark", "[.benchmark]") {
+    ExpectNoError("(define s \"\")");
+    ExpectNoError("(define (add! piece n) (if (= n 0) s (add-next! piece n)))");
+    ExpectNoError(
+        "(define (add-next! piece n) (set! s (string-append s piece)) (add! piece (- n 1)))");
+    ExpectNoError("(define (add-blocks! n) (if (= n 0) s (add-block! n)))");
+    ExpectNoError("(define (add-block! n) (add! \"0123456789\" 1000) (add-blocks! (- n 1)))");
+
+    // twice the pieces take about twice the time, flat strings would take four times
+    for (std::string expression :
+         {"(string-length (add-blocks! 10))", "(string-length (add-blocks! 20))",
+          "(string-length (add-blocks! 40))", "(string-length (substring s 0 1))"}) {
+        std::vector<std::string> setup = {"(set! s \"\")"};
+        if (expression.find("substring") != std::string::npos) {
+            setup.push_back("(add-blocks! 40)");
+        }
+        Benchmark(expression, "", setup);
+    }
+}
@@ -160,3 +160,24 @@ void ShouldThrow() {
 TEST_CASE("Exception is thrown") {
     REQUIRE_THROWS_AS(ShouldThrow(), SyntaxError);
 }
+
+TEST_CASE("String literals") {
+    std::stringstream ss{"\"a b\" \"\" \"q\\\"\\\\\\n\\t\")"};
+    Tokenizer tokenizer{&ss};
+
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"a b"}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{""}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"q\"\\\n\t"}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{BracketToken::CLOSE});
+
+    std::stringstream unterminated{"\"abc"};
+    REQUIRE_THROWS_AS(Tokenizer{&unterminated}, SyntaxError);
+    std::stringstream escape{"\"\\a\""};
+    REQUIRE_THROWS_AS(Tokenizer{&escape}, SyntaxError);
+}
@@ -0,0 +1,80 @@
+#include "scheme_test.h"
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "VectorLiterals") {
+    ExpectEq("#(1 2 3)", "#(1 2 3)");
+    ExpectEq("#()", "#()");
+    ExpectEq("#(1 (2 . 3) #(a) 0.5)", "#(1 (2 . 3) #(a) 0.5)");
+    ExpectEq("'(#(1) . #(2))", "(#(1) . #(2))");
+    ExpectEq("(vector? #(1))", "#t");
+    ExpectEq("(vector? '(1))", "#f");
+    ExpectEq("(vector-length #(a b c))", "3");
+    ExpectSyntaxError("#(1 . 2)");
+    ExpectSyntaxError("#(1 2");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorOperations") {
+    ExpectEq("(make-vector 3)", "#(0 0 0)");
+    ExpectEq("(make-vector 2 'a)", "#(a a)");
+    ExpectEq("(vector 1 (+ 1 1) 'c)", "#(1 2 c)");
+    ExpectEq("(vector)", "#()");
+
+    ExpectNoError("(define v (vector 1 2 3))");
+    ExpectEq("(vector-ref v 0)", "1");
+    ExpectEq("(vector-ref v (- (vector-length v) 1))", "3");
+    ExpectNoError("(vector-set! v 1 '(x y))");
+    ExpectEq("v", "#(1 (x y) 3)");
+    ExpectNoError("(vector-fill! v 7)");
+    ExpectEq("v", "#(7 7 7)");
+
+    ExpectRuntimeError("(vector-ref v 3)");
+    ExpectRuntimeError("(vector-ref v -1)");
+    ExpectRuntimeError("(vector-ref '(1 2) 0)");
+    ExpectRuntimeError("(vector-set! v 'a 1)");
+    ExpectRuntimeError("(make-vector -1)");
+    ExpectRuntimeError("(vector-length)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorElementsSurviveGC") {
+    ExpectNoError("(define v (make-vector 2))");
+    ExpectNoError("(vector-set! v 0 (list 1 2))");
+    ExpectNoError("(vector-set! v 1 (lambda (x) (* x x)))");
+    ExpectNoError("(define (garbage n) (if (= n 0) 0 (begin-list (list n n) (garbage (- n 1)))))");
+    ExpectNoError("(define (begin-list a b) b)");
+    ExpectNoError("(garbage 100)");
+    ExpectEq("(vector-ref v 0)", "(1 2)");
+    ExpectEq("((vector-ref v 1) 5)", "25");
+
+    // a vector holding itself
+    ExpectNoError("(vector-set! v 0 v)");
+    ExpectNoError("(garbage 100)");
+    ExpectEq("(vector-length (vector-ref v 0))", "2");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorsInLambdas") {
+    ExpectNoError(
+        "(define (fill-squares v i) (if (= i (vector-length v)) v "
+        "(begin (vector-set! v i (* i i)) (fill-squares v (+ i 1)))))");
+    ExpectNoError("(define (begin a b) b)");
+    ExpectEq("(fill-squares (make-vector 5) 0)", "#(0 1 4 9 16)");
+    ExpectNoError("(define (first) #(1 2))");
+    ExpectEq("(vector-ref (first) 1)", "2");
+}
+
+// run with [benchmark]
+TEST_CASE_METHOD(SchemeTest, "VectorBenchmark", "[.benchmark]") {
+    ExpectNoError(
+        "(define (iota n acc) (if (= n 0) acc (iota (- n 1) (cons (- n 1) acc))))");
+    ExpectNoError("(define l (iota 5000 '()))");
+    ExpectNoError("(define v (make-vector 5000 1))");
+    ExpectNoError(
+        "(define (sum-list i acc) (if (= i 5000) acc (sum-list (+ i 1) (+ acc (list-ref l i)))))");
+    ExpectNoError(
+        "(define (sum-vector i acc) (if (= i 5000) acc "
+        "(sum-vector (+ i 1) (+ acc (vector-ref v i)))))");
+
+    for (std::string expression : {"(sum-list 0 0)", "(sum-vector 0 0)"}) {
+        Benchmark(expression, "5000 random accesses, " + expression);
+    }
+}
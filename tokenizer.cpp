@@ -2,8 +2,10 @@
 #include "error.h"
 
 #include <cctype>
+#include <cstdlib>
 #include <array>
 #include <algorithm>
+#include <stdexcept>
 
 bool SymbolToken::operator==(const SymbolToken& other) const {
     return name_ == other.name_;
@@ -17,10 +19,26 @@ bool DotToken::operator==(const DotToken&) const {
     return 1;
 }
 
+bool VectorToken::operator==(const VectorToken&) const {
+    return 1;
+}
+
 bool ConstantToken::operator==(const ConstantToken& other) const {
     return value_ == other.value_;
 }
 
+bool BigConstantToken::operator==(const BigConstantToken& other) const {
+    return digits_ == other.digits_;
+}
+
+bool FloatConstantToken::operator==(const FloatConstantToken& other) const {
+    return value_ == other.value_;
+}
+
+bool StringToken::operator==(const StringToken& other) const {
+    return value_ == other.value_;
+}
+
 bool ShouldIgnore(int c) {
     return c == ' ' || c == 10;
 }
@@ -60,13 +78,81 @@ bool IsNum(std::istream* stream) {
     return 0;
 }
 
-void ReadNum(std::istream* stream, std::string& state) {
-    state.push_back(stream->get());
+void ReadDigits(std::istream* stream, std::string& state) {
     while (isdigit(stream->peek())) {
         state.push_back(stream->get());
     }
 }
 
+// true if the number has a fraction or an exponent; a dot not followed by a digit is left
+// alone, (1 . 2) is a pair
+bool ReadNum(std::istream* stream, std::string& state) {
+    state.push_back(stream->get());
+    ReadDigits(stream, state);
+    bool flonum = false;
+    if (stream->peek() == '.') {
+        stream->get();
+        if (isdigit(stream->peek())) {
+            state.push_back('.');
+            ReadDigits(stream, state);
+            flonum = true;
+        } else {
+            stream->unget();
+        }
+    }
+    if (stream->peek() == 'e' || stream->peek() == 'E') {
+        state.push_back(stream->get());
+        if (stream->peek() == '-' || stream->peek() == '+') {
+            state.push_back(stream->get());
+        }
+        if (!isdigit(stream->peek())) {
+            throw SyntaxError("Invalid number");
+        }
+        ReadDigits(stream, state);
+        flonum = true;
+    }
+    return flonum;
+}
+
+// consumes #( if it comes next
+bool IsVectorStart(std::istream* stream) {
+    if (stream->peek() != '#') {
+        return 0;
+    }
+    stream->get();
+    if (stream->peek() == '(') {
+        stream->get();
+        return 1;
+    }
+    stream->unget();
+    return 0;
+}
+
+// the characters up to the closing quote, \" \\ \n and \t are the escapes
+void ReadString(std::istream* stream, std::string& state) {
+    stream->get();
+    while (true) {
+        int c = stream->get();
+        if (c == std::istream::traits_type::eof()) {
+            throw SyntaxError("Unterminated string");
+        }
+        if (c == '"') {
+            return;
+        }
+        if (c == '\\') {
+            c = stream->get();
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            } else if (c != '"' && c != '\\') {
+                throw SyntaxError("Unknown escape in string");
+            }
+        }
+        state.push_back(c);
+    }
+}
+
 bool ValidFront(char c) {
     // [a-zA-Z<=>*/#]
     return isalpha(c) || c == '<' || c == '=' || c == '>' || c == '*' || c == '/' || c == '#';
@@ -107,9 +193,22 @@ void Tokenizer::Next() {
     if (it != kSymbols.end() && !IsNum(stream_)) {
         state_ = kSymbolTokens[it - kSymbols.begin()];
         stream_->get();
+    } else if (IsVectorStart(stream_)) {
+        state_ = VectorToken();
+    } else if (stream_->peek() == '"') {
+        ReadString(stream_, state);
+        state_ = StringToken(state);
     } else if (stream_->peek() == '-' || stream_->peek() == '+' || isdigit(stream_->peek())) {
-        ReadNum(stream_, state);
-        state_ = ConstantToken(std::stoi(state));
+        if (ReadNum(stream_, state)) {
+            // strtod gives infinity or zero for exponents out of range
+            state_ = FloatConstantToken(std::strtod(state.c_str(), nullptr));
+        } else {
+            try {
+                state_ = ConstantToken(std::stoll(state));
+            } catch (std::out_of_range&) {
+                state_ = BigConstantToken(state);
+            }
+        }
     } else {
         ReadSequence(stream_, state);
         state_ = SymbolToken(state);
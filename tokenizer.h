@@ -24,6 +24,11 @@ struct DotToken {
 
 enum class BracketToken { OPEN, CLOSE };
 
+// #( starting a vector literal, closed by a BracketToken
+struct VectorToken {
+    bool operator==(const VectorToken&) const;
+};
+
 struct ConstantToken {
     int64_t value_;
 
@@ -33,7 +38,38 @@ struct ConstantToken {
     bool operator==(const ConstantToken& other) const;
 };
 
-using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken>;
+// integer literal out of the range of ConstantToken
+struct BigConstantToken {
+    std::string digits_;
+
+    BigConstantToken(const std::string& digits) : digits_(digits) {
+    }
+
+    bool operator==(const BigConstantToken& other) const;
+};
+
+// literal with a fraction or an exponent, like 1.5 or 2e-3
+struct FloatConstantToken {
+    double value_;
+
+    FloatConstantToken(const double value) : value_(value) {
+    }
+
+    bool operator==(const FloatConstantToken& other) const;
+};
+
+// "..." literal with the escapes already replaced
+struct StringToken {
+    std::string value_;
+
+    StringToken(const std::string& value) : value_(value) {
+    }
+
+    bool operator==(const StringToken& other) const;
+};
+
+using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken,
+                           BigConstantToken, FloatConstantToken, VectorToken, StringToken>;
 
 class Tokenizer {
 public: